@@ -1,5 +1,6 @@
 #include <arch.h>
 #include <cpu.h>
+#include <sched.h>
 #include <riscv/arch.h>
 #include <riscv/sbi.h>
 #include <riscv/dis.h>
@@ -7,6 +8,7 @@
 #include <syscall.h>
 #include <time.h>
 #include <util.h>
+#include <phys.h>
 #include <riscv/paging.h>
 
 static unsigned long riscv_timebase = CONFIG_RISCV_CLOCKS_PER_SECOND;
@@ -35,6 +37,12 @@ void arch_thread_create_callback() {
     auto *regs = (rv::regs *)tf;
     arch_enable_ints();
 
+    // sets regs->tp
+    if (thd->setup_tls((reg_t *)tf) != 0) {
+      // without its TLS block, the thread would fault on its first errno access
+      sys::exit_thread(-1);
+      sched::yield();
+    }
     if (thd->pid == thd->tid) {
       thd->setup_stack((reg_t *)tf);
     }
@@ -87,8 +95,19 @@ void arch_flush_mmu(void) {}
 extern "C" void __rv_save_fpu(void *);
 extern "C" void __rv_load_fpu(void *);
 
-void arch_save_fpu(Thread &thd) { __rv_save_fpu(thd.fpu.state); }
-void arch_restore_fpu(Thread &thd) { __rv_load_fpu(thd.fpu.state); }
+void arch_save_fpu(Thread &thd) {
+  if (thd.fpu.state != NULL) __rv_save_fpu(thd.fpu.state);
+}
+
+void arch_restore_fpu(Thread &thd) {
+  // threads get their FPU state the first time they are run, not when they are created
+  if (thd.fpu.state == NULL) thd.fpu.state = phys::kalloc(1);
+  __rv_load_fpu(thd.fpu.state);
+}
+
+void arch_sync_fpu(Thread &thd) { arch_save_fpu(thd); }
+
+size_t arch_fpu_state_size(void) { return PGSIZE; }
 
 
 unsigned long arch_read_timestamp(void) {
@@ -105,12 +124,17 @@ unsigned long arch_timestamp_to_ns(uint64_t cycles) { return (cycles * 100000000
 
 
 int arch_set_timer(uint64_t nanos) {
-  sbi_set_timer(rv::get_time() + arch_ns_to_timestamp(nanos));
+  auto &c = core();
+  unsigned long deadline = rv::get_time() + arch_ns_to_timestamp(nanos);
+  if (deadline < c.next_timer) {
+    c.next_timer = deadline;
+    sbi_set_timer(deadline);
+  }
 	return 0;
 }
 int arch_stop_timer() {
-	//
-sbi_set_timer((uint64_t)-1);
+  core().next_timer = ~0UL;
+	sbi_set_timer((uint64_t)-1);
 	return 0;
 }
 
@@ -17,6 +17,7 @@
 #include <syscall.h>
 #include <time.h>
 #include <util.h>
+#include <vvar.h>
 
 #include "sched.h"
 #include <ioctl.h>
@@ -58,9 +59,8 @@ static uint32_t bswap_32(uint32_t __x) { return __x >> 24 | (__x >> 8 & 0xff00)
 
 void initrd_dump(void *vbuf, size_t size) { hexdump(vbuf, size, true); }
 
-static uint64_t ticks_to_ns(uint64_t ticks) { return (ticks * NS_PER_SEC) / CONFIG_RISCV_CLOCKS_PER_SECOND; }
 
-static unsigned long riscv_high_acc_time_func(void) { return ticks_to_ns(read_csr(time)); }
+static unsigned long riscv_read_time(void) { return read_csr(time); }
 
 static off_t dtb_ram_start = 0;
 static size_t dtb_ram_size = 0;
@@ -355,8 +355,7 @@ void main(int hartid, void *fdt) {
 
   sbi_init();
 
-  time::set_cps(CONFIG_RISCV_CLOCKS_PER_SECOND);
-  time::set_high_accuracy_time_fn(riscv_high_acc_time_func);
+  time::register_clocksource("time", riscv_read_time, CONFIG_RISCV_CLOCKS_PER_SECOND, VVAR_CLOCK_TIME_CSR);
   /* set SUM bit in sstatus so kernel can access userspace pages. Also enable
    * floating point */
   write_csr(sstatus, read_csr(sstatus) | (1 << 18) | (1 << 13));
@@ -8,6 +8,9 @@
 #include <pit.h>
 #include <sched.h>
 #include <module.h>
+#include <sleep.h>
+#include <time.h>
+#include <vvar.h>
 
 #define IPI_IRQ (0xF3 - 32)
 #define APIC_BSP_DEBUG(...)  \
@@ -113,12 +116,34 @@ static void xcall_handler(int i, reg_t *tf, void *) {
 
 static void apic_tick_handler(int i, reg_t *tf, void *) {
   auto &cpu = cpu::current();
+  auto &apic = cpu.apic;
   uint64_t now = arch_read_timestamp();
-  cpu.kstat.tsc_per_tick = now - cpu.kstat.last_tick_tsc;
-  cpu.kstat.last_tick_tsc = now;
-  cpu.kstat.ticks++;
-  core().apic.eoi();
-  if (core().in_sched) sched::handle_tick(cpu.kstat.ticks);
+
+  // In deadline mode the timer also fires for sleepers and preemption, so
+  // only some of these interrupts are scheduler ticks.
+  bool tick = true;
+  if (apic.tsc_deadline) {
+    cpu.next_timer = ~0UL;
+    tick = now >= apic.next_tick_tsc;
+    if (tick) apic.next_tick_tsc = now + apic.tsc_per_tick;
+  }
+
+  if (tick) {
+    cpu.kstat.tsc_per_tick = now - cpu.kstat.last_tick_tsc;
+    cpu.kstat.last_tick_tsc = now;
+    cpu.kstat.ticks++;
+  }
+  apic.eoi();
+
+  // Arm the next tick. The scheduler and check_wakeups will pull it in if a
+  // thread's slice or a sleeper is due sooner.
+  if (apic.tsc_deadline) apic.arm_deadline(apic.next_tick_tsc);
+
+  if (tick) {
+    sched::handle_tick(cpu.kstat.ticks);
+  } else {
+    sched::handle_timer();
+  }
 }
 
 
@@ -258,6 +283,46 @@ void Apic::timer_setup(uint32_t quantum_ms) {
   calibrate();
   apic_ticks_per_second = this->ticks_per_second();
 
+  // TSC-deadline mode is only usable if the TSC keeps counting through deep
+  // C-states (arat), otherwise a halted core could miss its deadline.
+  this->tsc_deadline = tscdeadline && arat && this->tsc_hz != 0;
+
+  // CPUID.80000001H:EDX[27] - rdtscp is available. Stash the core id in
+  // TSC_AUX so userspace can find out where it is running.
+  cpuid::run(0x80000001, ret);
+  bool rdtscp = ((ret.d >> 27) & 0x1) != 0;
+  if (rdtscp) msr_write(MSR_TSC_AUX, core().id);
+
+  if (core().primary) {
+    // CPUID.80000007H:EDX[8] - the TSC runs at a constant rate in all P/C-states
+    cpuid::run(0x80000007, ret);
+    bool invariant = ((ret.d >> 8) & 0x1) != 0;
+    if (!invariant) {
+      APIC_DEBUG("TSC is not invariant, time may drift if the core changes frequency\n");
+    }
+    // Only let userspace read the TSC directly if it is invariant, as the
+    // kernel can't correct for it there.
+    time::register_clocksource("tsc", arch_read_timestamp, this->tsc_hz, invariant ? VVAR_CLOCK_TSC : VVAR_CLOCK_NONE);
+
+    if (rdtscp) {
+      vvar::write_begin();
+      vvar::get()->cpu_mode = VVAR_CPU_RDTSCP;
+      vvar::write_end();
+    }
+  }
+
+  if (this->tsc_deadline) {
+    core().ticks_per_second = CONFIG_TICKS_PER_SECOND;
+    this->tsc_per_tick = this->tsc_hz / CONFIG_TICKS_PER_SECOND;
+    write(APIC_REG_LVTT, APIC_TIMER_TSCDLINE | (50 + T_IRQ0));
+    // order the LVT write before the first write to IA32_TSC_DEADLINE
+    asm volatile("mfence" ::: "memory");
+    this->next_tick_tsc = arch_read_timestamp() + this->tsc_per_tick;
+    arm_deadline(this->next_tick_tsc);
+    APIC_BSP_DEBUG("Using TSC-deadline timer mode\n");
+    return;
+  }
+
   set_tickrate(CONFIG_TICKS_PER_SECOND);
 }
 
@@ -505,7 +570,8 @@ try_once:
   }
 
   // us are used here to also keep precision for cycle->ns and ns->cycles conversions
-  this->cycles_per_us = ((end - start) * TEST_TIME_SEC_RECIP) / 1000000;
+  this->tsc_hz = (end - start) * TEST_TIME_SEC_RECIP;
+  this->cycles_per_us = this->tsc_hz / 1000000;
   this->bus_freq_hz = APIC_TIMER_DIV * apic_timer_ticks * TEST_TIME_SEC_RECIP;
   this->ps_per_tick = (1000000000000ULL / this->bus_freq_hz) * APIC_TIMER_DIV;
 
@@ -525,7 +591,12 @@ try_once:
 }
 
 
-// TODO: move to manual oneshots
+void Apic::arm_deadline(uint64_t tsc) {
+  core().next_timer = tsc;
+  msr_write(MSR_IA32_TSC_DEADLINE, tsc);
+}
+
+
 void Apic::set_tickrate(uint32_t per_second) {
   core().ticks_per_second = per_second;
   write(APIC_REG_TMDCR, APIC_TIMER_DIVCODE);
@@ -546,6 +617,7 @@ void Apic::calibrate(void) {
     this->bus_freq_hz = bsp_apic->bus_freq_hz;
     this->ps_per_tick = bsp_apic->ps_per_tick;
     this->cycles_per_us = bsp_apic->cycles_per_us;
+    this->tsc_hz = bsp_apic->tsc_hz;
     this->cycles_per_tick = bsp_apic->cycles_per_tick;
     // APIC_DEBUG("AP APIC id=0x%x cloned BSP APIC's timer configuration\n", this->id);
     return;
@@ -2,8 +2,11 @@
 #include <types.h>
 #include <printf.h>
 #include <cpu.h>
+#include <sched.h>
 #include <syscall.h>
 #include <time.h>
+#include <errno.h>
+#include <x86/msr.h>
 
 void arch_thread_create_callback() {
   auto thd = curthd;
@@ -22,6 +25,12 @@ void arch_thread_create_callback() {
     if (time::stabilized()) {
       thd->last_start_utime_us = time::now_us();
     }
+    if (thd->setup_tls((reg_t *)tf) != 0) {
+      // without its TLS block, the thread would fault on its first errno access
+      sys::exit_thread(-1);
+      sched::yield();
+    }
+    msr_write(MSR_FS_BASE, thd->tls_uaddr);
     if (thd->pid == thd->tid) {
       thd->setup_stack((reg_t *)tf);
     }
@@ -69,4 +78,26 @@ unsigned long arch_timestamp_to_ns(unsigned long ts) { return core().apic.cycles
 unsigned long arch_ns_to_timestamp(unsigned long ns) { return core().apic.ns_to_cycles(ns); }
 
 
+int arch_set_timer(uint64_t nanos) {
+  auto &c = core();
+  // the periodic timer will get there on its own
+  if (!c.apic.tsc_deadline) return -ENOTSUP;
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  uint64_t deadline = arch_read_timestamp() + (uint64_t)(((unsigned __int128)nanos * c.apic.tsc_hz) / NS_PER_SEC);
+  if (deadline < c.next_timer) c.apic.arm_deadline(deadline);
+  if (en) arch_enable_ints();
+  return 0;
+}
+
+int arch_stop_timer() {
+  auto &c = core();
+  if (!c.apic.tsc_deadline) return -ENOTSUP;
+  c.next_timer = ~0UL;
+  c.apic.msr_write(MSR_IA32_TSC_DEADLINE, 0);
+  return 0;
+}
+
+
 void arch_relax(void) { asm("pause"); }
@@ -1,7 +1,13 @@
 bits 64
 
 global __fpu_xsave64
+global __fpu_xsaveopt64
+global __fpu_xsaves64
 global __fpu_xrstor64
+global __fpu_xrstors64
+
+; every one of these takes the area in rdi, and saves or restores every
+; enabled component (the mask in edx:eax is all ones)
 
 __fpu_xsave64:
 	mov rdx, ~0
@@ -10,8 +16,29 @@ __fpu_xsave64:
 	ret
 
 
+__fpu_xsaveopt64:
+	mov rdx, ~0
+	mov rax, ~0
+	xsaveopt [rdi]
+	ret
+
+
+__fpu_xsaves64:
+	mov rdx, ~0
+	mov rax, ~0
+	xsaves [rdi]
+	ret
+
+
 __fpu_xrstor64:
 	mov rdx, ~0
 	mov rax, ~0
 	xrstor [rdi]
 	ret
+
+
+__fpu_xrstors64:
+	mov rdx, ~0
+	mov rax, ~0
+	xrstors [rdi]
+	ret
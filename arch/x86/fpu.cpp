@@ -4,6 +4,8 @@
 #include <sched.h>
 #include <x86/cpuid.h>
 #include <x86/msr.h>
+#include <phys.h>
+#include <cpu.h>
 
 struct fpu::fpu_caps fpu::caps;
 
@@ -291,6 +293,24 @@ static void fpu_init_common() {
         :
         : "a"(xsave_support)
         : "rcx", "memory");
+
+    cpuid::ret_t r;
+    // ebx is the size of the (standard format) area for the features we just enabled
+    cpuid::run_sub(0x0d, 0, r);
+    fpu::caps.xsave_size = r.b;
+
+    cpuid::run_sub(0x0d, 1, r);
+    fpu::caps.xsaveopt = (r.a & (1 << 0)) != 0;
+    fpu::caps.xsaves = (r.a & (1 << 3)) != 0;
+    if (fpu::caps.xsaves) {
+      // we only use XSAVES for the user features in XCR0, not any supervisor state
+      msr_write(MSR_IA32_XSS, 0);
+      cpuid::run_sub(0x0d, 1, r);
+      // ebx is now the size of the compacted area
+      fpu::caps.xsave_size = r.b;
+    }
+    FPU_DEBUG("XSAVE area is %u bytes (xsaveopt=%d, xsaves=%d)\n", fpu::caps.xsave_size, fpu::caps.xsaveopt,
+        fpu::caps.xsaves);
   }
 }
 
@@ -317,33 +337,165 @@ void fpu::init(void) {
 
 
 extern "C" void __fpu_xsave64(void *);
+extern "C" void __fpu_xsaveopt64(void *);
+extern "C" void __fpu_xsaves64(void *);
 extern "C" void __fpu_xrstor64(void *);
+extern "C" void __fpu_xrstors64(void *);
+
+
+/*
+ * Saving and restoring the FPU on every context switch is expensive, and a
+ * waste for threads that only ever do integer work. So we track who uses it:
+ *
+ * - A thread that has used the FPU in FPU_EAGER_AFTER slices in a row has
+ *   its state loaded when it is switched in, like before.
+ * - Everyone else runs with CR0.TS set. Their first FPU instruction traps
+ *   (#NM), and only then is their state loaded. If they never touch the FPU,
+ *   it is neither loaded nor saved.
+ *
+ * Every 256 slices an eager thread runs lazily for one slice, so a thread
+ * that stops using the FPU stops paying for it.
+ *
+ * The registers also remember whose state they hold. If a thread gets the
+ * FPU back on the core it last used it on, and nobody else has loaded theirs
+ * since, there is nothing to restore. Saves use XSAVEOPT or XSAVES when we
+ * have them, which skip components that are unmodified or in their initial state.
+ */
+#define FPU_EAGER_AFTER 5
+
+
+// What a thread's registers are reset to when they must not leak into another process.
+// XRSTOR(S) of an area whose XSTATE_BV is zero puts every component in its initial state
+static uint8_t fpu_init_area[4096] __attribute__((aligned(64)));
+
+
+size_t arch_fpu_state_size(void) {
+  // the legacy FXSAVE area is 512 bytes
+  return fpu::caps.xsave ? fpu::caps.xsave_size : 512;
+}
 
-void arch_save_fpu(struct Thread &thd) {
-  if (fpu::caps.xsave) {
-    __fpu_xsave64(thd.fpu.state);
+
+static inline void fpu_save(void *state) {
+  if (fpu::caps.xsaves) {
+    __fpu_xsaves64(state);
+  } else if (fpu::caps.xsaveopt) {
+    __fpu_xsaveopt64(state);
+  } else if (fpu::caps.xsave) {
+    __fpu_xsave64(state);
   } else {
-    asm volatile("fxsave64 (%0);" ::"r"(thd.fpu.state));
+    asm volatile("fxsave64 (%0);" ::"r"(state));
   }
 }
 
-void arch_restore_fpu(struct Thread &thd) {
-  // printf("cr4=%p\n", read_cr4());
 
-  if (!thd.fpu.initialized) {
-    asm volatile("fninit");
+static inline void fpu_restore(void *state) {
+  if (fpu::caps.xsaves) {
+    __fpu_xrstors64(state);
+  } else if (fpu::caps.xsave) {
+    __fpu_xrstor64(state);
+  } else {
+    asm volatile("fxrstor64 (%0);" ::"r"(state));
+  }
+}
 
-    if (fpu::caps.xsave) {
-      __fpu_xsave64(thd.fpu.state);
-    } else {
-      asm volatile("fxsave64 (%0);" ::"r"(thd.fpu.state));
-    }
+
+// put the registers in their initial state, forgetting whoever owned them (CR0.TS must be clear)
+static void fpu_scrub(cpu::Core &c) {
+  auto *area = fpu_init_area;
+  *(uint16_t *)(area + 0) = 0x037f;  // FCW: the value fninit uses
+  *(uint32_t *)(area + 24) = 0x1f80; // MXCSR: all exceptions masked
+  // XRSTORS needs the compacted format bit in XCOMP_BV
+  if (fpu::caps.xsaves) *(uint64_t *)(area + 512 + 8) = 1ULL << 63;
+  fpu_restore(area);
+
+  c.fpu_owner = 0;
+  c.fpu_owner_pid = 0;
+}
+
+
+// make this thread's state live in the registers (CR0.TS must be clear, irqs off)
+static void fpu_load(Thread &thd) {
+  auto &c = core();
+
+  if (!thd.fpu.initialized) {
+    // start from a clean slate, not whatever the last thread left behind
+    fpu_scrub(c);
+    fpu_save(thd.fpu.state);
     thd.fpu.initialized = true;
-  } else {
-    if (fpu::caps.xsave) {
-      __fpu_xrstor64(thd.fpu.state);
-    } else {
-      asm volatile("fxrstor64 (%0);" ::"r"(thd.fpu.state));
-    }
+  } else if (c.fpu_owner != thd.tid || thd.fpu.last_cpu != c.id) {
+    fpu_restore(thd.fpu.state);
+  }
+
+  c.fpu_owner = thd.tid;
+  c.fpu_owner_pid = thd.pid;
+  thd.fpu.last_cpu = c.id;
+  thd.fpu.live = true;
+}
+
+
+/*
+ * #NM: a thread running with CR0.TS set touched the FPU. Give it its state,
+ * allocating it first if this is the first time it has ever used the FPU.
+ */
+void fpu::device_not_available(int i, reg_t *regs) {
+  auto thd = curthd;
+  if (thd == nullptr || thd->proc.ring != RING_USER) panic("FPU used in the kernel\n");
+
+  // allocate with interrupts on. If we are preempted first, we'll still trap again
+  size_t pages = NPAGES(arch_fpu_state_size());
+  void *state = thd->fpu.state == NULL ? phys::kalloc(pages) : NULL;
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  if (thd->fpu.state == NULL) {
+    thd->fpu.state = state;
+    state = NULL;
+  }
+  // past this point the FPU belongs to this thread until it is switched out
+  asm volatile("clts");
+  fpu_load(*thd);
+  if (thd->fpu.use_count < 255) thd->fpu.use_count++;
+  if (en) arch_enable_ints();
+
+  if (state != NULL) phys::free(state, pages);
+}
+
+
+void arch_save_fpu(struct Thread &thd) {
+  if (!thd.fpu.live) {
+    // it ran lazily, and never touched the FPU
+    thd.fpu.use_count = 0;
+    return;
   }
+
+  fpu_save(thd.fpu.state);
+  thd.fpu.live = false;
+  // wraps to zero every so often, which makes the next slice lazy again
+  if (thd.fpu.use_count >= FPU_EAGER_AFTER) thd.fpu.use_count++;
+}
+
+
+void arch_sync_fpu(struct Thread &thd) {
+  if (thd.fpu.live) fpu_save(thd.fpu.state);
+}
+
+
+void arch_restore_fpu(struct Thread &thd) {
+  auto &c = core();
+
+  if (thd.fpu.state != NULL && thd.fpu.use_count >= FPU_EAGER_AFTER) {
+    asm volatile("clts");
+    fpu_load(thd);
+    return;
+  }
+
+  // don't leave another process's state in the registers, where it could be read speculatively
+  if (c.fpu_owner != 0 && c.fpu_owner_pid != thd.pid) {
+    asm volatile("clts");
+    fpu_scrub(c);
+  }
+
+  // trap the next time the thread touches the FPU
+  write_cr0(read_cr0() | CR0_TS);
+  thd.fpu.live = false;
 }
@@ -7,6 +7,7 @@
 #include <time.h>
 #include <util.h>
 #include <x86/smp.h>
+#include <x86/fpu.h>
 #include <debug.h>
 
 // implementation of the x86 interrupt request handling system
@@ -395,6 +396,7 @@ int arch::irq::init(void) {
   isr_functions[TRAP_PGFLT] = pgfault_handle;
   isr_functions[TRAP_GPFLT] = gpf_handler;
   isr_functions[TRAP_ILLOP] = illegal_instruction_handler;
+  isr_functions[TRAP_DEVICE] = fpu::device_not_available;
 
   for (i = 32; i < 48; i++) {
     // ::irq::install(i, unknown_hardware, "Unknown Hardware");
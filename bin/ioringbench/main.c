@@ -0,0 +1,118 @@
+#include <fcntl.h>
+#include <ioring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+
+// Compare doing small reads one system call at a time against batching them
+// through an ioring, where one ioring_enter() runs a whole batch.
+//
+//   usage: ioringbench [iterations] [batch]
+
+#define FILE_SIZE (64 * 1024)
+#define READ_SIZE 512
+
+static long iterations = 100000;
+static int batch = 64;
+static const char *path = "/tmp/ioringbench";
+
+
+static unsigned long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+static void report(const char *name, unsigned long ops, unsigned long ns) {
+  double secs = ns / 1e9;
+  printf("%-20s %10lu ops %8.3fs %12.0f ops/s %8lu ns/op\n", name, ops, secs, ops / secs, ops ? ns / ops : 0);
+}
+
+
+static long offset_of(long i) { return (i * READ_SIZE) % FILE_SIZE; }
+
+
+static void bench_sync(int fd) {
+  char buf[READ_SIZE];
+  unsigned long start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    lseek(fd, offset_of(i), SEEK_SET);
+    if (read(fd, buf, READ_SIZE) != READ_SIZE) {
+      printf("sync read failed at %ld\n", i);
+      return;
+    }
+  }
+  report("lseek+read", iterations, now_ns() - start);
+}
+
+
+static void bench_ring(struct ioring *ring, int fd, int op) {
+  char *bufs = malloc(batch * READ_SIZE);
+  long done = 0;
+
+  unsigned long start = now_ns();
+  while (done < iterations) {
+    int n = 0;
+    for (; n < batch && done + n < iterations; n++) {
+      struct ioring_sqe *sqe = ioring_get_sqe(ring);
+      if (op == IORING_OP_NOP) {
+        ioring_prep_nop(sqe);
+      } else {
+        ioring_prep_read(sqe, fd, bufs + n * READ_SIZE, READ_SIZE, offset_of(done + n));
+      }
+    }
+
+    if (ioring_submit_and_wait(ring, n) < 0) {
+      perror("ioring_submit_and_wait");
+      break;
+    }
+
+    for (int i = 0; i < n; i++) {
+      struct ioring_cqe *cqe;
+      if (ioring_wait_cqe(ring, &cqe) < 0) break;
+      if (op != IORING_OP_NOP && cqe->res != READ_SIZE) printf("ring read failed: %ld\n", cqe->res);
+      ioring_cqe_seen(ring);
+    }
+    done += n;
+  }
+  report(op == IORING_OP_NOP ? "ioring nop" : "ioring read", done, now_ns() - start);
+  free(bufs);
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1) iterations = atol(argv[1]);
+  if (argc > 2) batch = atoi(argv[2]);
+  if (batch < 1) batch = 1;
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    perror(path);
+    return 1;
+  }
+  char block[READ_SIZE];
+  for (int i = 0; i < FILE_SIZE / READ_SIZE; i++) {
+    memset(block, i, sizeof(block));
+    write(fd, block, sizeof(block));
+  }
+
+  struct ioring ring;
+  if (ioring_init(&ring, batch) < 0) {
+    perror("ioring_init");
+    return 1;
+  }
+
+  printf("%ld iterations, batches of %d\n", iterations, batch);
+  bench_sync(fd);
+  bench_ring(&ring, fd, IORING_OP_READ);
+  bench_ring(&ring, fd, IORING_OP_NOP);
+
+  ioring_exit(&ring);
+  close(fd);
+  unlink(path);
+  return 0;
+}
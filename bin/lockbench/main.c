@@ -0,0 +1,227 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+// Stress the futex based pthread primitives, reporting latency and throughput.
+//
+//   usage: lockbench [threads] [iterations]
+
+static int nthreads = 4;
+static long iterations = 100000;
+
+
+static unsigned long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+static void report(const char *name, unsigned long ops, unsigned long ns) {
+  double secs = ns / 1e9;
+  printf("%-20s %10lu ops %8.3fs %12.0f ops/s %8lu ns/op\n", name, ops, secs, ops / secs, ops ? ns / ops : 0);
+}
+
+
+static void run_threads(void *(*fn)(void *), void *arg) {
+  pthread_t threads[nthreads];
+  for (int i = 0; i < nthreads; i++)
+    pthread_create(&threads[i], NULL, fn, arg);
+  for (int i = 0; i < nthreads; i++)
+    pthread_join(threads[i], NULL);
+}
+
+
+/////////////////////////////////////////////////////////////////
+//  Mutex and spinlock throughput
+/////////////////////////////////////////////////////////////////
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_spinlock_t spin;
+static volatile long counter = 0;
+
+static void *mutex_worker(void *arg) {
+  for (long i = 0; i < iterations; i++) {
+    pthread_mutex_lock(&mutex);
+    counter++;
+    pthread_mutex_unlock(&mutex);
+  }
+  return NULL;
+}
+
+static void *spin_worker(void *arg) {
+  for (long i = 0; i < iterations; i++) {
+    pthread_spin_lock(&spin);
+    counter++;
+    pthread_spin_unlock(&spin);
+  }
+  return NULL;
+}
+
+
+static void bench_counter(const char *name, void *(*fn)(void *)) {
+  counter = 0;
+  unsigned long start = now_ns();
+  run_threads(fn, NULL);
+  unsigned long ns = now_ns() - start;
+
+  report(name, counter, ns);
+  if (counter != nthreads * iterations) printf("  ERROR: counter is %ld, expected %ld\n", counter, nthreads * iterations);
+}
+
+
+/////////////////////////////////////////////////////////////////
+//  Condvar wakeup latency (ping-pong between two threads)
+/////////////////////////////////////////////////////////////////
+
+static pthread_cond_t ping_cond = PTHREAD_COND_INITIALIZER;
+static int turn = 0;
+
+static void *ponger(void *arg) {
+  long rounds = (long)arg;
+  pthread_mutex_lock(&mutex);
+  for (long i = 0; i < rounds; i++) {
+    while (turn != 1)
+      pthread_cond_wait(&ping_cond, &mutex);
+    turn = 0;
+    pthread_cond_signal(&ping_cond);
+  }
+  pthread_mutex_unlock(&mutex);
+  return NULL;
+}
+
+
+static void bench_pingpong(void) {
+  long rounds = iterations / 10;
+  pthread_t thd;
+  turn = 0;
+  pthread_create(&thd, NULL, ponger, (void *)rounds);
+
+  unsigned long start = now_ns();
+  pthread_mutex_lock(&mutex);
+  for (long i = 0; i < rounds; i++) {
+    turn = 1;
+    pthread_cond_signal(&ping_cond);
+    while (turn != 0)
+      pthread_cond_wait(&ping_cond, &mutex);
+  }
+  pthread_mutex_unlock(&mutex);
+  unsigned long ns = now_ns() - start;
+  pthread_join(thd, NULL);
+
+  // two wakeups per round trip
+  report("cond ping-pong", rounds * 2, ns);
+}
+
+
+/////////////////////////////////////////////////////////////////
+//  Broadcast: how long until every waiter is back out
+/////////////////////////////////////////////////////////////////
+
+static pthread_cond_t bcast_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t bcast_done = PTHREAD_COND_INITIALIZER;
+static int generation = 0;
+static int waiting = 0;
+static int woken = 0;
+
+static void *bcast_waiter(void *arg) {
+  long rounds = (long)arg;
+  pthread_mutex_lock(&mutex);
+  for (long i = 0; i < rounds; i++) {
+    int gen = generation;
+    waiting++;
+    pthread_cond_signal(&bcast_done);
+    while (gen == generation)
+      pthread_cond_wait(&bcast_cond, &mutex);
+    woken++;
+    pthread_cond_signal(&bcast_done);
+  }
+  pthread_mutex_unlock(&mutex);
+  return NULL;
+}
+
+
+static void bench_broadcast(void) {
+  long rounds = iterations / 100;
+  if (rounds == 0) rounds = 1;
+  pthread_t threads[nthreads];
+  generation = waiting = woken = 0;
+  for (int i = 0; i < nthreads; i++)
+    pthread_create(&threads[i], NULL, bcast_waiter, (void *)rounds);
+
+  unsigned long total = 0;
+  pthread_mutex_lock(&mutex);
+  for (long r = 0; r < rounds; r++) {
+    while (waiting < nthreads)
+      pthread_cond_wait(&bcast_done, &mutex);
+    waiting = 0;
+    woken = 0;
+
+    unsigned long start = now_ns();
+    generation++;
+    pthread_cond_broadcast(&bcast_cond);
+    while (woken < nthreads)
+      pthread_cond_wait(&bcast_done, &mutex);
+    total += now_ns() - start;
+  }
+  pthread_mutex_unlock(&mutex);
+
+  for (int i = 0; i < nthreads; i++)
+    pthread_join(threads[i], NULL);
+
+  report("cond broadcast", rounds, total);
+}
+
+
+/////////////////////////////////////////////////////////////////
+//  rwlock: mostly readers, with a writer every so often
+/////////////////////////////////////////////////////////////////
+
+static pthread_rwlock_t rwlock = PTHREAD_RWLOCK_INITIALIZER;
+static volatile long shared_a = 0, shared_b = 0;
+static volatile int torn = 0;
+
+static void *rw_worker(void *arg) {
+  for (long i = 0; i < iterations; i++) {
+    if (i % 16 == 0) {
+      pthread_rwlock_wrlock(&rwlock);
+      shared_a++;
+      shared_b++;
+      pthread_rwlock_unlock(&rwlock);
+    } else {
+      pthread_rwlock_rdlock(&rwlock);
+      if (shared_a != shared_b) torn = 1;
+      pthread_rwlock_unlock(&rwlock);
+    }
+  }
+  return NULL;
+}
+
+
+static void bench_rwlock(void) {
+  unsigned long start = now_ns();
+  run_threads(rw_worker, NULL);
+  unsigned long ns = now_ns() - start;
+
+  report("rwlock (1/16 write)", nthreads * iterations, ns);
+  if (torn) printf("  ERROR: a reader saw a half finished write\n");
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1) nthreads = atoi(argv[1]);
+  if (argc > 2) iterations = atol(argv[2]);
+  if (nthreads < 1) nthreads = 1;
+
+  printf("%d threads, %ld iterations each\n", nthreads, iterations);
+  pthread_spin_init(&spin, PTHREAD_PROCESS_PRIVATE);
+
+  bench_counter("mutex", mutex_worker);
+  bench_counter("spinlock", spin_worker);
+  bench_pingpong();
+  bench_broadcast();
+  bench_rwlock();
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+// Compare libc's thread caching malloc against liballoc, the allocator it
+// replaced, in a few allocation patterns. Each pattern runs single threaded
+// and then on every thread at once.
+//
+//   usage: mallocbench [threads] [iterations]
+
+static int nthreads = 4;
+static long iterations = 100000;
+
+
+struct allocator {
+  const char *name;
+  void *(*malloc)(size_t);
+  void (*free)(void *);
+};
+
+static struct allocator allocators[] = {
+    {"malloc", malloc, free},
+    {"liballoc", __liballoc_malloc, __liballoc_free},
+};
+
+
+static unsigned long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+static void report(const char *alloc, const char *name, int threads, unsigned long ops, unsigned long ns) {
+  double secs = ns / 1e9;
+  printf("%-9s %-16s %2dt %10lu ops %8.3fs %12.0f ops/s %8lu ns/op\n", alloc, name, threads, ops, secs, ops / secs,
+      ops ? ns / ops : 0);
+}
+
+
+static unsigned next_rand(unsigned *seed) {
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+
+/////////////////////////////////////////////////////////////////
+//  Workloads. Each returns how many malloc+free pairs it did
+/////////////////////////////////////////////////////////////////
+
+// allocate and immediately free the same small size
+static long pattern_pingpong(struct allocator *a, unsigned seed) {
+  for (long i = 0; i < iterations; i++) {
+    void *p = a->malloc(64);
+    *(volatile char *)p = 1;
+    a->free(p);
+  }
+  return iterations;
+}
+
+
+#define LIVE_SLOTS 512
+
+// keep a working set of random small objects, replacing one at a time
+static long pattern_churn(struct allocator *a, unsigned seed) {
+  void *slots[LIVE_SLOTS] = {0};
+  for (long i = 0; i < iterations; i++) {
+    int k = next_rand(&seed) % LIVE_SLOTS;
+    if (slots[k] != NULL) a->free(slots[k]);
+    size_t sz = 8 + next_rand(&seed) % 1024;
+    slots[k] = a->malloc(sz);
+    memset(slots[k], k, 8);
+  }
+  for (int k = 0; k < LIVE_SLOTS; k++)
+    if (slots[k] != NULL) a->free(slots[k]);
+  return iterations;
+}
+
+
+// like churn, but every so often with something big
+static long pattern_mixed(struct allocator *a, unsigned seed) {
+  void *slots[LIVE_SLOTS] = {0};
+  long n = iterations / 4;
+  for (long i = 0; i < n; i++) {
+    int k = next_rand(&seed) % LIVE_SLOTS;
+    if (slots[k] != NULL) a->free(slots[k]);
+    size_t sz = (next_rand(&seed) % 16 == 0) ? 32768 + next_rand(&seed) % (256 * 1024) : 16 + next_rand(&seed) % 4096;
+    slots[k] = a->malloc(sz);
+    memset(slots[k], k, 8);
+  }
+  for (int k = 0; k < LIVE_SLOTS; k++)
+    if (slots[k] != NULL) a->free(slots[k]);
+  return n;
+}
+
+
+struct pattern {
+  const char *name;
+  long (*fn)(struct allocator *, unsigned);
+};
+
+static struct pattern patterns[] = {
+    {"pingpong 64b", pattern_pingpong},
+    {"churn <1k", pattern_churn},
+    {"mixed", pattern_mixed},
+};
+
+
+struct job {
+  struct allocator *alloc;
+  struct pattern *pattern;
+  unsigned seed;
+  long ops;
+};
+
+
+static void *worker(void *arg) {
+  struct job *j = arg;
+  j->ops = j->pattern->fn(j->alloc, j->seed);
+  return NULL;
+}
+
+
+static void bench(struct allocator *a, struct pattern *p, int threads) {
+  pthread_t tids[threads];
+  struct job jobs[threads];
+
+  unsigned long start = now_ns();
+  for (int i = 0; i < threads; i++) {
+    jobs[i].alloc = a;
+    jobs[i].pattern = p;
+    jobs[i].seed = i + 1;
+    pthread_create(&tids[i], NULL, worker, &jobs[i]);
+  }
+  long ops = 0;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+    ops += jobs[i].ops;
+  }
+  unsigned long ns = now_ns() - start;
+
+  report(a->name, p->name, threads, ops, ns);
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1) nthreads = atoi(argv[1]);
+  if (argc > 2) iterations = atol(argv[2]);
+  if (nthreads < 1) nthreads = 1;
+
+  printf("%d threads, %ld iterations each\n", nthreads, iterations);
+
+  for (int p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+    for (int a = 0; a < sizeof(allocators) / sizeof(allocators[0]); a++) {
+      bench(&allocators[a], &patterns[p], 1);
+      if (nthreads > 1) bench(&allocators[a], &patterns[p], nthreads);
+    }
+  }
+
+  printf("malloc: %llu bytes mapped, %llu in use\n", malloc_total(), malloc_allocated());
+  return 0;
+}
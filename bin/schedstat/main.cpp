@@ -0,0 +1,83 @@
+#include <sys/sysbind.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chariot/schedstat.h>
+
+
+// format the lower bound of a histogram bucket (2^i ns) in a readable unit
+static void format_bucket(char *buf, size_t len, int bucket) {
+  unsigned long ns = 1UL << bucket;
+  if (ns < 1000) {
+    snprintf(buf, len, "%luns", ns);
+  } else if (ns < 1000 * 1000) {
+    snprintf(buf, len, "%luus", ns / 1000);
+  } else {
+    snprintf(buf, len, "%lums", ns / 1000 / 1000);
+  }
+}
+
+
+static void print_histogram(const char *title, unsigned long *hist) {
+  unsigned long max = 0;
+  unsigned long total = 0;
+  for (int i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+    if (hist[i] > max) max = hist[i];
+    total += hist[i];
+  }
+
+  printf("%s (%lu samples)\n", title, total);
+  if (total == 0) return;
+
+  constexpr int width = 40;
+  for (int i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+    if (hist[i] == 0) continue;
+    char lo[16];
+    format_bucket(lo, sizeof(lo), i);
+
+    int bar = (int)((hist[i] * width + max - 1) / max);
+    printf("  >= %-6s %8lu |", lo, hist[i]);
+    for (int b = 0; b < bar; b++)
+      putchar('#');
+    putchar('\n');
+  }
+}
+
+
+static int dump(int tid) {
+  struct chariot_sched_stats st;
+  memset(&st, 0, sizeof(st));
+
+  int res = sysbind_get_sched_stats(tid, &st);
+  if (res != 0) {
+    fprintf(stderr, "schedstat: could not get stats for %d\n", tid);
+    return 1;
+  }
+
+  if (tid == SCHEDSTAT_ALL) {
+    printf("all cores:\n");
+  } else {
+    printf("tid %d:\n", tid);
+  }
+
+  unsigned long avg = st.run_count ? st.runq_ns / st.run_count : 0;
+  printf("  runs: %lu, wakeups: %lu, preemptions: %lu, migrations: %lu\n", st.run_count, st.wakeups, st.preemptions,
+      st.migrations);
+  printf("  time on run queue: %lu.%03lums (avg %luns)\n", st.runq_ns / 1000 / 1000, (st.runq_ns / 1000) % 1000, avg);
+
+  print_histogram("run queue latency", st.runq_hist);
+  print_histogram("wakeup latency", st.wakeup_hist);
+  return 0;
+}
+
+
+int main(int argc, char **argv) {
+  // with no arguments, show the whole system
+  if (argc == 1) return dump(SCHEDSTAT_ALL);
+
+  int err = 0;
+  for (int i = 1; i < argc; i++) {
+    err |= dump(atoi(argv[i]));
+  }
+  return err;
+}
@@ -0,0 +1,374 @@
+#include <ctype.h>
+#include <errno.h>
+#include <sctrace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysbind.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+// Show the system calls a program makes, decoding their arguments with the
+// signatures from kernel/syscalls.toml (through <chariot/syscall_info.inc>).
+//
+//   usage: strace [-f] [-c] [-H] command [args...]
+//          strace [-c] [-H] [-t secs] -p pid
+//          strace [-H] [-t secs] -g
+//
+//   -f  follow children of the command
+//   -c  print per-syscall counts and times instead of every call
+//   -H  print latency histograms along with -c (implied by -g)
+//   -p  trace a running process, for -t seconds or until it exits
+//   -g  count every system call made on the system for -t seconds
+
+struct syscall_info {
+  const char *name;
+  const char *ret;
+  int flags;
+  int str;
+  int nargs;
+  const char *args[6];
+};
+
+static struct syscall_info info[SCTRACE_NR];
+
+static int follow = 0;
+static int summary = 0;
+static int histograms = 0;
+static int seconds = -1;
+
+// which events to show. See trace_command()
+static int skip_pid = -1;
+static int only_pid = -1;
+
+// calls we have seen, for -c over events
+static struct sctrace_stat counts[SCTRACE_NR];
+
+
+static void load_info(void) {
+#define __SYSCALL_INFO(num, nm, rt, fl, st, na, ...) info[num] = (struct syscall_info){#nm, rt, fl, st, na, {__VA_ARGS__}};
+#include <chariot/syscall_info.inc>
+#undef __SYSCALL_INFO
+}
+
+
+static long long now_ms(void) { return sysbind_gettime_microsecond() / 1000; }
+
+
+// "const char * path" -> does the type (everything before the name) match
+static int type_is(const char *arg, const char *type) {
+  size_t len = strlen(type);
+  return strncmp(arg, type, len) == 0 && arg[len] == ' ';
+}
+
+
+static void print_string(const char *s) {
+  // it may well have been cut off
+  int truncated = strlen(s) == SCTRACE_STRLEN - 1;
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\') {
+      printf("\\%c", *s);
+    } else if (*s == '\n') {
+      printf("\\n");
+    } else if (isprint(*s)) {
+      putchar(*s);
+    } else {
+      printf("\\x%02x", (unsigned char)*s);
+    }
+  }
+  printf(truncated ? "\"..." : "\"");
+}
+
+
+static void print_arg(struct sctrace_event *ev, int i) {
+  const char *arg = info[ev->num].args[i];
+  unsigned long val = ev->args[i];
+
+  if (strchr(arg, '*') != NULL) {
+    if (i == info[ev->num].str && val != 0) {
+      print_string(ev->str);
+    } else if (val == 0) {
+      printf("NULL");
+    } else {
+      printf("%#lx", val);
+    }
+  } else if (type_is(arg, "int") || type_is(arg, "short")) {
+    printf("%d", (int)val);
+  } else if (type_is(arg, "long") || type_is(arg, "long long") || type_is(arg, "ssize_t") || type_is(arg, "off_t")) {
+    printf("%ld", (long)val);
+  } else {
+    printf("%lu", val);
+  }
+}
+
+
+static void print_event(struct sctrace_event *ev) {
+  struct syscall_info *sc = &info[ev->num];
+  if (follow) printf("[pid %d] ", ev->pid);
+
+  printf("%s(", sc->name ? sc->name : "???");
+  for (int i = 0; i < sc->nargs; i++) {
+    if (i != 0) printf(", ");
+    print_arg(ev, i);
+  }
+  printf(")");
+
+  if ((ev->flags & SCINFO_NORETURN) || strcmp(sc->ret, "void") == 0) {
+    printf(" = ?");
+  } else if (strchr(sc->ret, '*') != NULL) {
+    printf(" = %#lx", (unsigned long)ev->ret);
+  } else if (ev->ret < 0 && ev->ret >= -4095) {
+    printf(" = -1 (%s)", strerror(-ev->ret));
+  } else {
+    printf(" = %ld", ev->ret);
+  }
+
+  if (!(ev->flags & SCINFO_NORETURN)) printf(" <%lu.%06lus>", ev->ns / 1000000000, (ev->ns / 1000) % 1000000);
+  putchar('\n');
+}
+
+
+static void count_event(struct sctrace_event *ev) {
+  struct sctrace_stat *s = &counts[ev->num];
+  s->count++;
+  if (ev->ret < 0 && ev->ret >= -4095 && strcmp(info[ev->num].ret, "void") != 0) s->errors++;
+  s->total_ns += ev->ns;
+  if (ev->ns > s->max_ns) s->max_ns = ev->ns;
+
+  int b = ev->ns ? 63 - __builtin_clzll(ev->ns) : 0;
+  s->hist[b < SCTRACE_BUCKETS ? b : SCTRACE_BUCKETS - 1]++;
+}
+
+
+// format the lower bound of a histogram bucket (2^i ns) in a readable unit
+static void format_bucket(char *buf, size_t len, int bucket) {
+  unsigned long ns = 1UL << bucket;
+  if (ns < 1000) {
+    snprintf(buf, len, "%luns", ns);
+  } else if (ns < 1000 * 1000) {
+    snprintf(buf, len, "%luus", ns / 1000);
+  } else {
+    snprintf(buf, len, "%lums", ns / 1000 / 1000);
+  }
+}
+
+
+static void print_histogram(unsigned long *hist) {
+  unsigned long max = 0;
+  for (int i = 0; i < SCTRACE_BUCKETS; i++)
+    if (hist[i] > max) max = hist[i];
+  if (max == 0) return;
+
+  const int width = 40;
+  for (int i = 0; i < SCTRACE_BUCKETS; i++) {
+    if (hist[i] == 0) continue;
+    char lo[16];
+    format_bucket(lo, sizeof(lo), i);
+
+    int bar = (int)((hist[i] * width + max - 1) / max);
+    printf("    >= %-6s %8lu |", lo, hist[i]);
+    for (int b = 0; b < bar; b++)
+      putchar('#');
+    putchar('\n');
+  }
+}
+
+
+static void print_summary(struct sctrace_stat *stats) {
+  // biggest total time first
+  int order[SCTRACE_NR];
+  int n = 0;
+  for (int i = 0; i < SCTRACE_NR; i++)
+    if (stats[i].count != 0) order[n++] = i;
+  for (int i = 1; i < n; i++) {
+    for (int j = i; j > 0 && stats[order[j]].total_ns > stats[order[j - 1]].total_ns; j--) {
+      int t = order[j];
+      order[j] = order[j - 1];
+      order[j - 1] = t;
+    }
+  }
+
+  unsigned long total = 0;
+  for (int i = 0; i < n; i++)
+    total += stats[order[i]].total_ns;
+
+  printf("%% time     seconds  usecs/call     max usecs     calls    errors syscall\n");
+  printf("------ ----------- ----------- ------------- --------- --------- ----------------\n");
+  for (int i = 0; i < n; i++) {
+    struct sctrace_stat *s = &stats[order[i]];
+    double pct = total ? 100.0 * s->total_ns / total : 0;
+    printf("%6.2f %11.6f %11lu %13lu %9lu %9lu %s\n", pct, s->total_ns / 1e9, s->total_ns / s->count / 1000,
+        s->max_ns / 1000, s->count, s->errors, info[order[i]].name ? info[order[i]].name : "???");
+    if (histograms) print_histogram(s->hist);
+  }
+}
+
+
+static void handle_event(struct sctrace_event *ev) {
+  if (ev->pid == skip_pid) return;
+  if (!follow && only_pid != -1 && ev->pid != only_pid) return;
+
+  if (summary) {
+    count_event(ev);
+  } else {
+    print_event(ev);
+  }
+}
+
+
+// read whatever events show up in the next `ms` milliseconds. Returns how many
+static int pump(int fd, int ms) {
+  struct await_target t = {0};
+  t.fd = fd;
+  t.awaiting = AWAITFS_READ;
+  if (sysbind_awaitfs(&t, 1, 0, now_ms() + ms) < 0) return 0;
+
+  struct sctrace_event evs[32];
+  ssize_t n = read(fd, evs, sizeof(evs));
+  if (n <= 0) return 0;
+
+  n /= sizeof(struct sctrace_event);
+  for (int i = 0; i < n; i++)
+    handle_event(&evs[i]);
+  return n;
+}
+
+
+static int trace_command(char **argv) {
+  // trace ourselves until the fork, so the child is traced from its very first
+  // system call. Its children are traced too, but only shown with -f
+  int fd = sctrace(0, SCTRACE_EVENTS | SCTRACE_INHERIT);
+  if (fd < 0) {
+    perror("sctrace");
+    return 1;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fd);
+    execvp(argv[0], (const char **)argv);
+    perror(argv[0]);
+    exit(127);
+  }
+  sctrace(0, 0);
+  // the fork (and anything else we did) isn't interesting
+  skip_pid = getpid();
+  only_pid = pid;
+
+  int status = 0;
+  int exited = 0;
+  while (1) {
+    int got = pump(fd, 100);
+    // once it's gone, keep going until the events run dry
+    if (exited && got == 0) break;
+    if (!exited && waitpid(pid, &status, WNOHANG) == pid) exited = 1;
+  }
+  close(fd);
+
+  if (summary) print_summary(counts);
+  fprintf(stderr, "+++ exited with %d +++\n", WEXITSTATUS(status));
+  return WEXITSTATUS(status);
+}
+
+
+// sctrace_stats() doubles as a way to see if the process is still there
+static int alive(int pid) {
+  struct sctrace_stat s;
+  return sctrace_stats(pid, &s, 1) >= 0 || errno != ESRCH;
+}
+
+
+static int trace_pid(int pid) {
+  long long until = seconds < 0 ? -1 : now_ms() + seconds * 1000LL;
+
+  // -c on a running process just uses the kernel's counts
+  int fd = sctrace(pid, summary ? SCTRACE_STATS : SCTRACE_EVENTS | (follow ? SCTRACE_INHERIT : 0));
+  if (fd < 0) {
+    perror("sctrace");
+    return 1;
+  }
+
+  while (until < 0 || now_ms() < until) {
+    if (!alive(pid)) break;
+    if (summary) {
+      usleep(100 * 1000);
+    } else {
+      pump(fd, 100);
+    }
+  }
+
+  if (summary) {
+    static struct sctrace_stat stats[SCTRACE_NR];
+    if (sctrace_stats(pid, stats, SCTRACE_NR) >= 0) print_summary(stats);
+  } else {
+    while (pump(fd, 0) > 0) {
+    }
+    close(fd);
+  }
+  sctrace(pid, 0);
+  return 0;
+}
+
+
+static int trace_system(void) {
+  static struct sctrace_stat stats[SCTRACE_NR];
+
+  if (sctrace(SCTRACE_SYSTEM, SCTRACE_STATS) < 0) {
+    perror("sctrace");
+    return 1;
+  }
+  usleep((seconds < 0 ? 5 : seconds) * 1000 * 1000);
+  int n = sctrace_stats(SCTRACE_SYSTEM, stats, SCTRACE_NR);
+  sctrace(SCTRACE_SYSTEM, 0);
+  if (n < 0) {
+    perror("sctrace_stats");
+    return 1;
+  }
+
+  histograms = 1;
+  print_summary(stats);
+  return 0;
+}
+
+
+static void usage(void) {
+  fprintf(stderr, "usage: strace [-f] [-c] [-H] command [args...]\n");
+  fprintf(stderr, "       strace [-c] [-H] [-t secs] -p pid\n");
+  fprintf(stderr, "       strace [-H] [-t secs] -g\n");
+  exit(1);
+}
+
+
+int main(int argc, char **argv) {
+  int pid = -1;
+  int system = 0;
+
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    const char *opt = argv[i];
+    if (!strcmp(opt, "-f")) {
+      follow = 1;
+    } else if (!strcmp(opt, "-c")) {
+      summary = 1;
+    } else if (!strcmp(opt, "-H")) {
+      histograms = 1;
+    } else if (!strcmp(opt, "-g")) {
+      system = 1;
+    } else if (!strcmp(opt, "-p") && i + 1 < argc) {
+      pid = atoi(argv[++i]);
+    } else if (!strcmp(opt, "-t") && i + 1 < argc) {
+      seconds = atoi(argv[++i]);
+    } else {
+      usage();
+    }
+  }
+
+  load_info();
+
+  if (system) return trace_system();
+  if (pid != -1) return trace_pid(pid);
+  if (i == argc) usage();
+  return trace_command(argv + i);
+}
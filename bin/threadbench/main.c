@@ -0,0 +1,85 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+// Measure how long it takes to create and join threads that do (almost)
+// nothing, which is mostly the cost of thread creation and teardown.
+//
+//   usage: threadbench [threads] [iterations]
+
+static int nthreads = 4;
+static long iterations = 2000;
+
+
+static unsigned long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+
+static void report(const char *name, unsigned long ops, unsigned long ns) {
+  double secs = ns / 1e9;
+  printf("%-24s %8lu threads %8.3fs %10.0f threads/s %8lu ns/thread\n", name, ops, secs, ops / secs,
+      ops ? ns / ops : 0);
+}
+
+
+static void *empty(void *arg) { return arg; }
+
+
+// touch the FPU, so the thread has to get FPU state
+static void *use_fpu(void *arg) {
+  volatile double d = (long)arg;
+  d = d * 1.5;
+  return (void *)(long)d;
+}
+
+
+// one thread at a time, create then join
+static void bench_serial(const char *name, void *(*fn)(void *)) {
+  unsigned long start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    pthread_t t;
+    void *res = NULL;
+    if (pthread_create(&t, NULL, fn, (void *)i) != 0) {
+      printf("  ERROR: pthread_create failed after %ld threads\n", i);
+      return;
+    }
+    pthread_join(t, &res);
+  }
+  report(name, iterations, now_ns() - start);
+}
+
+
+// create `nthreads` at a time, then join them all
+static void bench_batch(const char *name, void *(*fn)(void *)) {
+  pthread_t threads[nthreads];
+  long rounds = iterations / nthreads;
+  if (rounds < 1) rounds = 1;
+
+  unsigned long start = now_ns();
+  for (long r = 0; r < rounds; r++) {
+    for (int i = 0; i < nthreads; i++)
+      pthread_create(&threads[i], NULL, fn, NULL);
+    for (int i = 0; i < nthreads; i++)
+      pthread_join(threads[i], NULL);
+  }
+  report(name, rounds * nthreads, now_ns() - start);
+}
+
+
+int main(int argc, char **argv) {
+  if (argc > 1) nthreads = atoi(argv[1]);
+  if (argc > 2) iterations = atol(argv[2]);
+  if (nthreads < 1) nthreads = 1;
+
+  printf("%d threads per batch, %ld threads per test\n", nthreads, iterations);
+
+  bench_serial("create/join", empty);
+  bench_serial("create/join (fpu)", use_fpu);
+  bench_batch("batched create/join", empty);
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <chariot/cpu_usage.h>
+#include <multicall.h>
 #include <string.h>
 
 
@@ -18,11 +19,22 @@ int main(void) {
   struct core* cores = new core[ncores];
   memset(cores, 0, sizeof(core) * ncores);
 
+  // read every core's usage in one system call
+  auto* usage = new chariot_core_usage[ncores];
+  auto* calls = new multicall_entry[ncores];
+  for (int core = 0; core < ncores; core++) {
+    multicall_prep(&calls[core], SYS_get_core_usage, core, (unsigned long)&usage[core], 0, 0, 0, 0);
+  }
+
   while (1) {
+    int ncalls = ncores < MULTICALL_MAX ? ncores : MULTICALL_MAX;
+    for (int i = 0; i < ncores; i += ncalls) {
+      sysbind_multicall(calls + i, ncores - i < ncalls ? ncores - i : ncalls, 0);
+    }
+
     for (int core = 0; core < ncores; core++) {
-      struct chariot_core_usage curr;
+      struct chariot_core_usage curr = usage[core];
       auto& prev = cores[core].prev;
-      sysbind_get_core_usage(core, &curr);
 
       struct chariot_core_usage delta;
       delta.idle_ticks = curr.idle_ticks - prev.idle_ticks;
@@ -47,6 +59,8 @@ int main(void) {
     usleep(500 * 1000);
   }
 
+  delete[] calls;
+  delete[] usage;
   delete[] cores;
 
 
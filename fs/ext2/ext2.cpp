@@ -162,7 +162,7 @@ bool ext2::FileSystem::write_inode(ext2_inode_info &src, u32 inode) {
 #define BLOCKBIT(bg_buffer, n) (BLOCKBYTE(bg_buffer, n) & SETBIT(n))
 
 long ext2::FileSystem::allocate_inode(void) {
-  scoped_lock l(bglock);
+  scoped_mutex l(bglock);
 
   int bgs = blockgroups;
   int res = -1;
@@ -205,7 +205,7 @@ long ext2::FileSystem::allocate_inode(void) {
 
 
 uint32_t ext2::FileSystem::balloc(void) {
-  scoped_lock l(bglock);
+  scoped_mutex l(bglock);
 
   unsigned int block_no = 0;
 
@@ -280,7 +280,7 @@ ck::ref<fs::Node> ext2::FileSystem::get_root(void) { return root; }
 
 ck::ref<fs::Node> ext2::FileSystem::get_inode(u32 index) {
   TRACE;
-  scoped_lock lck(m_lock);
+  scoped_mutex lck(m_lock);
   if (inodes[index] == nullptr) {
     inodes[index] = create_inode(index);
   }
@@ -1,8 +1,10 @@
 #include <dev/driver.h>
+#include <dirent.h>
 #include <errno.h>
 #include <fs.h>
 #include <fs/ext2.h>
 #include <mm.h>
+#include <uio.h>
 #include <util.h>
 
 #define EXT2_ADDR_PER_BLOCK(node) (node->block_size() / sizeof(u32))
@@ -464,7 +466,7 @@ struct Ext2VMObject final : public mm::VMObject {
 
 
   struct block::Buffer *bget(uint32_t n) {
-    scoped_lock l(m_lock);
+    scoped_mutex l(m_lock);
 
     struct block::Buffer *buf = buffers[n];
 
@@ -502,7 +504,7 @@ struct Ext2VMObject final : public mm::VMObject {
 
  private:
   // offset -> block
-  spinlock m_lock;
+  mutex m_lock;
   ck::map<uint32_t, block::Buffer *> buffers;
   ck::ref<fs::Node> m_ino;
   off_t m_off = 0;
@@ -533,6 +535,83 @@ ssize_t ext2::FileNode::write(fs::File &f, const char *buf, size_t count) {
   return nwrite;
 }
 
+
+// run each buffer through ext2_raw_rw at consecutive offsets, extending the
+// file (at most) once up front for writes
+static ssize_t ext2_raw_rwv(fs::Node &node, const struct iovec *iov, int iovcnt, off_t offset, bool write) {
+  auto &ino = downcast(node);
+  if (write) {
+    off_t total_needed = offset;
+    for (int i = 0; i < iovcnt; i++)
+      total_needed += iov[i].iov_len;
+    if (ino.size() < total_needed) {
+      int tres = truncate(ino, total_needed);
+      if (tres < 0) return tres;
+    }
+  }
+
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    if (!write && offset + total >= ino.size()) break;
+    ssize_t n = ext2_raw_rw(node, (char *)iov[i].iov_base, iov[i].iov_len, offset + total, write);
+    if (n < 0) return total ? total : n;
+    total += n;
+    if (n < iov[i].iov_len) break;
+  }
+  return total;
+}
+
+ssize_t ext2::FileNode::readv(fs::File &f, const struct iovec *iov, int iovcnt, off_t off) {
+  ssize_t nread = ext2_raw_rwv(*this, iov, iovcnt, off == -1 ? f.offset() : off, false);
+  if (nread > 0 && off == -1) {
+    f.seek(nread, SEEK_CUR);
+  }
+  return nread;
+}
+
+ssize_t ext2::FileNode::writev(fs::File &f, const struct iovec *iov, int iovcnt, off_t off) {
+  ssize_t nwrite = ext2_raw_rwv(*this, iov, iovcnt, off == -1 ? f.offset() : off, true);
+  if (nwrite > 0 && off == -1) {
+    f.seek(nwrite, SEEK_CUR);
+  }
+  return nwrite;
+}
+
+// hand the actor each block's page from the block cache, the same buffers
+// ext2_raw_rw copies out of
+ssize_t ext2::FileNode::splice_read(fs::File &f, off_t off, size_t len, fs::splice_actor actor) {
+  ext2::FileSystem *efs = static_cast<ext2::FileSystem *>(sb.get());
+  auto bsize = efs->block_size;
+  off_t pos = off == -1 ? f.offset() : off;
+
+  ssize_t total = 0;
+  while (total < len && pos + total < size()) {
+    off_t at = pos + total;
+    u32 blk = block_from_index(*this, at / bsize);
+    if (blk == 0) return total ? total : -EIO;
+
+    size_t offset_into_block = at % bsize;
+    size_t n = min(min(bsize - offset_into_block, len - total), size() - at);
+
+    ck::ref<mm::Page> page;
+    {
+      auto buf_bb = bref::get(*efs->bdev, blk);
+      page = buf_bb->page();
+    }
+
+    ssize_t took = actor(page, offset_into_block, n);
+    if (took < 0) {
+      if (total == 0) return took;
+      break;
+    }
+    total += took;
+    if (took < n) break;
+  }
+
+  if (off == -1 && total > 0) f.seek(total, SEEK_CUR);
+  return total;
+}
+
 int ext2::FileNode::resize(fs::File &, size_t) {
   UNIMPL();
   return -ENOTIMPL;
@@ -603,6 +682,78 @@ ck::vec<fs::DirectoryEntry *> ext2::DirectoryNode::dirents(void) {
   return res;
 }
 
+static int ext2_dirent_type(uint8_t ft) {
+  switch (ft) {
+    case EXT2_FT_REG_FILE:
+      return DT_REG;
+    case EXT2_FT_DIR:
+      return DT_DIR;
+    case EXT2_FT_CHRDEV:
+      return DT_CHR;
+    case EXT2_FT_BLKDEV:
+      return DT_BLK;
+    case EXT2_FT_FIFO:
+      return DT_FIFO;
+    case EXT2_FT_SOCK:
+      return DT_SOCK;
+    case EXT2_FT_SYMLINK:
+      return DT_LNK;
+  }
+  return DT_UNKNOWN;
+}
+
+// Read the entries straight off the disk, a block at a time, instead of going
+// through ensure() (which would load the inode of every entry). The offsets
+// are byte offsets into the directory. Entries never span blocks, so each
+// block is walked from its start, which also makes an offset that isn't the
+// start of an entry (from a seek) safe: it carries on from the next one
+off_t ext2::DirectoryNode::getdents(fs::File &, off_t off, fs::dirent_actor actor) {
+  ext2::FileSystem *efs = static_cast<ext2::FileSystem *>(sb.get());
+  size_t bsize = efs->block_size;
+  // without the filetype feature, the type byte is the top of the name length
+  bool typed = efs->sb.s_feature_incompat & EXT2_FEATURE_INCOMPAT_FILETYPE;
+
+  char *block = (char *)malloc(bsize);
+  // keep a concurrent create or unlink from handing us a torn entry
+  scoped_lock l = lock();
+  while (off < (off_t)size()) {
+    off_t base = off - (off % bsize);
+    ssize_t n = ext2_raw_rw(*this, block, bsize, base, false);
+    if (n <= 0) {
+      off = n < 0 ? n : size();
+      break;
+    }
+
+    bool full = false;
+    for (size_t pos = 0; pos < (size_t)n;) {
+      auto *entry = (ext2_dir *)(block + pos);
+      if (entry->size < sizeof(ext2_dir) || pos + entry->size > (size_t)n ||
+          sizeof(ext2_dir) + entry->namelength > entry->size) {
+        KWARN("ext2: bad directory entry in inode %d at %ld\n", inode(), (long)(base + pos));
+        free(block);
+        return -EIO;
+      }
+
+      off_t next = base + pos + entry->size;
+      if (base + (off_t)pos >= off && entry->inode != 0) {
+        int type = typed ? ext2_dirent_type(entry->reserved) : DT_UNKNOWN;
+        if (!actor(entry->name, entry->namelength, entry->inode, type, next)) {
+          full = true;
+          break;
+        }
+      }
+      pos += entry->size;
+      if (next > off) off = next;
+    }
+    if (full) break;
+    // a short read leaves the rest of the block behind
+    if (off < base + (off_t)bsize) off = base + bsize;
+  }
+
+  free(block);
+  return off;
+}
+
 fs::DirectoryEntry *ext2::DirectoryNode::get_direntry(ck::string name) {
   EXT_DEBUG("get_direntry %s\n", name.get());
   ensure();
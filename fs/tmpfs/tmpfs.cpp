@@ -2,6 +2,7 @@
 #include <module.h>
 #include <fs/vfs.h>
 #include <errno.h>
+#include <uio.h>
 #include "ck/ptr.h"
 #include "fs.h"
 
@@ -17,7 +18,9 @@ int tmpfs::FileNode::seek_check(fs::File &, off_t old_off, off_t new_off) {
 
 ssize_t tmpfs::FileNode::read(fs::File &f, char *buf, size_t count) {
   scoped_lock l(m_lock);
-  return access(f, (void *)buf, count, false);
+  auto n = access(f.offset(), (void *)buf, count, false);
+  if (n > 0) f.seek(n, SEEK_CUR);
+  return n;
 }
 
 
@@ -25,27 +28,106 @@ ssize_t tmpfs::FileNode::write(fs::File &f, const char *buf, size_t count) {
   scoped_lock l(m_lock);
   auto end = f.offset() + count;
   // try to resize the file to have enough space
-  if (int err = resize_r(f, end); err != 0) {
-    return err;
+  if (end > size()) {
+    if (int err = resize_r(f, end); err != 0) {
+      return err;
+    }
   }
-  return access(f, (void *)buf, count, true);
+  auto n = access(f.offset(), (void *)buf, count, true);
+  if (n > 0) f.seek(n, SEEK_CUR);
+  return n;
 }
 
 
-ssize_t tmpfs::FileNode::access(fs::File &f, void *dst, size_t size, bool write) {
-  if (this->size() == 0) return 0;
+ssize_t tmpfs::FileNode::readv(fs::File &f, const struct iovec *iov, int iovcnt, off_t off) {
+  scoped_lock l(m_lock);
+  off_t pos = off == -1 ? f.offset() : off;
 
-  size_t byte_offset = f.offset();
-  long to_access = size;
-  // the offset within the current page
-  ssize_t offset = byte_offset % PGSIZE;
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    auto n = access(pos + total, iov[i].iov_base, iov[i].iov_len, false);
+    total += n;
+    if (n < iov[i].iov_len) break;
+  }
+
+  if (off == -1 && total > 0) f.seek(total, SEEK_CUR);
+  return total;
+}
+
+
+ssize_t tmpfs::FileNode::writev(fs::File &f, const struct iovec *iov, int iovcnt, off_t off) {
+  scoped_lock l(m_lock);
+  off_t pos = off == -1 ? f.offset() : off;
+
+  size_t count = 0;
+  for (int i = 0; i < iovcnt; i++)
+    count += iov[i].iov_len;
+
+  // grow the file once for the whole write
+  if (pos + count > size()) {
+    if (int err = resize_r(f, pos + count); err != 0) {
+      return err;
+    }
+  }
+
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    auto n = access(pos + total, iov[i].iov_base, iov[i].iov_len, true);
+    total += n;
+    if (n < iov[i].iov_len) break;
+  }
+
+  if (off == -1 && total > 0) f.seek(total, SEEK_CUR);
+  return total;
+}
+
+
+ssize_t tmpfs::FileNode::splice_read(fs::File &f, off_t off, size_t len, fs::splice_actor actor) {
+  off_t pos = off == -1 ? f.offset() : off;
+
+  ssize_t total = 0;
+  while (total < len) {
+    ck::ref<mm::Page> page;
+    size_t pgoff = (pos + total) % PGSIZE;
+    size_t n = 0;
+    {
+      // the actor may block, so only hold the lock while finding the page
+      scoped_lock l(m_lock);
+      if (pos + total >= size()) break;
+      page = get_page((pos + total) / PGSIZE);
+      n = min(min(PGSIZE - pgoff, len - total), size() - (pos + total));
+    }
+    if (!page) break;
+
+    ssize_t took = actor(page, pgoff, n);
+    if (took < 0) {
+      if (total == 0) return took;
+      break;
+    }
+    total += took;
+    if (took < n) break;
+  }
+
+  if (off == -1 && total > 0) f.seek(total, SEEK_CUR);
+  return total;
+}
+
+
+// copy between `dst` and the file at byte offset `byte_offset`, without
+// touching any file's offset. Returns how much was copied
+ssize_t tmpfs::FileNode::access(off_t byte_offset, void *dst, size_t size, bool write) {
+  if (byte_offset >= this->size()) return 0;
 
-  char *udata = (char *)dst;
   // write(13)
   // read(4096) -> read(13)
   if (this->size() <= byte_offset + size) {
-    size = this->size() - byte_offset;  // ??
+    size = this->size() - byte_offset;
   }
+  long to_access = size;
+  // the offset within the current page
+  ssize_t offset = byte_offset % PGSIZE;
+
+  char *udata = (char *)dst;
 
   for (off_t blk = byte_offset / PGSIZE; to_access > 0; blk++) {
     if (m_pages.size() < blk) break;
@@ -74,10 +156,7 @@ ssize_t tmpfs::FileNode::access(fs::File &f, void *dst, size_t size, bool write)
     if (to_access <= 0) break;
   }
 
-  auto did_access = size - to_access;
-  f.seek(did_access, SEEK_CUR);
-
-  return did_access;
+  return size - to_access;
 }
 int tmpfs::FileNode::resize(fs::File &file, size_t new_size) {
   scoped_lock l(m_lock);
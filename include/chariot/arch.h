@@ -107,8 +107,10 @@ int arch_generate_backtrace(off_t virt_ebp, off_t *buf, size_t bufsz);
 
 void arch_sigreturn(void *ucontext);
 void arch_flush_mmu(void);
-void arch_save_fpu(struct Thread &);
-void arch_restore_fpu(struct Thread &);
+void arch_save_fpu(struct Thread &);     // the thread is being switched out
+void arch_restore_fpu(struct Thread &);  // the thread is being switched in
+void arch_sync_fpu(struct Thread &);     // write the running thread's live FPU state to its save area
+size_t arch_fpu_state_size(void);        // how big a thread's FPU save area is
 unsigned long arch_read_timestamp(void);
 
 
@@ -121,7 +123,8 @@ unsigned long arch_seconds_since_boot(void);
 
 void arch_thread_create_callback();
 
-// Set a timer interrupt for `nanos` nanoseconds in the future
+// Make sure a timer interrupt happens no later than `nanos` nanoseconds in the
+// future. An earlier deadline that is already armed is left alone.
 int arch_set_timer(uint64_t nanos);
 int arch_stop_timer();
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "awaitfs_types.h"
+
+// An awaitset is a persistent version of awaitfs(). Files are added to the
+// set once, and stay registered with their wait queues until they are
+// removed. A wakeup on one of those queues puts the file on the set's ready
+// list, so awaitset_wait() only ever looks at files that might be ready,
+// and hands back as many of them as fit in one call.
+//
+// Watches are level triggered by default: a file is reported on every wait
+// for as long as it is ready. AWAITSET_EDGE reports it once per wakeup
+// instead, and AWAITSET_ONESHOT disarms the watch after it has been reported
+// once (re-arm it with AWAITSET_MOD).
+//
+// A watch goes away when it is removed, when the set is closed, or when the
+// fd it was added under is closed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// awaitset_ctl operations
+#define AWAITSET_ADD 1
+#define AWAITSET_MOD 2
+#define AWAITSET_DEL 3
+
+// flags that may be or'd into awaitset_event.events for AWAITSET_ADD/MOD
+#define AWAITSET_EDGE (1 << 16)
+#define AWAITSET_ONESHOT (1 << 17)
+
+struct awaitset_event {
+  // AWAITFS_* (and AWAITSET_*) to watch for, or the events that occurred
+  int events;
+  // filled in by awaitset_wait
+  int fd;
+  // handed back untouched by awaitset_wait
+  void *data;
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#if defined(KERNEL) && defined(__cplusplus)
+
+struct Process;
+namespace fs {
+  class File;
+}
+
+// `p` closed `fd`, which referred to `file`. Drops the watches it added on it
+void awaitset_closed(Process &p, int fd, fs::File &file);
+
+#endif
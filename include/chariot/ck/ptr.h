@@ -330,14 +330,27 @@ namespace ck {
       __atomic_add_fetch(&m_ref_count, 1, __ATOMIC_ACQ_REL);
     }
 
+    // take a reference unless the last one is already gone. For lookups that
+    // race with the final release, where the memory outlives the object (see
+    // Process::get_fd)
+    bool ref_try_retain() {
+      unsigned int count = __atomic_load_n(&m_ref_count, __ATOMIC_RELAXED);
+      do {
+        if (count == 0) return false;
+      } while (!__atomic_compare_exchange_n(&m_ref_count, &count, count + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+      return true;
+    }
+
     int ref_count() const { return m_ref_count; }
 
     void ref_release() {
-      deref_base();
-      if (m_ref_count == 0) {
+      assert(m_ref_count);
+      // decide on the count we left behind, not a second read of it
+      unsigned int count = __atomic_sub_fetch(&m_ref_count, 1, __ATOMIC_ACQ_REL);
+      if (count == 0) {
         call_will_be_destroyed_if_present(static_cast<T*>(this));
         delete static_cast<T*>(this);
-      } else if (m_ref_count == 1) {
+      } else if (count == 1) {
         call_one_ref_left_if_present(static_cast<T*>(this));
       }
     }
@@ -368,11 +381,13 @@ namespace ck {
     int ref_count() const { return m_ref_count; }
 
     void ref_release() {
-      deref_base();
-      if (m_ref_count == 0) {
+      assert(m_ref_count);
+      // decide on the count we left behind, not a second read of it
+      unsigned int count = __atomic_sub_fetch(&m_ref_count, 1, __ATOMIC_ACQ_REL);
+      if (count == 0) {
         call_will_be_destroyed_if_present(static_cast<T*>(this));
         delete static_cast<T*>(this);
-      } else if (m_ref_count == 1) {
+      } else if (count == 1) {
         call_one_ref_left_if_present(static_cast<T*>(this));
       }
     }
@@ -10,6 +10,8 @@
 #include <fwd.h>
 #include <list_head.h>
 #include <realtime.h>
+#include <schedstat.h>
+#include <xcall.h>
 
 #ifdef CONFIG_X86
 #include <x86/apic.h>
@@ -29,20 +31,9 @@ struct kstat_cpu {
 
 
 
-typedef void (*xcall_t)(void *);
-
-struct xcall_command {
-  // the function to be called on the cpu
-  xcall_t fn;
-  // the single argument to the function when called.
-  void *arg;
-  // decremented when an xcall is completed
-  int *count = nullptr;
-};
-
-
 struct sleep_waiter;
 struct ThreadContext;
+struct rcu_head;
 
 
 namespace cpu {
@@ -62,6 +53,8 @@ namespace cpu {
     bool in_sched = false;    // the CPU has reached the scheduler
     bool timekeeper = false;  // this CPU does timekeeping stuff.
     uint64_t preempt_count = 0;
+    unsigned long rcu_qs = 0;                 // how many quiescent states this core has passed through
+    struct rcu_head *rcu_callbacks = nullptr;  // callbacks queued by call_rcu on this core
     rt::Scheduler local_scheduler;
 
     // the intrusive linked list into the list of all cores
@@ -69,8 +62,12 @@ namespace cpu {
     struct list_head cores;
 
     struct kstat_cpu kstat;
+    // scheduler latency statistics for every thread that ran on this core
+    struct chariot_sched_stats sched_stats = {};
 
     unsigned long ticks_per_second = 0;
+    // the (arch specific) counter value the one-shot timer is armed for, or ~0 if it isn't
+    unsigned long next_timer = ~0UL;
 
     spinlock sleepers_lock;
     struct sleep_waiter *sleepers = NULL;
@@ -78,23 +75,27 @@ namespace cpu {
 
     ck::ref<Thread> current_thread;
 
-    // locked by the source core, unlocked by the target core
-    spinlock xcall_lock;
-    struct xcall_command xcall_command;
+    // commands waiting to be run on this core, pushed by any core (newest first)
+    struct xcall_command *xcall_queue = nullptr;
+    unsigned long xcalls_run = 0;  // how many commands this core has run
+    unsigned long xcall_ipis = 0;  // how many IPIs were sent to this core for them
+
+    // kernel stacks freed on this core, handed to the next threads created here (irqs off)
+    void *kstack_cache[8];
+    int kstack_cached = 0;
 
 
 #ifdef CONFIG_X86
     // The APIC and the IOApic for this core
     x86::Apic apic;
     x86::IOApic ioapic;
+
+    // the thread (and its process) whose FPU state is in this core's registers, or 0
+    long fpu_owner = 0;
+    long fpu_owner_pid = 0;
 #endif
 
     Core(void);
-
-    void prep_xcall(xcall_t func, void *arg, int *count) {
-      xcall_lock.lock();
-      xcall_command = {func, arg, count};
-    }
   };
 
   extern struct list_head cores;
@@ -126,9 +127,17 @@ namespace cpu {
     list_for_each_entry(core, &cpu::cores, cores) { cb(core); }
   }
 
+  // run `func(arg)` on a core (or every core, if core == -1), and wait for
+  // them all to finish
   void xcall(int core, xcall_t func, void *arg);
   inline void xcall_all(xcall_t func, void *arg) { return cpu::xcall(-1, func, arg); }
 
+  // Queue `cmd` on a core without waiting for it. The command must stay alive
+  // until it has run, which makes it suitable for commands embedded in long
+  // lived objects. If `cmd` is still queued from a previous call, this does
+  // nothing (the calls are coalesced). Safe to call from irq context.
+  void xcall_async(int core, struct xcall_command *cmd);
+
   void run_pending_xcalls(void);
 }  // namespace cpu
 
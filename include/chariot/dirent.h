@@ -1,12 +1,34 @@
 #ifndef __CK_DIRENT_H
 #define __CK_DIRENT_H
 
+// d_type
+#define DT_UNKNOWN 0
+#define DT_FIFO 1
+#define DT_CHR 2
+#define DT_DIR 4
+#define DT_BLK 6
+#define DT_REG 8
+#define DT_LNK 10
+#define DT_SOCK 12
+
 struct dirent {
   unsigned long d_ino;
   // unsigned long d_off;
   // unsigned short d_reclen;
-  // unsigned char d_type;
+  unsigned char d_type;
   char d_name[256];
 };
 
+
+// getdents() packs as many of these into a buffer as fit. Each one is
+// d_reclen bytes long (a multiple of 8), and the name is nul terminated
+struct dirent64 {
+  unsigned long d_ino;
+  // the directory offset of the next entry
+  long d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
 #endif
@@ -46,3 +46,9 @@
 #define F_GETOWN_EX 16
 
 #define F_GETOWNER_UIDS 17
+
+// splice() flags. They are hints, and all of them are accepted
+#define SPLICE_F_MOVE 1
+#define SPLICE_F_NONBLOCK 2
+#define SPLICE_F_MORE 4
+#define SPLICE_F_GIFT 8
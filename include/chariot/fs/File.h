@@ -3,6 +3,7 @@
 #include <ck/ptr.h>
 #include <ck/map.h>
 #include <fs/Node.h>
+#include <rcu.h>
 
 namespace fs {
   // A `File` is an abstraction of all file-like objects
@@ -24,6 +25,9 @@ namespace fs {
     off_t seek(off_t offset, int whence = SEEK_SET);
     ssize_t read(void *, ssize_t);
     ssize_t write(void *data, ssize_t);
+    // see fs::Node::readv. `off` of -1 uses the file's offset
+    ssize_t readv(const struct iovec *iov, int iovcnt, off_t off = -1);
+    ssize_t writev(const struct iovec *iov, int iovcnt, off_t off = -1);
     int ioctl(int cmd, unsigned long arg);
     int stat(struct stat *stat) { return ino->stat(stat); }
     int close();
@@ -51,5 +55,16 @@ namespace fs {
     bool can_read = false;
 
     int pflags = 0;  // private flags. Also used to track ptmx id
+
+    // Process::get_fd() reads file descriptor tables without a lock, so it
+    // can find a file whose last reference is being dropped. It takes its
+    // reference with ref_try_retain(), which only needs the memory (not the
+    // file) to still be there, so the memory is freed after a grace period.
+    static void operator delete(void *ptr);
+    struct rcu_head m_rcu;
+
+    // the awaitset watches on this file (see kernel/awaitset.cpp)
+    spinlock watch_lock;
+    struct list_head watches;
   };
 }  // namespace fs
\ No newline at end of file
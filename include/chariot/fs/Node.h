@@ -7,6 +7,9 @@
 #include <errno.h>
 #include <lock.h>
 #include <ck/map.h>
+#include <ck/func.h>
+
+struct iovec;
 
 #define T_INVA 0
 #define T_DIR 1
@@ -35,6 +38,12 @@ namespace mm {
 namespace net {
   class Socket;
 }
+namespace fs {
+  // see fs::Node::splice_read
+  using splice_actor = ck::func<ssize_t(ck::ref<mm::Page> page, size_t pgoff, size_t len)>;
+  // see fs::Node::getdents
+  using dirent_actor = ck::func<bool(const char *name, size_t len, unsigned long ino, int type, off_t next)>;
+}
 namespace devfs {
   class DirectoryNode;
 }
@@ -102,6 +111,22 @@ namespace fs {
     virtual ssize_t read(fs::File &file, char *buf, size_t sz);
     // Write some bytes
     virtual ssize_t write(fs::File &file, const char *buf, size_t sz);
+    // Read into (or write from) several buffers in one go. An `off` of -1
+    // uses and advances the file's offset, anything else is a positional
+    // access that leaves it alone. The buffers have already been validated.
+    // The default loops over read/write and has no positional variant
+    virtual ssize_t readv(fs::File &file, const struct iovec *iov, int iovcnt, off_t off);
+    virtual ssize_t writev(fs::File &file, const struct iovec *iov, int iovcnt, off_t off);
+    // Hand up to `len` bytes at `off` (-1 for the file's offset) to `actor`, a
+    // run at a time, straight out of the page that holds them. The actor
+    // returns how much it took (or an error), and this stops at the first run
+    // it doesn't take all of. Returns the total taken. The default reads into
+    // a bounce page and seeks back over what the actor leaves. Streams can't
+    // seek, so it keeps offering them to the actor and fails if it stops
+    virtual ssize_t splice_read(fs::File &file, off_t off, size_t len, splice_actor actor);
+    // Write `len` bytes at `pgoff` into `page` to the file at `off` (-1 for
+    // the file's offset). The default writes from the page's kernel mapping
+    virtual ssize_t splice_write(fs::File &file, ck::ref<mm::Page> page, size_t pgoff, size_t len, off_t off);
     // Implement ioctl functionality that is specific to the Node
     virtual int ioctl(fs::File &file, unsigned int cmd, off_t arg);
     // Notify the fs::Node implementation that it has been opened into a fs::File instance
@@ -132,6 +157,11 @@ namespace fs {
     virtual int mknod(ck::string name, fs::Ownership &, int major, int minor) { return -EINVAL; }
     // Get a list of the directory entires in this directory.
     virtual ck::vec<DirectoryEntry *> dirents(void) { return {}; }
+    // Hand the entries from the directory offset `off` on to `actor` (the name
+    // isn't nul terminated, `type` is a DT_* and `next` is the offset of the
+    // following entry) until it returns false. Returns the offset to carry on
+    // from. The default walks dirents(), with an offset of one per entry
+    virtual off_t getdents(fs::File &file, off_t off, dirent_actor actor);
     // get a dirent (return null if it doesn't exist). It is assumed `lock` is held
     // while the parent holds the borrowed DirectoryEntry.
     virtual DirectoryEntry *get_direntry(ck::string name) { return nullptr; }
@@ -147,6 +177,8 @@ namespace fs {
     virtual bool is_blockdev(void) { return false; }  // dev::BlockDevice
     virtual bool is_chardev(void) { return false; }   // dev::CharDevice
     virtual bool is_tty(void) { return false; }       // TTYNode
+    virtual bool is_ioring(void) { return false; }    // ioring (see kernel/ioring.cpp)
+    virtual bool is_awaitset(void) { return false; }  // awaitset (see kernel/awaitset.cpp)
 
     // Lock the fs::Node and return a scoped_*lock to ensure release at some point
     scoped_lock lock(void) { return m_lock; }
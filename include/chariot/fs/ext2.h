@@ -5,6 +5,7 @@
 #include <fs.h>
 #include <ck/func.h>
 #include <lock.h>
+#include <sem.h>
 #include <ck/map.h>
 #include <ck/vec.h>
 #include "types.h"
@@ -33,6 +34,9 @@
 
 #define EXT2_FT_MAX 8
 
+// directory entries record the file type
+#define EXT2_FEATURE_INCOMPAT_FILETYPE 0x0002
+
 
 template <typename T, typename U>
 inline constexpr T ceil_div(T a, U b) {
@@ -105,6 +109,9 @@ namespace ext2 {
     int seek_check(fs::File &, off_t old_off, off_t new_off) override;
     ssize_t read(fs::File &, char *dst, size_t count) override;
     ssize_t write(fs::File &, const char *, size_t) override;
+    ssize_t readv(fs::File &, const struct iovec *, int, off_t) override;
+    ssize_t writev(fs::File &, const struct iovec *, int, off_t) override;
+    ssize_t splice_read(fs::File &, off_t, size_t, fs::splice_actor) override;
     int resize(fs::File &, size_t) override;
     ck::ref<mm::VMObject> mmap(fs::File &, size_t npages, int prot, int flags, off_t off) override;
   };
@@ -127,6 +134,7 @@ namespace ext2 {
     int mkdir(ck::string name, fs::Ownership &) override;
     int unlink(ck::string name) override;
     ck::vec<fs::DirectoryEntry *> dirents(void) override;
+    off_t getdents(fs::File &, off_t, fs::dirent_actor) override;
     fs::DirectoryEntry *get_direntry(ck::string name) override;
     int link(ck::string name, ck::ref<fs::Node> node) override;
   };
@@ -240,8 +248,8 @@ namespace ext2 {
     superblock sb;
 
 
-    // lock the block groups
-    spinlock bglock;
+    // lock the block groups (held across disk I/O)
+    mutex bglock;
 
     // how many blockgroups are in the filesystem
     uint32_t blockgroups = 0;
@@ -265,7 +273,8 @@ namespace ext2 {
     ck::box<fs::File> disk;
     ck::ref<dev::BlockDevice> bdev;
 
-    spinlock m_lock;
+    // protects `inodes`, held while reading new inodes off the disk
+    mutex m_lock;
   };
 }  // namespace ext2
 
@@ -19,5 +19,13 @@ struct poll_table_wait_entry {
 struct poll_table {
   ck::vec<poll_table_wait_entry *> ents;
   int index;
+  // what the wait entries do when woken. By default they wake this thread up
+  // once and mark themselves `awoken`
+  wait_entry_func_t wake = nullptr;
   void wait(wait_queue &wq, short events);
+  // block until one of the queues we are waiting on wakes us. Returns -EINTR
+  // if a signal got there first.
+  int sleep(void);
+  // remove and free every wait entry
+  void clear(void);
 };
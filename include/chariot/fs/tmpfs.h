@@ -15,6 +15,9 @@ namespace tmpfs {
     int seek_check(fs::File &, off_t old_off, off_t new_off) override;
     ssize_t read(fs::File &, char *dst, size_t count) override;
     ssize_t write(fs::File &, const char *, size_t) override;
+    ssize_t readv(fs::File &, const struct iovec *, int, off_t) override;
+    ssize_t writev(fs::File &, const struct iovec *, int, off_t) override;
+    ssize_t splice_read(fs::File &, off_t, size_t, fs::splice_actor) override;
     int resize(fs::File &, size_t) override;
     ck::ref<mm::VMObject> mmap(fs::File &, size_t npages, int prot, int flags, off_t off) override;
 
@@ -28,7 +31,7 @@ namespace tmpfs {
    private:
     int resize_r(fs::File &, size_t);
 
-    ssize_t access(fs::File &f, void *data, size_t count, bool write);
+    ssize_t access(off_t off, void *data, size_t count, bool write);
     spinlock m_lock;
     ck::vec<ck::ref<mm::Page>> m_pages;
   };
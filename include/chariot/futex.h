@@ -2,6 +2,70 @@
 
 
 
-#define FUTEX_WAIT 1 /* If the  */
-#define FUTEX_WAKE 2
-#define FUTEX_DSTR 3 /* Destroy the futex at this location */
+#define FUTEX_WAIT 1 /* If the word at uaddr is val, sleep until woken */
+#define FUTEX_WAKE 2 /* Wake at most val waiters */
+#define FUTEX_DSTR 3 /* Destroy the futex at this location (a no-op) */
+#define FUTEX_REQUEUE 4     /* Wake val waiters, move up to val2 of the rest to uaddr2 */
+#define FUTEX_CMP_REQUEUE 5 /* FUTEX_REQUEUE, but only if the word at uaddr is val3 */
+#define FUTEX_WAKE_OP 6     /* Apply the op in val3 to uaddr2, then wake (see FUTEX_OP) */
+#define FUTEX_WAIT_BITSET 7 /* FUTEX_WAIT with a bitset in val3 and an absolute timeout */
+#define FUTEX_WAKE_BITSET 8 /* FUTEX_WAKE, but only waiters whose bitset has a bit of val3 */
+#define FUTEX_LOCK_PI 9     /* Lock a priority inheritance futex, boosting its owner */
+#define FUTEX_UNLOCK_PI 10  /* Unlock a PI futex, handing it to the most urgent waiter */
+#define FUTEX_TRYLOCK_PI 11 /* FUTEX_LOCK_PI, but fail with EBUSY instead of blocking */
+
+
+/*
+ * Or'd into the op if the futex is only ever used by one process. The kernel
+ * then skips finding out if the word lives in a shared mapping.
+ */
+#define FUTEX_PRIVATE_FLAG 128
+#define FUTEX_CMD_MASK (~FUTEX_PRIVATE_FLAG)
+
+/*
+ * The word of a PI futex is the tid of its owner (0 if unlocked), and
+ * FUTEX_WAITERS if threads are blocked in FUTEX_LOCK_PI. Userspace must call
+ * FUTEX_UNLOCK_PI instead of storing 0 if it is set.
+ */
+#define FUTEX_WAITERS 0x80000000
+#define FUTEX_OWNER_DIED 0x40000000
+#define FUTEX_TID_MASK 0x3fffffff
+
+/* FUTEX_WAIT and FUTEX_WAKE use every bit */
+#define FUTEX_BITSET_MATCH_ANY 0xffffffff
+
+
+/*
+ * The timeout argument (val2) of FUTEX_WAIT and FUTEX_WAIT_BITSET points to
+ * one of these (it has the same layout as a struct timespec), or is NULL to
+ * wait forever. FUTEX_WAIT's timeout is relative, FUTEX_WAIT_BITSET's and
+ * FUTEX_LOCK_PI's are an absolute time on the clock clock_gettime() reads.
+ */
+struct futex_timespec {
+  long tv_sec;
+  long tv_nsec;
+};
+
+
+/*
+ * FUTEX_WAKE_OP atomically does `old = *uaddr2; *uaddr2 = old OP oparg`,
+ * wakes val waiters on uaddr, and if `old CMP cmparg` also wakes val2
+ * waiters on uaddr2. val3 is built with FUTEX_OP()
+ */
+#define FUTEX_OP_SET 0  /* uaddr2 = oparg */
+#define FUTEX_OP_ADD 1  /* uaddr2 += oparg */
+#define FUTEX_OP_OR 2   /* uaddr2 |= oparg */
+#define FUTEX_OP_ANDN 3 /* uaddr2 &= ~oparg */
+#define FUTEX_OP_XOR 4  /* uaddr2 ^= oparg */
+
+#define FUTEX_OP_OPARG_SHIFT 8 /* use (1 << oparg) as the operand */
+
+#define FUTEX_OP_CMP_EQ 0
+#define FUTEX_OP_CMP_NE 1
+#define FUTEX_OP_CMP_LT 2
+#define FUTEX_OP_CMP_LE 3
+#define FUTEX_OP_CMP_GT 4
+#define FUTEX_OP_CMP_GE 5
+
+#define FUTEX_OP(op, oparg, cmp, cmparg) \
+  (((op & 0xf) << 28) | ((cmp & 0xf) << 24) | ((oparg & 0xfff) << 12) | (cmparg & 0xfff))
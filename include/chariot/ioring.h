@@ -0,0 +1,77 @@
+#pragma once
+
+// An ioring is a pair of queues shared between a process and the kernel.
+// Userspace fills in submission queue entries (SQEs) and bumps `sq.tail`,
+// the kernel consumes them when the ring is entered and posts a completion
+// queue entry (CQE) for each one at `cq.tail`. Userspace reaps CQEs and bumps
+// `cq.head`. Each index is only ever written by one side, so the only
+// synchronization needed is acquire/release ordering on the indices.
+//
+// ioring_setup() returns a file descriptor. mmap `ring_size` bytes of it
+// (MAP_SHARED) to get at the ring:
+//
+//   [ struct ioring_hdr ][ sqes[sq.entries] ][ cqes[cq.entries] ]
+//
+// Operations on descriptors that support awaitfs (pipes, sockets, ...) are
+// only run once they are ready, so a submission never blocks on them. Until
+// then they are kept in the kernel and retried on later ioring_enter()
+// calls. The ring's fd polls readable (AWAITFS_READ) when completions are
+// waiting or a parked operation could make progress, so it can be waited on
+// with awaitfs() alongside everything else.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IORING_MAX_ENTRIES 4096
+
+#define IORING_OP_NOP 0
+#define IORING_OP_READ 1      // read(fd, addr, len), at `off` unless it is -1
+#define IORING_OP_WRITE 2     // write(fd, addr, len), at `off` unless it is -1
+#define IORING_OP_SENDTO 3    // sendto(fd, addr, len, op_flags, addr2, addr2_len)
+#define IORING_OP_RECVFROM 4  // recvfrom(fd, addr, len, op_flags, addr2, addr2_len)
+#define IORING_OP_POLL 5      // wait for the AWAITFS_* events in op_flags. res is the events that occurred
+
+struct ioring_sqe {
+  unsigned char op;  // IORING_OP_*
+  unsigned char flags;
+  unsigned short __pad0;
+  int fd;
+  long off;
+  unsigned long addr;
+  unsigned long len;
+  unsigned long addr2;
+  unsigned int addr2_len;
+  unsigned int op_flags;
+  unsigned long user_data;  // copied to the CQE
+  unsigned long __pad1;
+};
+
+struct ioring_cqe {
+  unsigned long user_data;
+  long res;  // the return value of the operation, or -errno
+};
+
+struct ioring_queue {
+  volatile unsigned head;
+  volatile unsigned tail;
+  unsigned mask;  // entries - 1
+  unsigned entries;
+};
+
+struct ioring_hdr {
+  struct ioring_queue sq;
+  struct ioring_queue cq;
+  unsigned sqes_off;  // offset of the SQE array from the start of the ring
+  unsigned cqes_off;  // offset of the CQE array from the start of the ring
+};
+
+struct ioring_params {
+  unsigned sq_entries;  // out
+  unsigned cq_entries;  // out
+  unsigned long ring_size;  // out: how much to mmap
+};
+
+#ifdef __cplusplus
+}
+#endif
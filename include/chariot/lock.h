@@ -6,16 +6,52 @@
 
 #define WARN_UNUSED __attribute__((warn_unused_result))
 
-// TODO: use the correct cpu state
+// arch.h
+void arch_relax(void);
+
+class Thread;
+
+// Contention statistics shared by every spinlock constructed with the same
+// class. Counters are only updated when the kernel is built with
+// CONFIG_LOCK_STATS, and can be dumped with the `lockstat` kshell command.
+struct lock_class {
+  const char *name;
+  unsigned long acquisitions = 0;       // how many times a lock in this class was taken
+  unsigned long contended = 0;          // ... and how many of those had to wait
+  unsigned long spin_cycles = 0;        // total timestamp cycles spent waiting
+  unsigned long max_spin_cycles = 0;    // the longest single wait
+  lock_class *next = nullptr;           // intrusive list of all classes (registered on first use)
+  int registered = 0;
+
+  constexpr lock_class(const char *name) : name(name) {}
+
+  // call `cb` on every lock class that has been used
+  static void each(void (*cb)(lock_class &));
+};
+
+
+// A fair (FIFO) ticket spinlock. Each locker takes a ticket from `m_next`
+// and spins until `m_owner` reaches it, so cores are served in the order
+// they arrived and only read a shared line while they wait. A thread is not
+// preempted while it holds (or waits on) a ticket, as everyone queued behind
+// it would spin until it ran again.
 class spinlock {
  private:
-  // compare and swap dest to spinlock on
-  int locked = 0;
+  volatile unsigned m_owner = 0;  // the ticket currently holding the lock
+  volatile unsigned m_next = 0;   // the next ticket to be handed out
+  Thread *m_holder = nullptr;     // the thread whose preemption we disabled, if any
+#ifdef CONFIG_LOCK_STATS
+  lock_class *m_class = nullptr;
+#endif
 
  public:
-  inline spinlock() {
-    locked = 0;
-  }
+  constexpr spinlock() {}
+  // construct a spinlock whose contention is accounted to `cls`
+#ifdef CONFIG_LOCK_STATS
+  constexpr spinlock(lock_class &cls) : m_class(&cls) {}
+#else
+  constexpr spinlock(lock_class &cls) {}
+#endif
 
   void lock(void);
   void unlock(void);
@@ -32,6 +68,48 @@ class spinlock {
   bool try_lock(void);
 };
 
+// A sequence lock for small, read-mostly data. Writers serialize on a
+// spinlock and bump the sequence number to an odd value while they update.
+// Readers never write: they retry if the sequence was odd, or changed while
+// they were reading.
+//
+//   unsigned seq;
+//   do {
+//     seq = lck.read_begin();
+//     ... copy the data out ...
+//   } while (lck.read_retry(seq));
+class seqlock {
+ private:
+  volatile unsigned m_seq = 0;
+  spinlock m_lock;
+
+ public:
+  inline unsigned read_begin(void) const {
+    unsigned seq;
+    while ((seq = __atomic_load_n(&m_seq, __ATOMIC_ACQUIRE)) & 1)
+      arch_relax();
+    return seq;
+  }
+
+  inline bool read_retry(unsigned seq) const {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&m_seq, __ATOMIC_RELAXED) != seq;
+  }
+
+  inline bool write_lock(void) {
+    bool en = m_lock.lock_irqsave();
+    __atomic_store_n(&m_seq, m_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return en;
+  }
+
+  inline void write_unlock(bool en) {
+    __atomic_store_n(&m_seq, m_seq + 1, __ATOMIC_RELEASE);
+    m_lock.unlock_irqrestore(en);
+  }
+};
+
+
 class rwlock {
  public:
   int read_lock();
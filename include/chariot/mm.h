@@ -7,6 +7,7 @@
 #include <mmap_flags.h>
 #include <ck/ptr.h>
 #include <rbtree.h>
+#include <sem.h>
 #include <ck/string.h>
 #include <cpu.h>
 #include <ck/vec.h>
@@ -252,7 +253,8 @@ namespace mm {
     int prot = 0;
     int flags = 0;
 
-    spinlock lock;
+    // held while faulting pages in, which may read from disk
+    mutex lock;
 
     // TODO: unify shared mappings in the fileriptor somehow
     ck::ref<fs::File> fd;
@@ -295,6 +297,8 @@ namespace mm {
     int delete_region(off_t va);
     int pagefault(off_t va, int err);
     off_t mmap(off_t req, size_t size, int prot, int flags, ck::ref<fs::File>, off_t off);
+    // fault in (if needed) and return the page backing `uaddr`. Expects nothing to be locked
+    ck::ref<mm::Page> get_page(off_t uaddr);
 
     off_t mmap(ck::string name, off_t req, size_t size, int prot, int flags, ck::ref<fs::File>, off_t off);
     int unmap(off_t addr, size_t sz);
@@ -357,8 +361,8 @@ namespace mm {
 
 
 
-
-    spinlock lock;
+    // held across page faults (and the disk I/O they do), so it sleeps
+    mutex lock;
     rb_root regions;
 
    protected:
@@ -372,8 +376,6 @@ namespace mm {
     uint64_t predict_hits = 0;
     uint64_t predict_misses = 0;
 
-    // expects nothing to be locked
-    ck::ref<mm::Page> get_page(off_t uaddr);
     // expects the area, and space to be locked
     ck::ref<mm::Page> get_page_internal(off_t uaddr, mm::MappedRegion &area, int pagefault_err, bool do_map);
 
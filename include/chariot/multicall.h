@@ -0,0 +1,30 @@
+#pragma once
+
+// multicall() runs a batch of system calls in a single kernel entry. Each
+// entry names a syscall by number (SYS_* in <sys/syscall_defs.h>) and gets its
+// result (what sysbind_* would have returned) written back. Calls run in
+// order, and each one sees what the ones before it did, so they don't have to
+// be independent, but an argument can't refer to an earlier result.
+//
+// System calls that don't return to their caller (exit, fork, execve, ...)
+// can't be batched, and fail with -EINVAL.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the most entries one multicall() may run
+#define MULTICALL_MAX 256
+
+// stop at the first call that fails (returns -errno)
+#define MULTICALL_STOP_ON_ERROR (1 << 0)
+
+struct multicall_entry {
+  long num;
+  unsigned long args[6];
+  long result;
+};
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,6 +7,7 @@
 #include <fs.h>
 
 #include <thread.h>
+#include <rcu.h>
 // #include <mm.h>
 
 
@@ -43,6 +44,23 @@ struct process_user_info {
   long egid = 0;
 };
 
+// the most file descriptors a process may have open
+#define FDTABLE_MAX 4096
+
+/**
+ * A process' file descriptors. get_fd() reads this without taking any lock:
+ * each slot owns a reference to its file, and whoever changes the table
+ * (holding file_lock) swaps in a bigger one when it has to grow, and puts off
+ * freeing the old table until every reader that could have seen it has
+ * finished (see rcu.h). Closing drops the slot's reference right away, so
+ * get_fd() only keeps a file it manages to take a reference on.
+ */
+struct fd_table {
+  struct rcu_head rcu;
+  int size;
+  fs::File *files[];
+};
+
 /**
  * a process is a group of information that is shared among many tasks
  */
@@ -107,11 +125,13 @@ struct Process final : public ck::refcounted<Process> {
 
   ck::ref<fs::File> executable;
 
+  // the PT_TLS template each thread's TLS block is initialized from
   struct {
     bool exists = false;
-    off_t fileoff;
+    off_t vaddr;
     size_t memsz;
     size_t fsize;
+    size_t align;
   } tls_info;
 
   u64 create_tick = 0;
@@ -126,13 +146,13 @@ struct Process final : public ck::refcounted<Process> {
 
   wait_queue child_wq;
 
+  // held while changing the file descriptors
   spinlock file_lock;
-  ck::map<int, ck::ref<fs::File>> open_files;
+  struct fd_table *files = nullptr;
 
+  // set once the process has been traced (see sctrace.h)
+  struct sctrace_proc *sctrace = nullptr;
 
-  spinlock futex_lock;
-  wait_queue &futex_queue(int *);
-  ck::map<off_t, ck::box<wait_queue>> m_futex_queues;
 
   /**
    * exec() - execute a command (implementation for startpid())
@@ -140,7 +160,14 @@ struct Process final : public ck::refcounted<Process> {
   int exec(ck::string &path, ck::vec<ck::string> &argv, ck::vec<ck::string> &envp);
 
   ck::ref<fs::File> get_fd(int fd);
+  // install a file at the lowest free descriptor, or -EMFILE
   int add_fd(ck::ref<fs::File>);
+  // install a file at `fd`, closing whatever was there
+  int set_fd(int fd, ck::ref<fs::File>);
+  // returns -ENOENT if the descriptor wasn't open
+  int close_fd(int fd);
+  // close every descriptor from `lowest` up
+  void close_fds(int lowest);
 
   long create_thread(void *ip, int state);
 
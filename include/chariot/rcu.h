@@ -1,9 +1,13 @@
 #pragma once
 #include <asm.h>  // barrier
 
-// This version of the RCU is based heavily on the "toy" implementation from
-// https://www.kernel.org/doc/Documentation/RCU/whatisRCU.txt. It's not
-// perfect, but apparently it works -- just slowly.
+// A quiescent-state based RCU. Readers only disable preemption on their own
+// core (they never write shared memory), and must not block. Every core
+// counts the quiescent states it passes through (context switches in the
+// scheduler loop, trips around the idle loop, and timer ticks that land
+// outside of a read-side critical section). A grace period is over once
+// every core has passed through at least one quiescent state, as none of them
+// can still be inside a read-side critical section that began before it.
 
 #define smp_store_release(p, v) \
   do {                          \
@@ -14,16 +18,36 @@
 
 #define rcu_assign_pointer(p, v) ({ __atomic_store_n(&(p), (v), __ATOMIC_RELEASE); })
 
-#define rcu_dereference(p)                \
-  ({                                      \
-    typeof(p) _________p1 = READ_ONCE(p); \
-    (_________p1);                        \
+#define rcu_dereference(p)                    \
+  ({                                          \
+    __typeof__(p) _________p1 = READ_ONCE(p); \
+    (_________p1);                            \
   })
 
+// embed this in a structure to free it (or do anything else) after a grace period
+struct rcu_head {
+  struct rcu_head *next;
+  void (*func)(struct rcu_head *);
+};
+
+typedef void (*rcu_callback_t)(struct rcu_head *);
+
 // kernel/rcu.cpp
 extern void rcu_read_lock();
 extern void rcu_read_unlock();
 
+// wait for all pre-existing readers to finish. This sleeps, so it may not be
+// called from within a read-side critical section or from an irq.
+extern void synchronize_rcu(void);
+
+// call `func(head)` from the [rcu] kthread once all pre-existing readers have
+// finished. Never blocks, so it can be used from any context.
+extern void call_rcu(struct rcu_head *head, rcu_callback_t func);
+
+// report that this core has passed through a quiescent state. Called by the
+// scheduler, the idle loop and the timer tick.
+extern void rcu_note_qs(void);
+
 // STUBS
 #define rcu_check_sparse(p, space)
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <rbtree.h>
+#include <xcall.h>
 
 namespace cpu {
   struct Core;
@@ -191,6 +192,9 @@ namespace rt {
     spinlock m_lock;
 
     bool in_kick = false;
+    // queued on this core by kick(). Kicks that arrive while one is already
+    // pending are dropped.
+    struct xcall_command kick_xcall;
   };
 
   scoped_irqlock local_lock();
@@ -58,6 +58,8 @@ namespace sched {
   void run(void);
 
   void handle_tick(u64 tick);
+  // a one-shot timer fired between ticks (a sleeper or the end of a time slice)
+  void handle_timer(void);
 
   // force the process to exit, (yield with different state)
   void exit();
@@ -0,0 +1,25 @@
+#pragma once
+
+// the user/kernel scheduler latency statistics structure definition
+
+
+// Latencies are recorded into log2 histograms of nanoseconds. Bucket `i`
+// counts samples in [2^i, 2^(i+1)) ns, and the last bucket also holds
+// everything larger than that.
+#define SCHEDSTAT_BUCKETS 32
+
+// Passed as the tid to `get_sched_stats` to get the sum over every core
+#define SCHEDSTAT_ALL (-1)
+
+struct chariot_sched_stats {
+  unsigned long run_count;    // how many times the thread was switched to
+  unsigned long wakeups;      // how many times it was made runnable after blocking
+  unsigned long preemptions;  // involuntary context switches (preempted while runnable)
+  unsigned long migrations;   // how many times it moved to a different core
+  unsigned long runq_ns;      // total time spent runnable, but waiting in a run queue
+
+  // time from being placed in a run queue to running (every enqueue)
+  unsigned long runq_hist[SCHEDSTAT_BUCKETS];
+  // time from being woken up to running (only wakeups)
+  unsigned long wakeup_hist[SCHEDSTAT_BUCKETS];
+};
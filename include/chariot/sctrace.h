@@ -0,0 +1,82 @@
+#pragma once
+
+// System call tracing. sctrace() turns on counting for a process (or for the
+// whole system): how many times each system call was made, how many of those
+// failed, and a log2 histogram of how long they took (bucket `i` counts calls
+// that took [2^i, 2^(i+1)) ns, like schedstat.h). sctrace_stats() reads the
+// counts back.
+//
+// SCTRACE_EVENTS also returns a file descriptor, which reads back one
+// struct sctrace_event for every call the process makes. Events are dropped
+// rather than slowing the process down if the reader falls behind.
+//
+// The names and signatures of the system calls come from
+// <chariot/syscall_info.inc>, which is generated from kernel/syscalls.toml
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// syscall numbers fit in a byte
+#define SCTRACE_NR 256
+#define SCTRACE_BUCKETS 32
+// how much of a string argument an event holds
+#define SCTRACE_STRLEN 48
+
+// sctrace() flags
+#define SCTRACE_STATS (1 << 0)
+#define SCTRACE_EVENTS (1 << 1)
+// processes forked afterwards are traced the same way, into the same fd
+#define SCTRACE_INHERIT (1 << 2)
+
+// sctrace() and sctrace_stats() take this for the system wide counts
+#define SCTRACE_SYSTEM (-1)
+
+// __SYSCALL_INFO flags in <chariot/syscall_info.inc>
+#define SCINFO_NORETURN (1 << 0)
+#define SCINFO_NOTRACE (1 << 1)
+// not allowed in multicall() (see multicall.h)
+#define SCINFO_NOBATCH (1 << 2)
+
+struct sctrace_stat {
+  unsigned long count;
+  unsigned long errors;
+  unsigned long total_ns;
+  unsigned long max_ns;
+  unsigned long hist[SCTRACE_BUCKETS];
+};
+
+struct sctrace_event {
+  int pid;
+  int tid;
+  int num;
+  // SCINFO_NORETURN calls are reported before they run, without a result
+  int flags;
+  unsigned long args[6];
+  long ret;
+  unsigned long start_ns;
+  unsigned long ns;
+  // the syscall's first `const char *` argument, if it has one
+  char str[SCTRACE_STRLEN];
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#if defined(KERNEL) && defined(__cplusplus)
+
+struct Process;
+
+// set while the system wide counts are on
+extern bool sctrace_system;
+
+// run a system call through the tracing hooks, if curproc (or the system) is
+// being traced. Returns false if it isn't, and the call should be made as usual
+bool sctrace_syscall(int num, void *handler, unsigned long *args, unsigned long &ret);
+// children inherit SCTRACE_INHERIT tracing
+void sctrace_fork(Process &parent, Process &child);
+void sctrace_exit(Process &p);
+
+#endif
@@ -72,3 +72,41 @@ class semaphore final {
     lock.unlock();
   }
 };
+
+
+struct Thread;
+
+// A sleeping lock for critical sections that may block (disk I/O, page
+// faults, ...). A locker spins for a short while if the owner is currently
+// running on another core, as it is likely to release the lock soon, and
+// otherwise sleeps on a wait queue so the core can do something useful. This
+// must not be taken from an irq or with interrupts disabled.
+class mutex final {
+  Thread *volatile m_owner = nullptr;
+  // the core the owner took the lock on (used to check if it is still running)
+  void *volatile m_owner_core = nullptr;
+  unsigned m_waiters = 0;
+  struct wait_queue m_wq;
+
+  bool try_spin(void);
+
+ public:
+  void lock(void);
+  void unlock(void);
+  bool try_lock(void);
+  inline bool is_locked(void) { return __atomic_load_n(&m_owner, __ATOMIC_RELAXED) != nullptr; }
+};
+
+
+class scoped_mutex {
+  mutex &mtx;
+
+ public:
+  inline scoped_mutex(mutex &mtx) : mtx(mtx) {
+    mtx.lock();
+  }
+
+  inline ~scoped_mutex(void) {
+    mtx.unlock();
+  }
+};
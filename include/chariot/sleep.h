@@ -10,7 +10,7 @@ namespace cpu { struct Core; }
 struct sleep_waiter {
   struct sleep_waiter *prev;
   struct sleep_waiter *next;
-  cpu::Core *cpu;
+  cpu::Core *cpu = NULL;
   uint64_t wakeup_us = 0;
   wait_queue wq;
 
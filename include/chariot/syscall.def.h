@@ -1,6 +1,12 @@
 #include <types.h>
 #include <mountopts.h>
 #include <cpu_usage.h>
+#include <schedstat.h>
+#include <ioring.h>
+#include <awaitset.h>
+#include <uio.h>
+#include <sctrace.h>
+#include <multicall.h>
 namespace sys {
 void restart();
 void exit_thread(int code);
@@ -60,7 +66,7 @@ int sigprocmask(int how, unsigned long set, unsigned long* old_set);
 int kill(int pid, int sig);
 int awaitfs(struct await_target * fds, int nfds, int flags, long long timeout_time);
 unsigned long kshell();
-int futex(int* uaddr, int op, int val, int val2, int* uaddr2, int val3);
+int futex(int* uaddr, int op, int val, unsigned long val2, int* uaddr2, int val3);
 int sysinfo(struct sysinfo * info);
 int dnslookup(const char * name, unsigned int* ip4);
 int shutdown();
@@ -70,4 +76,23 @@ unsigned long getramusage();
 int get_core_usage(unsigned int core, struct chariot_core_usage * usage);
 int get_nproc();
 int kctl(off_t* name, unsigned namelen, char * oval, size_t* olen, char * nval, size_t nlen);
+int sched_setaffinity(int tid, size_t size, unsigned long * mask);
+int sched_getaffinity(int tid, size_t size, unsigned long * mask);
+int get_sched_stats(int tid, struct chariot_sched_stats * stats);
+int getcpu();
+int ioring_setup(unsigned entries, struct ioring_params * params);
+int ioring_enter(int fd, unsigned to_submit, unsigned min_complete, int flags);
+int awaitset_create(int flags);
+int awaitset_ctl(int set, int op, int fd, struct awaitset_event * ev);
+int awaitset_wait(int set, struct awaitset_event * events, int max, long long timeout_time);
+ssize_t readv(int fd, const struct iovec * iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec * iov, int iovcnt);
+ssize_t preadv(int fd, const struct iovec * iov, int iovcnt, long off);
+ssize_t pwritev(int fd, const struct iovec * iov, int iovcnt, long off);
+ssize_t sendfile(int out_fd, int in_fd, long * off, size_t count);
+ssize_t splice(int fd_in, long * off_in, int fd_out, long * off_out, size_t len, unsigned flags);
+int sctrace(int pid, int flags);
+int sctrace_stats(int pid, struct sctrace_stat * stats, int count);
+int multicall(struct multicall_entry * calls, int count, int flags);
+ssize_t getdents(int fd, struct dirent64 * buf, size_t len);
 }
@@ -10,6 +10,7 @@
 
 #include <fwd.h>
 #include <realtime.h>
+#include <schedstat.h>
 
 #ifdef CONFIG_RISCV
 #include <riscv/arch.h>
@@ -88,7 +89,10 @@ struct ThreadContext {
 
 struct ThreadFPUState {
   bool initialized = false;
-  void *state;
+  void *state;              // allocated (arch_fpu_state_size()) the first time it is needed
+  bool live = false;        // the state is loaded in the registers, and may have changed
+  uint8_t use_count = 0;    // how many slices in a row the thread has used the FPU in
+  int last_cpu = -1;        // the core this state was last loaded on
 };
 
 
@@ -101,6 +105,11 @@ struct ThreadStats {
 
   u64 cycles = 0;
   u64 last_start_cycle = 0;
+
+  u64 runnable_since = 0;  // timestamp of when the thread was last placed in a run queue
+  bool woken = false;      // the last enqueue was a wakeup from a blocked state
+
+  struct chariot_sched_stats sched = {};  // latency histograms and counters (see schedstat.h)
 };
 
 
@@ -140,17 +149,21 @@ struct Thread final : public ck::weakable<Thread> {
   uint64_t ktime_us = 0;             // Time attributed to kernelspace
   uint64_t utime_us = 0;             // Time attributed to userspace
   uint64_t last_start_utime_us = 0;  // the last time that this thread
-  uint64_t tls_uaddr = 0;            // the location of the thread local storage for this thread
+  uint64_t tls_uaddr = 0;            // the thread pointer (FS base / tp) for this thread's TLS
+  uint64_t tls_ubase = 0;            // where the thread local storage mapping starts
   uint64_t tls_usize = 0;            // how big the thread local storage is
   ck::string name;                   // The name of this thread
   bool preemptable = true;           // If the thread can be preempted
+  int lock_depth = 0;                // How many spinlock tickets this thread holds. Not preempted while nonzero
   bool should_die = false;           // the thread needs to be torn down. Must not return to userspace
   bool rudely_awoken = false;        // if this thread was woken rudely for a signal or something
   bool kern_idle = false;            // the thread is a kernel idle thread
+  unsigned long affinity = ~0UL;     // Bitmask of the cores this thread may be placed on (bit n = core n)
 
   // TODO: remove these in favor of real-time scheduler constraints!
   uint64_t timeslice = 1;  // how many ticks this thread can run at a time before yielding
   uint64_t ticks_ran = 0;  // how many ticks this thread has run for
+  uint64_t slice_end = 0;  // timestamp at which the current time slice runs out
 
   uint64_t start_time = 0;    // when the task got last started
   uint64_t cur_run_time = 0;  // how long it has run so far without being preempted
@@ -173,14 +186,26 @@ struct Thread final : public ck::weakable<Thread> {
   rt::Constraints m_constraint;         // The realtime constraints of this task
   rt::Scheduler *scheduler = NULL;      // What scheduler currently controls this Task
   spinlock schedlock;                   // held while moving a thread to a different queue (wait or scheduler)
+  bool on_core = false;                 // a core is running us (or still switching off our stack). Under schedlock
+  bool migrate_pending = false;         // woken onto another core while on_core. The old core moves us. Under schedlock
+
+  // Priority inheritance. While a thread owns a PI futex, it runs at the most
+  // urgent priority of the threads waiting for it (see kernel/futex.cpp)
+  uint64_t pi_priority = ~0ULL;  // the inherited priority (~0 if none)
+  struct list_head pi_waiters;   // futex waiters that are boosting this thread
+  spinlock pi_lock;              // protects pi_waiters
 
   void set_state(int st);                       // change the thread state (this->state)
   int get_state(void);                          // get the thread state (this->state) in a "safe" way
   void setup_stack(reg_t *);                    // Setup the the stack given some register state
+  int setup_tls(reg_t *);                       // Map this thread's TLS block and TCB (see <tls.h>)
+  void release_tls(void);                       // Unmap the TLS block
   void interrupt(void);                         // Notify a thread that a signal is avail, interrupting it from a waitqueue if avail
   bool kickoff(void *rip, int state);           // Tell a thread to start running at some RIP
   static ck::ref<Thread> lookup(long);          // Lookup thread by TID
   static ck::ref<Thread> lookup_r(long);        // ^ (but unlocked)
+  static ck::ref<Thread> find(long);            // ^ (but null if there is no such thread)
+  static ck::ref<Thread> lookup_for_user(long); // Lookup a thread the current user may inspect (0 = self)
   static bool teardown(ck::ref<Thread> &&thd);  // Teardown this thread
   static bool join(ck::ref<Thread> thd);        // Join on some thread. (Wait for it to exit)
   static void dump(void);                       // Dump the thread table state
@@ -190,6 +215,11 @@ struct Thread final : public ck::weakable<Thread> {
   // a non-zero value.
   int make_runnable(int cpu = RT_CORE_SELF, bool admit = true);
 
+  // can this thread be placed on a core according to its affinity mask?
+  bool can_run_on(int cpu) const { return cpu >= 0 && cpu < 64 && (affinity & (1UL << cpu)) != 0; }
+  // change the affinity mask, moving the thread off of a core it is no longer allowed on
+  int set_affinity(unsigned long mask);
+
   // sends a signal to the thread and returns if it succeeded or not
   bool send_signal(int sig);
 
@@ -204,12 +234,18 @@ struct Thread final : public ck::weakable<Thread> {
   auto &constraint(void) { return m_constraint; }
   void set_constraint(rt::Constraints &c) { m_constraint = c; }
   rt::Scheduler *current_scheduler(void) const { return scheduler; }
+  // the priority the scheduler uses (μ: higher number = lower prio), including any inherited one
+  uint64_t priority(void);
+  // change the inherited priority, moving the thread in its run queue if needed
+  void set_pi_priority(uint64_t prio);
   void remove_from_scheduler();
   void reset_state();
   void reset_stats();
 
 	// Return the epoch that this thread should run for in nanoseconds
 	uint64_t epoch(void);
+  // start a new time slice of `epoch()` nanoseconds, and arm the timer to end it
+  void start_slice(void);
 
   // Do not use this API, go through sched::proc::* to allocate and deallocate
   // processes and threads.
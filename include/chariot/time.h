@@ -6,6 +6,17 @@
 #define NS_PER_SEC (US_PER_SEC * 1000)
 
 namespace time {
+  // A free-running counter that time is derived from (the TSC on x86, the
+  // `time` CSR on RISC-V). It must tick at a constant rate on every core.
+  struct clocksource {
+    const char *name;
+    unsigned long (*read)(void);
+    unsigned long freq_hz;
+    // cycles are converted to ns as (cycles * mult) >> shift
+    unsigned int mult;
+    unsigned int shift;
+  };
+
   unsigned long long now_ns(void);
   unsigned long long now_us(void);
   unsigned long long now_ms(void);
@@ -20,10 +31,12 @@ namespace time {
 
   unsigned long cycles_to_ns(unsigned long cycles);
 
-  void set_cps(unsigned long cps);
-
-  /* this function is a callback to get the current NS (if the arch can handle it) */
-  void set_high_accuracy_time_fn(unsigned long (*fn)(void));
+  // Start keeping time off of `read`, which counts at `freq_hz`. Called once
+  // by the arch after it has calibrated its counter. `vvar_mode` tells
+  // userspace how to read the same counter (VVAR_CLOCK_* in <vvar.h>)
+  void register_clocksource(const char *name, unsigned long (*read)(void), unsigned long freq_hz, int vvar_mode);
+  // the current clocksource, or null if there isn't one yet
+  const struct clocksource *current_clocksource(void);
 
   bool stabilized(void);
 };  // namespace time
@@ -0,0 +1,26 @@
+#pragma once
+
+// Every user thread gets a thread control block (TCB) and a copy of the
+// executable's PT_TLS template, which the kernel maps when the thread first
+// enters userspace. The thread pointer (FS base on x86, tp on RISC-V) is set
+// so compiler generated local-exec TLS accesses land in the thread's copy:
+//
+//   x86_64 (variant II):  [ .tdata | .tbss ][ tcb ]     tp = &tcb
+//   riscv  (variant I):   [ tcb ][ .tdata | .tbss ]     tp = &tcb + CHARIOT_TCB_SIZE
+//
+// The kernel only fills in `self`. The rest of the TCB is libc's.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHARIOT_TCB_SIZE 2048
+
+struct chariot_tcb {
+  // points to itself, so x86 can find the TCB with a single `mov %fs:0`
+  struct chariot_tcb *self;
+};
+
+#ifdef __cplusplus
+}
+#endif
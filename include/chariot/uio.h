@@ -0,0 +1,25 @@
+#pragma once
+
+// struct iovec, shared between the kernel and libc (which gets it through
+// <sys/uio.h>). lwip has its own copy with the same layout. Defining the
+// `iovec` macro tells it not to bother.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the most buffers a single vectored read or write may use
+#define UIO_MAXIOV 1024
+
+#if !defined(__DEFINED_struct_iovec) && !defined(iovec) && !defined(LWIP_HDR_SOCKETS_H)
+#define __DEFINED_struct_iovec
+#define iovec iovec
+struct iovec {
+  void *iov_base;
+  unsigned long iov_len;
+};
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+// The vvar page is mapped read-only into every process at CHARIOT_VVAR_ADDR
+// (below where binaries are linked). It exposes enough of the kernel's
+// timekeeping state for libc to read the time without a system call.
+//
+// It is protected by a sequence counter: `seq` is odd while the kernel is
+// updating the page, and changes on every update. Readers copy the fields
+// out, then retry if `seq` was odd or has changed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHARIOT_VVAR_ADDR 0xF000UL
+
+// how userspace reads the clocksource counter
+#define VVAR_CLOCK_NONE 0      // no usable counter, make a system call
+#define VVAR_CLOCK_TSC 1       // rdtsc (x86)
+#define VVAR_CLOCK_TIME_CSR 2  // rdtime (RISC-V)
+
+// how userspace finds out which core it is running on
+#define VVAR_CPU_NONE 0    // make a system call
+#define VVAR_CPU_RDTSCP 1  // rdtscp returns the core id in ecx (IA32_TSC_AUX)
+
+struct chariot_vvar {
+  volatile unsigned seq;
+  unsigned clock_mode;  // VVAR_CLOCK_*
+  // ns = base_ns + (((counter - base_cycle) * mult) >> shift)
+  unsigned mult;
+  unsigned shift;
+  unsigned long base_cycle;
+  unsigned long base_ns;
+
+  unsigned cpu_mode;  // VVAR_CPU_*
+};
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#if defined(KERNEL) && defined(__cplusplus)
+namespace mm {
+  class AddressSpace;
+};
+
+namespace vvar {
+  // the kernel's (writable) view of the page
+  struct chariot_vvar *get(void);
+  // map the page into a new address space. Called by elf::load
+  int map(mm::AddressSpace &);
+  // bracket an update to the page
+  void write_begin(void);
+  void write_end(void);
+};  // namespace vvar
+#endif
@@ -41,12 +41,18 @@ namespace x86 {
     uint64_t bus_freq_hz;
     uint64_t ps_per_tick;
     uint64_t cycles_per_us;
+    uint64_t tsc_hz;  // the timestamp counter's frequency, measured against the PIT
     uint64_t cycles_per_tick;
     uint8_t timer_set;
     uint32_t current_ticks;  // timeout currently being computed
     uint64_t timer_count;
     int in_timer_interrupt;
     int in_kick_interrupt;
+    // the timer is in TSC-deadline mode. Instead of ticking periodically, it
+    // fires once when the TSC reaches IA32_TSC_DEADLINE
+    bool tsc_deadline = false;
+    uint64_t tsc_per_tick = 0;   // TSC cycles in one scheduler tick
+    uint64_t next_tick_tsc = 0;  // when the next scheduler tick is due
 
     // initialize this Apic for the calling core.
     void init();
@@ -70,6 +76,8 @@ namespace x86 {
     inline uint64_t cycles_to_ns(uint64_t cycles) const { return ((cycles * 1000) / (cycles_per_us)); }
 
     void set_tickrate(uint32_t per_second);
+    // (TSC-deadline mode) arm the timer to fire when the TSC reaches `tsc`
+    void arm_deadline(uint64_t tsc);
 
     inline uint64_t ticks_per_second(void) { return bus_freq_hz; }
 
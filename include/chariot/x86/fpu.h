@@ -2,12 +2,16 @@
 
 
 #include <types.h>
+#include <arch.h>
 
 namespace fpu {
   // the FPU capabilities on this current processor
   struct fpu_caps {
     bool sse = false;
     bool xsave = false;
+    bool xsaveopt = false;    // XSAVEOPT skips components that haven't changed since the last XRSTOR
+    bool xsaves = false;      // XSAVES/XRSTORS (compacted format, with the same optimizations)
+    uint32_t xsave_size = 0;  // how big an XSAVE area is, from CPUID
   };
 
   extern struct fpu_caps caps;
@@ -21,4 +25,7 @@ namespace fpu {
 
   void init();
 
+  // the #NM handler, which gives a thread FPU state the first time it uses the FPU
+  void device_not_available(int i, reg_t *regs);
+
 };  // namespace fpu
@@ -0,0 +1,21 @@
+#pragma once
+
+typedef void (*xcall_t)(void *);
+
+#define XCALL_ASYNC 0x01  // nobody waits for this command
+
+// A cross-core call. Commands are pushed onto the target core's lock-free
+// queue (cpu::Core::xcall_queue) and run from its IPI handler.
+struct xcall_command {
+  // the function to be called on the cpu
+  xcall_t fn = nullptr;
+  // the single argument to the function when called.
+  void *arg = nullptr;
+  // decremented when an xcall is completed
+  int *count = nullptr;
+  int flags = 0;
+  // set while the command is on a queue, so an embedded command is never
+  // queued twice (see cpu::xcall_async)
+  int queued = 0;
+  struct xcall_command *next = nullptr;
+};
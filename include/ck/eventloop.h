@@ -65,6 +65,8 @@ namespace ck {
 
     static void register_notifier(ck::fsnotifier &);
     static void deregister_notifier(ck::fsnotifier &);
+    // the notifier's event mask changed
+    static void update_notifier(ck::fsnotifier &);
 
     // cause the eventlopp to exit
     static void exit(int exit_code = 0);
@@ -89,12 +91,13 @@ namespace ck {
     int m_exit_code = 0;
 
     struct pending_event {
-      inline pending_event(ck::object &obj, ck::event *ev) : obj(obj), ev(ev) {}
+      inline pending_event(ck::object *obj, ck::event *ev) : obj(obj), ev(ev) {}
       ~pending_event() = default;
 
       pending_event(pending_event &&) = default;
 
-      ck::object &obj;
+      // NULL if the object went away before the event was dispatched
+      ck::object *obj;
       ck::event *ev;
     };
 
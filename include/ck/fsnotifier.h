@@ -26,9 +26,7 @@ namespace ck {
       set_active(true);
     }
 
-    void set_event_mask(int ev) {
-      m_ev_mask = ev;
-    }
+    void set_event_mask(int ev);
 
     void set_active(bool);
 
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ck/fsnotifier.h>
+#include <ck/future.h>
+#include <ck/object.h>
+#include <ioring.h>
+
+namespace ck {
+
+  /*
+   * An ioring (see <ioring.h>) driven by the event loop. Operations are
+   * queued as they are made, and every ring's queue is submitted in one
+   * system call right before the event loop next waits. The ring's fd sits
+   * in the event loop's awaitfs set while anything is in flight, and the
+   * futures resolve from the event loop as operations complete:
+   *
+   *   ssize_t n = ck::ioring::get().read(fd, buf, sizeof(buf)).await();
+   *
+   * Results are what the system call would have returned (-errno on failure)
+   */
+  class ioring final : public ck::object {
+    CK_OBJECT(ck::ioring);
+
+   public:
+    ioring(unsigned entries = 256);
+    ~ioring(void);
+
+    // the event loop's shared ring
+    static ck::ioring &get(void);
+
+    async(long) nop(void);
+    async(long) read(int fd, void *buf, size_t len, off_t off = -1);
+    async(long) write(int fd, const void *buf, size_t len, off_t off = -1);
+    async(long) sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr = NULL,
+        size_t addrlen = 0);
+    async(long) recvfrom(int fd, void *buf, size_t len, int flags, const struct sockaddr *addr = NULL,
+        size_t addrlen = 0);
+    // resolves with the AWAITFS_* events that occurred
+    async(long) poll(int fd, int events);
+
+    // submit everything that has been queued, and resolve what has completed
+    void flush(void);
+
+    inline bool valid(void) const { return m_ring.fd >= 0; }
+    inline unsigned inflight(void) const { return m_inflight; }
+
+   private:
+    // grab an SQE, making room if we have to. NULL if the ring is jammed
+    struct ioring_sqe *get_sqe(void);
+    ck::future<long> queue(struct ioring_sqe *sqe);
+    void reap(void);
+
+    struct ::ioring m_ring;
+    ck::fsnotifier m_notifier;
+    unsigned m_inflight = 0;
+  };
+}  // namespace ck
@@ -35,7 +35,7 @@ void poll_table::wait(wait_queue &wq, short events) {
   ent->wq = &wq;
   ent->events = events;
   ent->table = this;
-  ent->entry.func = poll_table_wake;
+  ent->entry.func = wake ? wake : poll_table_wake;
   // add the entry to this waitqueue
   ent->wq->add(&ent->entry);
 
@@ -43,6 +43,40 @@ void poll_table::wait(wait_queue &wq, short events) {
 }
 
 
+int poll_table::sleep(void) {
+  bool awoken = false;
+
+  // hold every queue's lock while we check, so a wakeup can't slip in between
+  // the check and the state change
+  arch_disable_ints();
+  for (auto *e : ents)
+    if (e->wq) e->wq->lock.lock();
+
+  sched::set_state(PS_INTERRUPTIBLE);
+  for (auto *e : ents)
+    if (ATOMIC_LOAD(&e->awoken)) awoken = true;
+
+  for (auto *e : ents)
+    if (e->wq) e->wq->lock.unlock();
+  arch_enable_ints();
+
+  auto res = sched::YieldResult::None;
+  if (!awoken) res = sched::yield();
+  sched::set_state(PS_RUNNING);
+
+  return res == sched::YieldResult::Interrupt ? -EINTR : 0;
+}
+
+
+void poll_table::clear(void) {
+  for (auto *e : ents) {
+    if (e->wq) e->wq->remove(&e->entry);
+    delete e;
+  }
+  ents.clear();
+}
+
+
 struct await_table_entry {
   ck::ref<fs::File> file;
   // what are we waiting on?
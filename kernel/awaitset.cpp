@@ -0,0 +1,359 @@
+#include <awaitfs.h>
+#include <awaitset.h>
+#include <cpu.h>
+#include <errno.h>
+#include <sem.h>
+#include <sleep.h>
+#include <syscall.h>
+#include <time.h>
+
+
+struct awaitset_node;
+
+// A watch holds a reference to its file, but it never outlives the fd it was
+// added under: closing the fd (see awaitset_closed) drops it. So each file
+// keeps a list of the watches on it.
+struct awaitset_watch {
+  awaitset_node *set;
+  // the process that added it, and under which fd
+  Process *owner;
+  int fd;
+  ck::ref<fs::File> file;
+  // in file->watches
+  struct list_head file_link;
+  int events;  // AWAITFS_* | AWAITSET_*
+  void *data;
+  // registered with the file's wait queues for as long as the watch exists
+  poll_table pt;
+  // linked into set->ready while the file might be ready
+  struct list_head ready_link;
+};
+
+
+struct awaitset_node final : public fs::Node {
+  awaitset_node(void) : fs::Node(nullptr) {}
+  virtual ~awaitset_node(void) {
+    for (auto &it : watches)
+      drop(it.value);
+  }
+
+  bool is_awaitset(void) override { return true; }
+  int poll(fs::File &, int events, poll_table &pt) override;
+
+  int add(int fd, ck::ref<fs::File> file, int events, void *data);
+  int mod(awaitset_watch *w, int events, void *data);
+  void remove(int fd);
+  // fill in up to `max` events from the ready list
+  int harvest(struct awaitset_event *out, int max);
+
+  // register the watch with its file, and queue it if it is ready already
+  void arm(awaitset_watch *w);
+  void disarm(awaitset_watch *w);
+  void drop(awaitset_watch *w);
+  void queue(awaitset_watch *w);
+  awaitset_watch *pop(void);
+  bool has_ready(void);
+
+  // serializes ctl and harvesting. Held while calling into files, never
+  // from a wakeup
+  mutex lock;
+  ck::map<int, awaitset_watch *> watches;
+
+  // taken by wakeups, under the waking queue's lock
+  spinlock ready_lock;
+  struct list_head ready;
+
+  // threads in awaitset_wait (or awaitfs on the set) sleep here
+  wait_queue wq;
+};
+
+
+// called with the waking queue's lock held, possibly from an interrupt
+static bool awaitset_wake(struct wait_entry *entry, unsigned mode, int sync, void *key) {
+  auto *e = container_of(entry, struct poll_table_wait_entry, entry);
+  auto *w = container_of(e->table, struct awaitset_watch, pt);
+  // a queue that only wakes writers isn't interesting to a reader
+  if (e->events != 0 && (e->events & w->events & AWAITFS_ALL) == 0) return true;
+  w->set->queue(w);
+  return true;
+}
+
+
+void awaitset_node::queue(awaitset_watch *w) {
+  bool woke = false;
+  bool en = ready_lock.lock_irqsave();
+  if (w->ready_link.is_empty_careful()) {
+    ready.add_tail(&w->ready_link);
+    woke = true;
+  }
+  ready_lock.unlock_irqrestore(en);
+  if (woke) wq.wake_up_all();
+}
+
+
+awaitset_watch *awaitset_node::pop(void) {
+  awaitset_watch *w = nullptr;
+  bool en = ready_lock.lock_irqsave();
+  if (ready.next != &ready) {
+    w = list_entry(ready.next, awaitset_watch, ready_link);
+    w->ready_link.del_init();
+  }
+  ready_lock.unlock_irqrestore(en);
+  return w;
+}
+
+
+bool awaitset_node::has_ready(void) {
+  bool en = ready_lock.lock_irqsave();
+  bool r = ready.next != &ready;
+  ready_lock.unlock_irqrestore(en);
+  return r;
+}
+
+
+void awaitset_node::arm(awaitset_watch *w) {
+  w->pt.wake = awaitset_wake;
+  int want = w->events & AWAITFS_ALL;
+  int ev = want ? w->file->ino->poll(*w->file, want, w->pt) : 0;
+  for (auto *e : w->pt.ents) {
+    // don't pin the thread that happened to add the watch
+    e->entry.thd = nullptr;
+  }
+
+  // files that can't be waited on are always ready
+  if (want && (w->pt.ents.size() == 0 || (ev & want))) queue(w);
+}
+
+
+void awaitset_node::disarm(awaitset_watch *w) {
+  for (auto *e : w->pt.ents) {
+    // once it's off the queue, no wakeup can be running on it
+    if (e->wq) e->wq->remove(&e->entry);
+    e->entry.wq = NULL;
+    delete e;
+  }
+  w->pt.ents.clear();
+
+  bool en = ready_lock.lock_irqsave();
+  w->ready_link.del_init();
+  ready_lock.unlock_irqrestore(en);
+}
+
+
+void awaitset_node::drop(awaitset_watch *w) {
+  disarm(w);
+  {
+    scoped_irqlock l(w->file->watch_lock);
+    w->file_link.del_init();
+  }
+  delete w;
+}
+
+
+int awaitset_node::add(int fd, ck::ref<fs::File> file, int events, void *data) {
+  auto it = watches.find(fd);
+  if (it != watches.end()) {
+    if (it->value->file == file) return -EEXIST;
+    // the old file was closed, and this is something else
+    drop(it->value);
+    watches.remove(fd);
+  }
+
+  auto *w = new awaitset_watch();
+  w->set = this;
+  w->owner = curproc;
+  w->fd = fd;
+  w->file = file;
+  w->events = events;
+  w->data = data;
+  {
+    scoped_irqlock l(file->watch_lock);
+    file->watches.add_tail(&w->file_link);
+  }
+  watches.set(fd, w);
+  arm(w);
+  return 0;
+}
+
+
+int awaitset_node::mod(awaitset_watch *w, int events, void *data) {
+  disarm(w);
+  w->events = events;
+  w->data = data;
+  arm(w);
+  return 0;
+}
+
+
+void awaitset_node::remove(int fd) {
+  auto it = watches.find(fd);
+  if (it == watches.end()) return;
+  drop(it->value);
+  watches.remove(it);
+}
+
+
+int awaitset_node::harvest(struct awaitset_event *out, int max) {
+  int n = 0;
+  // level triggered watches that fired go back on the list once we're done,
+  // so they get checked again next time without us spinning on them now
+  ck::vec<awaitset_watch *> requeue;
+
+  while (n < max) {
+    auto *w = pop();
+    if (w == nullptr) break;
+
+    if (curproc->get_fd(w->fd) != w->file) {
+      remove(w->fd);
+      continue;
+    }
+
+    int want = w->events & AWAITFS_ALL;
+    if (want == 0) continue;
+
+    poll_table pt;
+    int ev = w->file->ino->poll(*w->file, want, pt);
+    if (pt.ents.size() == 0) ev = want;
+    pt.clear();
+
+    ev &= want;
+    if (ev == 0) continue;
+
+    out[n].events = ev;
+    out[n].fd = w->fd;
+    out[n].data = w->data;
+    n++;
+
+    if (w->events & AWAITSET_ONESHOT) {
+      w->events &= ~AWAITFS_ALL;
+    } else if ((w->events & AWAITSET_EDGE) == 0) {
+      requeue.push(w);
+    }
+  }
+
+  for (auto *w : requeue)
+    queue(w);
+  return n;
+}
+
+
+int awaitset_node::poll(fs::File &, int events, poll_table &pt) {
+  pt.wait(wq, AWAITFS_READ);
+  return has_ready() ? (AWAITFS_READ & events) : 0;
+}
+
+
+void awaitset_closed(Process &p, int fd, fs::File &file) {
+  if (file.watches.is_empty_careful()) return;
+
+  // The sets' locks can't be taken under the file's, so find the sets first.
+  // A set that is being destroyed drops its watches itself
+  ck::vec<ck::ref<awaitset_node>> sets;
+  {
+    scoped_irqlock l(file.watch_lock);
+    awaitset_watch *w;
+    list_for_each_entry(w, &file.watches, file_link) {
+      if (w->owner != &p || w->fd != fd) continue;
+      if (w->set->ref_try_retain()) sets.push(ck::ref<awaitset_node>(ck::ref<awaitset_node>::Adopt, *w->set));
+    }
+  }
+
+  for (auto &s : sets) {
+    scoped_mutex l(s->lock);
+    auto it = s->watches.find(fd);
+    if (it == s->watches.end() || it->value->file.get() != &file || it->value->owner != &p) continue;
+    s->drop(it->value);
+    s->watches.remove(it);
+  }
+}
+
+
+static awaitset_node *get_awaitset(int fd, ck::ref<fs::File> &file) {
+  file = curproc->get_fd(fd);
+  if (!file || !file->ino->is_awaitset()) return nullptr;
+  return (awaitset_node *)file->ino.get();
+}
+
+
+int sys::awaitset_create(int flags) {
+  if (flags != 0) return -EINVAL;
+  auto file = fs::File::create(ck::make_ref<awaitset_node>(), "[awaitset]", FDIR_READ | FDIR_WRITE);
+  return curproc->add_fd(move(file));
+}
+
+
+int sys::awaitset_ctl(int set, int op, int fd, struct awaitset_event *ev) {
+  ck::ref<fs::File> setfile;
+  auto *s = get_awaitset(set, setfile);
+  if (s == nullptr) return -EBADF;
+
+  if (op == AWAITSET_DEL) {
+    // the fd may well have been closed already
+    scoped_mutex l(s->lock);
+    if (!s->watches.contains(fd)) return -ENOENT;
+    s->remove(fd);
+    return 0;
+  }
+
+  if (!VALIDATE_RD(ev, sizeof(*ev))) return -EFAULT;
+  int events = ev->events;
+  void *data = ev->data;
+
+  auto file = curproc->get_fd(fd);
+  if (!file) return -EBADF;
+  // sets inside of sets would take their locks in either order
+  if (file->ino->is_awaitset()) return -EINVAL;
+
+  scoped_mutex l(s->lock);
+  switch (op) {
+    case AWAITSET_ADD:
+      return s->add(fd, file, events, data);
+
+    case AWAITSET_MOD: {
+      auto it = s->watches.find(fd);
+      if (it == s->watches.end() || it->value->file != file) return -ENOENT;
+      return s->mod(it->value, events, data);
+    }
+  }
+  return -EINVAL;
+}
+
+
+// timeout_time is an absolute time in ms like awaitfs, except 0 doesn't wait
+// at all and a negative timeout waits forever
+int sys::awaitset_wait(int set, struct awaitset_event *events, int max, long long timeout_time) {
+  ck::ref<fs::File> setfile;
+  auto *s = get_awaitset(set, setfile);
+  if (s == nullptr) return -EBADF;
+  if (max <= 0) return -EINVAL;
+  if (!VALIDATE_WR(events, sizeof(*events) * max)) return -EFAULT;
+
+  while (1) {
+    {
+      scoped_mutex l(s->lock);
+      int n = s->harvest(events, max);
+      if (n != 0) return n;
+    }
+    if (timeout_time == 0) return 0;
+
+    poll_table pt;
+    pt.wait(s->wq, AWAITFS_READ);
+
+    sleep_waiter sw;
+    sw.cpu = NULL;
+    if (timeout_time > 0) {
+      long long to_go = timeout_time - (long long)time::now_ms();
+      if (to_go <= 0) {
+        pt.clear();
+        return 0;
+      }
+      pt.wait(sw.wq, 0);
+      sw.start(to_go * 1000);
+    }
+
+    // we're on the queue now, so anything queued after this check wakes us
+    int err = s->has_ready() ? 0 : pt.sleep();
+    pt.clear();
+    if (err == -EINTR) return -EINTR;
+  }
+}
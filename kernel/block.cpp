@@ -34,7 +34,8 @@ static int block_flush_task(void *) {
 
 
 
-static spinlock buffer_cache_lock;
+static lock_class buffer_cache_lock_class("buffer_cache");
+static spinlock buffer_cache_lock(buffer_cache_lock_class);
 static uint64_t total_blocks_in_cache = 0;
 static ck::map<dev::BlockDevice *, ck::map<off_t, block::Buffer *>> buffer_cache;
 
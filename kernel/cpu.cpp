@@ -75,50 +75,143 @@ int sys::get_nproc(void) { return cpu::nproc(); }
 
 extern "C" int &get_errno(void) { return curthd->kerrno; }
 
-static spinlock global_xcall_lock;
+// Push a command onto a core's queue. Returns true if the queue was empty, in
+// which case the caller must send the core an IPI. Otherwise one is already
+// on the way (or the core is draining the queue), so the IPI is coalesced.
+static bool xcall_push(cpu::Core *c, struct xcall_command *cmd) {
+  cmd->next = __atomic_load_n(&c->xcall_queue, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&c->xcall_queue, &cmd->next, cmd, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  return cmd->next == nullptr;
+}
+
+static void xcall_kick(cpu::Core *c, struct xcall_command *cmd) {
+  if (xcall_push(c, cmd)) {
+    __atomic_fetch_add(&c->xcall_ipis, 1, __ATOMIC_RELAXED);
+    arch_deliver_xcall(c->id);
+  }
+}
+
 
 void cpu::run_pending_xcalls(void) {
+  bool en = arch_irqs_enabled();
   arch_disable_ints();
   auto &p = cpu::current();
-  struct xcall_command cmd = p.xcall_command;
-  memset(&p.xcall_command, 0, sizeof(p.xcall_command));
-  core().xcall_lock.unlock();
 
-  if (cmd.fn == nullptr) {
-    // printf("xcall null!\n");
-    return;
-  }
-  cmd.fn(cmd.arg);
-  if (cmd.count != NULL) {
-    __atomic_fetch_sub(cmd.count, 1, __ATOMIC_ACQ_REL);
+  while (1) {
+    // take everything that has been queued so far
+    auto *list = __atomic_exchange_n(&p.xcall_queue, nullptr, __ATOMIC_ACQUIRE);
+    if (list == nullptr) break;
+
+    // the queue is newest first, so reverse it to run commands in order
+    struct xcall_command *cmd = nullptr;
+    while (list != nullptr) {
+      auto *next = list->next;
+      list->next = cmd;
+      cmd = list;
+      list = next;
+    }
+
+    while (cmd != nullptr) {
+      // Copy everything out first. A synchronous command lives on the
+      // sender's stack and is gone as soon as the count drops.
+      auto *next = cmd->next;
+      auto fn = cmd->fn;
+      auto arg = cmd->arg;
+      auto *count = cmd->count;
+      int flags = cmd->flags;
+
+      // allow an embedded command to be queued again while it runs
+      if (flags & XCALL_ASYNC) __atomic_store_n(&cmd->queued, 0, __ATOMIC_RELEASE);
+
+      fn(arg);
+      p.xcalls_run++;
+
+      if (count != NULL) __atomic_fetch_sub(count, 1, __ATOMIC_ACQ_REL);
+      cmd = next;
+    }
   }
+
+  if (en) arch_enable_ints();
 }
 
+
 void cpu::xcall(int core, xcall_t func, void *arg) {
   int count = 0;
+  // one command per target, as each one is linked into a different queue
+  struct xcall_command cmds[CONFIG_MAX_CPUS];
+  cpu::Core *targets[CONFIG_MAX_CPUS];
+  int ntargets = 0;
+  bool self = false;
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  int me = core_id();
+
   if (core == -1) {
     // all the cores
-    cpu::each([&](cpu::Core *core) {
-      count++;
-      core->prep_xcall(func, arg, &count);
+    cpu::each([&](cpu::Core *c) {
+      if (ntargets < CONFIG_MAX_CPUS) targets[ntargets++] = c;
     });
   } else {
     auto c = cpu::get(core);
     if (c == NULL) {
       panic("invalid xcall target %d\n", core);
     }
-    count++;
-    c->prep_xcall(func, arg, &count);
+    targets[ntargets++] = c;
+  }
+
+  // The first targets can finish (and decrement `count`) before we've queued
+  // on the rest, so the count has to be complete before anything is sent
+  __atomic_store_n(&count, ntargets, __ATOMIC_RELEASE);
+
+  for (int i = 0; i < ntargets; i++) {
+    auto *c = targets[i];
+    auto &cmd = cmds[i];
+    cmd.fn = func;
+    cmd.arg = arg;
+    cmd.count = &count;
+    if (c->id == me) {
+      // no need to interrupt ourselves, we'll run it below
+      xcall_push(c, &cmd);
+      self = true;
+    } else {
+      xcall_kick(c, &cmd);
+    }
   }
-  // printf("xcall count %d\n", count);
 
-  arch_deliver_xcall(core);
+  if (self) cpu::run_pending_xcalls();
 
-  do {
-    int val = __atomic_load_n(&count, __ATOMIC_SEQ_CST);
-    if (val == 0) break;
+  // While we wait, keep draining our own queue. Another core may be
+  // waiting on us in the same way, and neither would make progress.
+  while (__atomic_load_n(&count, __ATOMIC_SEQ_CST) != 0) {
+    if (__atomic_load_n(&cpu::current().xcall_queue, __ATOMIC_RELAXED) != nullptr) cpu::run_pending_xcalls();
     arch_relax();
-  } while (1);
+  }
+
+  if (en) arch_enable_ints();
+}
+
+
+void cpu::xcall_async(int core, struct xcall_command *cmd) {
+  int expected = 0;
+  // already queued, so this call rides along with the pending one
+  if (!__atomic_compare_exchange_n(&cmd->queued, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+  cmd->flags |= XCALL_ASYNC;
+  cmd->count = nullptr;
+
+  auto c = cpu::get(core);
+  if (c == NULL) panic("invalid xcall target %d\n", core);
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  if (c->id == core_id()) {
+    xcall_push(c, cmd);
+    cpu::run_pending_xcalls();
+  } else {
+    xcall_kick(c, cmd);
+  }
+  if (en) arch_enable_ints();
 }
 
 
@@ -187,6 +280,7 @@ ksh_def("cores", "dump cpu information") {
     printf(" sched:{u:%llu,k:%llu,i:%llu,total:%llu}", cpu->kstat.user_ticks, cpu->kstat.kernel_ticks, cpu->kstat.idle_ticks, total_ticks);
     printf(" ticks:%llu", cpu->ticks_per_second);
     printf(" t:%d", cpu->timekeeper);
+    printf(" xcalls:%lu (%lu ipis)", cpu->xcalls_run, cpu->xcall_ipis);
 
     printf("\n");
 
@@ -3,6 +3,7 @@
 #include <util.h>
 #include <fs/magicfd.h>
 #include <printf.h>
+#include <vvar.h>
 
 #define round_up(x, y) (((x) + (y)-1) & ~((y)-1))
 #define round_down(x, y) ((x) & ~((y)-1))
@@ -127,12 +128,14 @@ int elf::load(const char *path, struct Process &p, mm::AddressSpace &mm, ck::ref
   Elf64_Ehdr ehdr;
 
   off_t off = 0;
+  // only committed to `p` once the load succeeds, so a failed exec leaves the
+  // caller's template alone
+  __typeof__(p.tls_info) tls;
 
 
+  // get_fd(MAGICFD_EXEC) hands this out
   p.file_lock.lock();
-  p.open_files[MAGICFD_EXEC] = fd;
   p.executable = fd;
-  p.tls_info.exists = false;
   p.file_lock.unlock();
   p.name = path;
 
@@ -200,13 +203,14 @@ int elf::load(const char *path, struct Process &p, mm::AddressSpace &mm, ck::ref
     auto &sec = phdr[i];
 
 
-    // if (sec.p_type == PT_TLS) {
-    //   printf("Found a TLS template!\n");
-    //   p.tls_info.exists = true;
-    //   p.tls_info.fileoff = sec.p_offset;
-    //   p.tls_info.fsize = sec.p_filesz;
-    //   p.tls_info.memsz = sec.p_memsz;
-    // }
+    // the template lives inside a PT_LOAD segment, so threads copy it out of their own memory
+    if (sec.p_type == PT_TLS) {
+      tls.exists = true;
+      tls.vaddr = off + sec.p_vaddr;
+      tls.fsize = sec.p_filesz;
+      tls.memsz = sec.p_memsz;
+      tls.align = sec.p_align;
+    }
 
     if (sec.p_type == PT_LOAD) {
       auto start = sec.p_vaddr;
@@ -237,5 +241,10 @@ int elf::load(const char *path, struct Process &p, mm::AddressSpace &mm, ck::ref
 
   delete[] phdr;
 
+  // give the process a read-only view of the kernel's timekeeping state
+  int err = vvar::map(mm);
+  if (err != 0) return err;
+
+  p.tls_info = tls;
   return 0;
 }
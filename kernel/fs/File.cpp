@@ -40,6 +40,11 @@ fs::File::~File(void) {
 }
 
 
+static void file_free(struct rcu_head *head) { ::operator delete(container_of(head, fs::File, m_rcu)); }
+
+void fs::File::operator delete(void *ptr) { call_rcu(&((fs::File *)ptr)->m_rcu, file_free); }
+
+
 off_t fs::File::seek(off_t offset, int whence) {
   // TODO: check if the file is actually seekable
   //
@@ -84,6 +89,16 @@ ssize_t fs::File::write(void *data, ssize_t len) {
   return ino->write(*this, (char *)data, len);
 }
 
+ssize_t fs::File::readv(const struct iovec *iov, int iovcnt, off_t off) {
+  if (!ino) return -ENOENT;
+  return ino->readv(*this, iov, iovcnt, off);
+}
+
+ssize_t fs::File::writev(const struct iovec *iov, int iovcnt, off_t off) {
+  if (!ino) return -ENOENT;
+  return ino->writev(*this, iov, iovcnt, off);
+}
+
 int fs::File::ioctl(int cmd, unsigned long arg) {
   if (!ino) return -ENOENT;
   return ino->ioctl(*this, cmd, arg);
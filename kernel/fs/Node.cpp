@@ -1,5 +1,6 @@
 #include <asm.h>
 #include <dev/driver.h>
+#include <dirent.h>
 #include <mm.h>
 #include <errno.h>
 #include <fs.h>
@@ -7,6 +8,7 @@
 #include <module.h>
 #include <printf.h>
 #include <net/sock.h>
+#include <uio.h>
 
 
 fs::Node::Node(ck::ref<fs::FileSystem> sb) : sb(sb) {
@@ -29,6 +31,76 @@ int fs::Node::resize(fs::File &, size_t) { return -ENOTIMPL; }
 int fs::Node::poll(fs::File &, int events, poll_table &pt) { return 0; }
 
 
+ssize_t fs::Node::readv(fs::File &file, const struct iovec *iov, int iovcnt, off_t off) {
+  if (off != -1) return -ESPIPE;
+
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    ssize_t n = read(file, (char *)iov[i].iov_base, iov[i].iov_len);
+    // report what we got before the error, like a short read
+    if (n < 0) return total ? total : n;
+    total += n;
+    if (n < iov[i].iov_len) break;
+  }
+  return total;
+}
+
+ssize_t fs::Node::writev(fs::File &file, const struct iovec *iov, int iovcnt, off_t off) {
+  if (off != -1) return -ESPIPE;
+
+  ssize_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    ssize_t n = write(file, (const char *)iov[i].iov_base, iov[i].iov_len);
+    if (n < 0) return total ? total : n;
+    total += n;
+    if (n < iov[i].iov_len) break;
+  }
+  return total;
+}
+
+
+ssize_t fs::Node::splice_read(fs::File &file, off_t off, size_t len, fs::splice_actor actor) {
+  auto page = mm::Page::alloc();
+  if (!page) return -ENOMEM;
+
+  ssize_t total = 0;
+  while (total < len) {
+    struct iovec iov = {p2v(page->pa()), (size_t)min(len - total, PGSIZE)};
+    off_t before = file.offset();
+    ssize_t n = readv(file, &iov, 1, off == -1 ? -1 : off + total);
+    if (n <= 0) return total ? total : n;
+
+    ssize_t took = actor(page, 0, n);
+    if (took < n && off == -1) {
+      if (file.offset() == before + n) {
+        // the read moved the file's offset, so put back what the actor left
+        file.seek(before + (took > 0 ? took : 0), SEEK_SET);
+      } else {
+        // A stream (pipe, socket, tty...) can't take the bytes back, so they
+        // must go to the actor. Keep offering the rest until it stops taking
+        // any, and report an error rather than quietly dropping them.
+        ssize_t done = took > 0 ? took : 0;
+        while (took > 0 && done < n) {
+          took = actor(page, done, n - done);
+          if (took > 0) done += took;
+        }
+        if (done < n) return took < 0 ? took : -EIO;
+        took = n;
+      }
+    }
+    if (took < 0) return total ? total : took;
+    total += took;
+    if (took < n || n < iov.iov_len) break;
+  }
+  return total;
+}
+
+ssize_t fs::Node::splice_write(fs::File &file, ck::ref<mm::Page> page, size_t pgoff, size_t len, off_t off) {
+  struct iovec iov = {(char *)p2v(page->pa()) + pgoff, len};
+  return writev(file, &iov, 1, off);
+}
+
+
 int fs::Node::stat(struct stat *stat) {
   memset(stat, 0, sizeof(*stat));
 
@@ -56,6 +128,28 @@ int fs::Node::stat(struct stat *stat) {
   return 0;
 }
 
+off_t fs::Node::getdents(fs::File &, off_t off, fs::dirent_actor actor) {
+  scoped_lock l = lock();
+
+  auto ents = dirents();
+  for (; off < ents.size(); off++) {
+    auto *ent = ents[off];
+    auto node = ent->get();
+
+    int type = DT_UNKNOWN;
+    if (node) {
+      if (node->is_dir()) type = DT_DIR;
+      if (node->is_chardev()) type = DT_CHR;
+      if (node->is_file()) type = DT_REG;
+      if (node->is_blockdev()) type = DT_BLK;
+      if (node->is_sock()) type = DT_SOCK;
+    }
+
+    if (!actor(ent->name.get(), ent->name.size(), node ? node->inode() : 0, type, off + 1)) break;
+  }
+  return off;
+}
+
 ck::ref<fs::Node> fs::Node::lookup(ck::string name) {
   auto ent = get_direntry(name);
   if (ent == nullptr) return nullptr;
@@ -0,0 +1,698 @@
+/**
+ * Futexes live in one global hash table, shared by every process. A waiter is
+ * identified by a key: for private mappings it is the (address space, virtual
+ * address) pair, and for shared mappings it is the (physical page, offset)
+ * pair, so two processes that map the same page (mshare, MAP_SHARED files)
+ * see the same futex no matter where it is mapped.
+ *
+ * Waiters are not kept in long lived per-address queues. Each blocked thread
+ * links a futex_waiter (which lives on its kernel stack) into its bucket, and
+ * unlinks it when it leaves, so there is nothing to clean up afterwards.
+ * Requeueing moves a parked waiter to another key (and maybe another bucket),
+ * which is why a waiter finds its bucket through `w.bucket` when it leaves.
+ */
+
+#include <cpu.h>
+#include <errno.h>
+#include <futex.h>
+#include <list_head.h>
+#include <lock.h>
+#include <mm.h>
+#include <module.h>
+#include <sleep.h>
+#include <syscall.h>
+#include <time.h>
+#include <wait.h>
+
+
+#define FUTEX_HASH_BITS 8
+#define FUTEX_HASH_SIZE (1 << FUTEX_HASH_BITS)
+
+
+struct futex_key {
+  // the address space (private) or the physical page (shared)
+  unsigned long base = 0;
+  // the virtual address (private) or the offset into the page, with the low
+  // bit set (shared). Futex words are 4 byte aligned, so the bit is free
+  unsigned long off = 0;
+
+  inline bool operator==(const futex_key &o) const { return base == o.base && off == o.off; }
+};
+
+
+struct futex_bucket {
+  spinlock lock;
+  struct list_head waiters;
+
+  futex_bucket(void) { waiters.init(); }
+};
+
+
+struct futex_waiter {
+  futex_key key;
+  // the bucket this waiter is linked into. Requeueing can change it
+  futex_bucket *bucket = nullptr;
+  // keeps the physical page of a shared futex from being reused while we wait
+  ck::ref<mm::Page> page;
+  // FUTEX_WAKE_BITSET only wakes waiters that share a bit with it
+  unsigned bitset = FUTEX_BITSET_MATCH_ANY;
+  // set by a waker when it unlinks us. Only touched with the bucket locked
+  bool woken = false;
+  struct list_head node;
+  // only this waiter ever sleeps on this queue
+  wait_queue wq;
+
+  // FUTEX_LOCK_PI waiters boost the owner of the lock they wait for
+  bool pi = false;
+  uint64_t prio = ~0ULL;         // the priority we lend to the owner
+  ck::ref<Thread> thread;        // the waiting thread, who is handed the lock on unlock
+  ck::ref<Thread> pi_owner;      // who we are boosting
+  struct list_head pi_node;      // in pi_owner->pi_waiters
+
+  futex_waiter(void) { node.init(); }
+};
+
+
+static futex_bucket futex_table[FUTEX_HASH_SIZE];
+
+
+static futex_bucket *futex_hash(const futex_key &key) {
+  unsigned long h = (key.base ^ (key.off >> 2)) * 0x9E3779B97F4A7C15UL;
+  return &futex_table[h >> (64 - FUTEX_HASH_BITS)];
+}
+
+
+/*
+ * Figure out which futex a user address refers to. Shared futexes also
+ * return the page they live in, which the caller must hold on to for as long
+ * as the key is in use.
+ */
+static int futex_get_key(int *uaddr, bool priv, futex_key &key, ck::ref<mm::Page> &page) {
+  off_t va = (off_t)uaddr;
+  auto &mm = *curproc->mm;
+
+  bool shared = false;
+  if (!priv) {
+    scoped_mutex l(mm.lock);
+    auto *r = mm.lookup(va);
+    if (r == NULL) return -EFAULT;
+    shared = (r->flags & MAP_SHARED) != 0;
+  }
+
+  if (!shared) {
+    key.base = (unsigned long)&mm;
+    key.off = va;
+    return 0;
+  }
+
+  page = mm.get_page(va);
+  if (!page) return -EFAULT;
+  key.base = page->pa();
+  key.off = (va & 0xFFF) | 1;
+  return 0;
+}
+
+
+// unlink and wake a waiter. The waiter's bucket must be locked.
+static void futex_wake_waiter(futex_waiter *w) {
+  w->node.del_init();
+  w->woken = true;
+  // This must happen with the bucket locked: the waiter re-takes the lock
+  // before it returns, so `w` cannot go out of scope under us.
+  w->wq.wake_up();
+}
+
+
+/*
+ * Take a waiter out of its bucket when it stops waiting. Returns false if a
+ * waker got to it first (a real wakeup).
+ */
+static bool futex_unqueue(futex_waiter &w) {
+  while (1) {
+    auto *b = __atomic_load_n(&w.bucket, __ATOMIC_ACQUIRE);
+    scoped_lock l(b->lock);
+    // the waiter was moved while we were taking the lock
+    if (b != w.bucket) continue;
+
+    if (w.woken) return false;
+    w.node.del_init();
+    return true;
+  }
+}
+
+
+static void futex_lock_pair(futex_bucket *a, futex_bucket *b) {
+  // always lock in the same order, so two requeues in opposite directions
+  // don't deadlock
+  if (a > b) {
+    auto *t = a;
+    a = b;
+    b = t;
+  }
+  a->lock.lock();
+  if (a != b) b->lock.lock();
+}
+
+
+static void futex_unlock_pair(futex_bucket *a, futex_bucket *b) {
+  a->lock.unlock();
+  if (a != b) b->lock.unlock();
+}
+
+
+// wake up to `nr` waiters on `key` that share a bit with `bitset`. The bucket must be locked.
+static int futex_wake_locked(futex_bucket *b, const futex_key &key, int nr, unsigned bitset) {
+  int woken = 0;
+  futex_waiter *w, *n;
+  list_for_each_entry_safe(w, n, &b->waiters, node) {
+    if (woken >= nr) break;
+    if (w->pi || !(w->key == key) || (w->bitset & bitset) == 0) continue;
+    futex_wake_waiter(w);
+    woken++;
+  }
+  return woken;
+}
+
+
+/*
+ * Read a user's timeout into a number of microseconds to sleep. Returns 0, or
+ * -ETIMEDOUT if an absolute timeout has already passed.
+ */
+static int futex_get_timeout(unsigned long uts, bool absolute, long long &us) {
+  us = -1;
+  if (uts == 0) return 0;
+
+  auto *ts = (struct futex_timespec *)uts;
+  if (!VALIDATE_RD(ts, sizeof(*ts))) return -EFAULT;
+
+  struct futex_timespec t = *ts;
+  if (t.tv_sec < 0 || t.tv_nsec < 0 || t.tv_nsec >= 1000000000L) return -EINVAL;
+
+  long long ns = t.tv_sec * 1000000000LL + t.tv_nsec;
+  if (absolute) {
+    long long now = time::now_ns();
+    if (ns <= now) return -ETIMEDOUT;
+    ns -= now;
+  }
+
+  // round up, so we never wake before the deadline
+  us = (ns + 999) / 1000;
+  return 0;
+}
+
+
+static int futex_wait(int *uaddr, int val, unsigned bitset, long long timeout_us, bool priv) {
+  if (bitset == 0) return -EINVAL;
+
+  futex_waiter w;
+  w.bitset = bitset;
+  int err = futex_get_key(uaddr, priv, w.key, w.page);
+  if (err != 0) return err;
+
+  // Fault the word in now, as we can't take a page fault under the bucket lock
+  int current_value = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+  if (current_value != val) return -EAGAIN;
+
+  // the timer lives on the stack next to us. It must outlive its wait_entry
+  sleep_waiter timer;
+  wait_entry ent, timer_ent;
+
+  auto *b = w.bucket = futex_hash(w.key);
+  b->lock.lock();
+  b->waiters.add_tail(&w.node);
+  prepare_to_wait(w.wq, ent, true);
+
+  /*
+   * The load and the comparison happen with the bucket locked, so a waker
+   * that changes the word and then calls FUTEX_WAKE cannot slip between them
+   * and us going to sleep.
+   */
+  current_value = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+  if (current_value != val) {
+    w.node.del_init();
+    b->lock.unlock();
+    return -EAGAIN;
+  }
+
+  // Nothing can wake us until the bucket is unlocked or the timer is armed, so
+  // this is the last point we can mark ourselves as waiting on the timer.
+  if (timeout_us >= 0) {
+    prepare_to_wait(timer.wq, timer_ent, true);
+    timer.start(timeout_us);
+  }
+  b->lock.unlock();
+
+  auto res = ent.start();
+
+  if (!futex_unqueue(w)) return 0;
+  if (res.interrupted()) return -EINTR;
+  if (timeout_us >= 0 && timer.wakeup_us <= time::now_us()) return -ETIMEDOUT;
+  // a spurious wakeup. Userspace has to recheck the word anyways
+  return 0;
+}
+
+
+static int futex_wake(int *uaddr, int nr, unsigned bitset, bool priv) {
+  if (bitset == 0) return -EINVAL;
+
+  futex_key key;
+  ck::ref<mm::Page> page;
+  int err = futex_get_key(uaddr, priv, key, page);
+  if (err != 0) return err;
+
+  if (nr <= 0) return 0;
+
+  auto *b = futex_hash(key);
+  scoped_lock l(b->lock);
+  return futex_wake_locked(b, key, nr, bitset);
+}
+
+
+/*
+ * Wake `nr_wake` waiters on uaddr and move up to `nr_requeue` of the rest over
+ * to uaddr2 without waking them. This lets a condvar broadcast wake a single
+ * thread, and hand the rest to the mutex they would all fight over anyways.
+ * If `cmp` is set, the word at uaddr must still be `cmpval`.
+ */
+static int futex_requeue(int *uaddr, int *uaddr2, int nr_wake, int nr_requeue, bool cmp, int cmpval, bool priv) {
+  if (nr_wake < 0 || nr_requeue < 0) return -EINVAL;
+  if (!VALIDATE_RD(uaddr2, 4) || ((off_t)uaddr2 & 0x3) != 0) return -EINVAL;
+
+  futex_key key1, key2;
+  ck::ref<mm::Page> page1, page2;
+  int err = futex_get_key(uaddr, priv, key1, page1);
+  if (err != 0) return err;
+  err = futex_get_key(uaddr2, priv, key2, page2);
+  if (err != 0) return err;
+
+  // fault the word in before we take any locks
+  if (cmp && __atomic_load_n(uaddr, __ATOMIC_ACQUIRE) != cmpval) return -EAGAIN;
+
+  auto *b1 = futex_hash(key1);
+  auto *b2 = futex_hash(key2);
+  futex_lock_pair(b1, b2);
+
+  if (cmp && __atomic_load_n(uaddr, __ATOMIC_ACQUIRE) != cmpval) {
+    futex_unlock_pair(b1, b2);
+    return -EAGAIN;
+  }
+
+  int woken = 0, moved = 0;
+  futex_waiter *w, *n;
+  list_for_each_entry_safe(w, n, &b1->waiters, node) {
+    if (w->pi || !(w->key == key1)) continue;
+
+    if (woken < nr_wake) {
+      futex_wake_waiter(w);
+      woken++;
+      continue;
+    }
+
+    if (moved >= nr_requeue) break;
+
+    // the waiter is parked, so we are free to rewrite its key
+    w->node.del_init();
+    w->key = key2;
+    w->page = page2;
+    b2->waiters.add_tail(&w->node);
+    __atomic_store_n(&w->bucket, b2, __ATOMIC_RELEASE);
+    moved++;
+  }
+
+  futex_unlock_pair(b1, b2);
+  return woken + moved;
+}
+
+
+static int futex_wake_op(int *uaddr, int *uaddr2, int nr_wake, int nr_wake2, unsigned encoded, bool priv) {
+  if (!VALIDATE_RDWR(uaddr2, 4) || ((off_t)uaddr2 & 0x3) != 0) return -EINVAL;
+
+  int op = (encoded >> 28) & 0xf;
+  int cmp = (encoded >> 24) & 0xf;
+  int oparg = (int)(encoded << 8) >> 20;
+  int cmparg = (int)(encoded << 20) >> 20;
+
+  if (op & FUTEX_OP_OPARG_SHIFT) {
+    if (oparg < 0 || oparg > 31) return -EINVAL;
+    oparg = 1 << oparg;
+    op &= ~FUTEX_OP_OPARG_SHIFT;
+  }
+  if (op > FUTEX_OP_XOR || cmp > FUTEX_OP_CMP_GE) return -ENOSYS;
+
+  futex_key key1, key2;
+  ck::ref<mm::Page> page1, page2;
+  int err = futex_get_key(uaddr, priv, key1, page1);
+  if (err != 0) return err;
+  err = futex_get_key(uaddr2, priv, key2, page2);
+  if (err != 0) return err;
+
+  /*
+   * The update doesn't need the bucket locks. Just like a plain store followed
+   * by FUTEX_WAKE, anyone who saw the old value is queued by the time we look.
+   */
+  int old = __atomic_load_n(uaddr2, __ATOMIC_RELAXED);
+  int next;
+  do {
+    switch (op) {
+      case FUTEX_OP_SET:
+        next = oparg;
+        break;
+      case FUTEX_OP_ADD:
+        next = old + oparg;
+        break;
+      case FUTEX_OP_OR:
+        next = old | oparg;
+        break;
+      case FUTEX_OP_ANDN:
+        next = old & ~oparg;
+        break;
+      default:
+        next = old ^ oparg;
+        break;
+    }
+  } while (!__atomic_compare_exchange_n(uaddr2, &old, next, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+  bool cond = false;
+  switch (cmp) {
+    case FUTEX_OP_CMP_EQ:
+      cond = old == cmparg;
+      break;
+    case FUTEX_OP_CMP_NE:
+      cond = old != cmparg;
+      break;
+    case FUTEX_OP_CMP_LT:
+      cond = old < cmparg;
+      break;
+    case FUTEX_OP_CMP_LE:
+      cond = old <= cmparg;
+      break;
+    case FUTEX_OP_CMP_GT:
+      cond = old > cmparg;
+      break;
+    case FUTEX_OP_CMP_GE:
+      cond = old >= cmparg;
+      break;
+  }
+
+  auto *b1 = futex_hash(key1);
+  auto *b2 = futex_hash(key2);
+  futex_lock_pair(b1, b2);
+  int woken = futex_wake_locked(b1, key1, nr_wake, FUTEX_BITSET_MATCH_ANY);
+  if (cond) woken += futex_wake_locked(b2, key2, nr_wake2, FUTEX_BITSET_MATCH_ANY);
+  futex_unlock_pair(b1, b2);
+
+  return woken;
+}
+
+
+
+/*
+ * Priority inheritance. The word of a PI futex holds the owner's tid, and
+ * FUTEX_WAITERS if anyone is blocked in the kernel. Userspace locks and
+ * unlocks uncontended PI futexes with a cmpxchg on its own, and only calls
+ * FUTEX_LOCK_PI or FUTEX_UNLOCK_PI if that fails.
+ *
+ * Every PI waiter sits on its owner's pi_waiters list, and the owner runs at
+ * the most urgent priority on that list. Unlocking hands the futex straight to
+ * the most urgent waiter, and the rest start boosting that thread instead.
+ * Only the direct owner is boosted: if it is itself blocked on another PI
+ * futex, the boost does not propagate down the chain.
+ */
+
+
+// recompute the priority a thread inherits from its waiters
+static void futex_pi_update(Thread *t) {
+  uint64_t prio = ~0ULL;
+
+  scoped_lock l(t->pi_lock);
+  futex_waiter *w;
+  list_for_each_entry(w, &t->pi_waiters, pi_node) {
+    if (w->prio < prio) prio = w->prio;
+  }
+  if (prio != t->pi_priority) t->set_pi_priority(prio);
+}
+
+
+// start boosting `owner`. The waiter's bucket must be locked
+static void futex_pi_link(futex_waiter *w, ck::ref<Thread> owner) {
+  w->pi_owner = owner;
+  scoped_lock l(owner->pi_lock);
+  owner->pi_waiters.add_tail(&w->pi_node);
+}
+
+
+// stop boosting whoever we were boosting. The waiter's bucket must be locked
+static ck::ref<Thread> futex_pi_unlink(futex_waiter *w) {
+  auto owner = w->pi_owner;
+  if (!owner) return nullptr;
+
+  owner->pi_lock.lock();
+  w->pi_node.del_init();
+  owner->pi_lock.unlock();
+  w->pi_owner = nullptr;
+  return owner;
+}
+
+
+static bool futex_has_pi_waiters(futex_bucket *b, const futex_key &key) {
+  futex_waiter *w;
+  list_for_each_entry(w, &b->waiters, node) {
+    if (w->pi && w->key == key) return true;
+  }
+  return false;
+}
+
+
+static int futex_lock_pi(int *uaddr, long long timeout_us, bool trylock, bool priv) {
+  if (!VALIDATE_RDWR(uaddr, 4)) return -EINVAL;
+
+  futex_waiter w;
+  int err = futex_get_key(uaddr, priv, w.key, w.page);
+  if (err != 0) return err;
+
+  int tid = curthd->tid;
+  w.pi = true;
+  w.thread = curthd;
+
+  // Fault the word in for writing, as we can't take a page fault under the bucket lock
+  __atomic_fetch_or(uaddr, 0, __ATOMIC_RELAXED);
+
+  sleep_waiter timer;
+  bool armed = false;
+  // PI waiters are never requeued, so our bucket can't change
+  auto *b = w.bucket = futex_hash(w.key);
+
+  while (1) {
+    wait_entry ent, timer_ent;
+    ck::ref<Thread> owner;
+
+    b->lock.lock();
+    int word = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+    while (1) {
+      if ((word & FUTEX_TID_MASK) == 0) {
+        // the lock is free, take it.
+        int next = tid | (futex_has_pi_waiters(b, w.key) ? FUTEX_WAITERS : 0);
+        if (__atomic_compare_exchange_n(uaddr, &word, next, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+          b->lock.unlock();
+          return 0;
+        }
+        continue;
+      }
+
+      if ((word & FUTEX_TID_MASK) == tid) {
+        b->lock.unlock();
+        return -EDEADLK;
+      }
+
+      if (trylock) {
+        b->lock.unlock();
+        return -EBUSY;
+      }
+
+      // make the owner come to us when it unlocks
+      if ((word & FUTEX_WAITERS) == 0 &&
+          !__atomic_compare_exchange_n(uaddr, &word, word | FUTEX_WAITERS, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        continue;
+      }
+
+      // userspace wrote the tid, so it might not be a thread at all
+      owner = Thread::find(word & FUTEX_TID_MASK);
+      break;
+    }
+
+    // the owner exited without unlocking (or never existed)
+    if (!owner || owner->get_state() == PS_ZOMBIE) {
+      b->lock.unlock();
+      return -ESRCH;
+    }
+
+    w.prio = curthd->priority();
+    b->waiters.add_tail(&w.node);
+    futex_pi_link(&w, owner);
+    futex_pi_update(owner.get());
+    prepare_to_wait(w.wq, ent, true);
+
+    if (timeout_us >= 0) {
+      prepare_to_wait(timer.wq, timer_ent, true);
+      if (!armed) {
+        timer.start(timeout_us);
+        armed = true;
+      }
+    }
+    b->lock.unlock();
+
+    auto res = ent.start();
+
+    b->lock.lock();
+    // FUTEX_UNLOCK_PI handed the lock to us (and already unlinked us)
+    if (w.woken) {
+      b->lock.unlock();
+      return 0;
+    }
+    w.node.del_init();
+    owner = futex_pi_unlink(&w);
+    futex_pi_update(owner.get());
+    b->lock.unlock();
+
+    if (res.interrupted()) return -EINTR;
+    if (armed && timer.wakeup_us <= time::now_us()) return -ETIMEDOUT;
+  }
+}
+
+
+static int futex_unlock_pi(int *uaddr, bool priv) {
+  if (!VALIDATE_RDWR(uaddr, 4)) return -EINVAL;
+
+  futex_key key;
+  ck::ref<mm::Page> page;
+  int err = futex_get_key(uaddr, priv, key, page);
+  if (err != 0) return err;
+
+  int tid = curthd->tid;
+  __atomic_fetch_or(uaddr, 0, __ATOMIC_RELAXED);
+
+  auto *b = futex_hash(key);
+  scoped_lock l(b->lock);
+
+  int word = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
+  if ((word & FUTEX_TID_MASK) != tid) return -EPERM;
+
+  // The most urgent waiter gets the lock, FIFO among equals
+  futex_waiter *next = NULL, *w;
+  list_for_each_entry(w, &b->waiters, node) {
+    if (!w->pi || !(w->key == key)) continue;
+    if (next == NULL || w->prio < next->prio) next = w;
+  }
+
+  if (next == NULL) {
+    __atomic_store_n(uaddr, 0, __ATOMIC_RELEASE);
+    return 0;
+  }
+
+  // everyone else now waits on (and boosts) the new owner
+  bool more = false;
+  list_for_each_entry(w, &b->waiters, node) {
+    if (w == next || !w->pi || !(w->key == key)) continue;
+    futex_pi_unlink(w);
+    futex_pi_link(w, next->thread);
+    more = true;
+  }
+  futex_pi_unlink(next);
+
+  __atomic_store_n(uaddr, next->thread->tid | (more ? FUTEX_WAITERS : 0), __ATOMIC_RELEASE);
+
+  futex_pi_update(curthd);
+  futex_pi_update(next->thread.get());
+  futex_wake_waiter(next);
+  return 0;
+}
+
+
+
+/*
+ * val2 is either a pointer to a struct futex_timespec (the waits) or a count
+ * (requeue and wake_op), just like on Linux.
+ */
+int sys::futex(int *uaddr, int op, int val, unsigned long val2, int *uaddr2, int val3) {
+  /* If the user can't read the address, it's invalid. */
+  if (!VALIDATE_RD(uaddr, 4)) return -EINVAL;
+
+  off_t addr = (off_t)uaddr;
+  /* the address must be word aligned (4 bytes) */
+  if ((addr & 0x3) != 0) return -EINVAL;
+
+  bool priv = (op & FUTEX_PRIVATE_FLAG) != 0;
+  long long timeout_us = -1;
+  int err;
+
+  switch (op & FUTEX_CMD_MASK) {
+    /*
+     * This follows the general idea of Linux's:
+     * This operation tests that the value at the futex word pointed to by the address uaddr still
+     * contains the expected value val, and if so, then sleeps waiting for a FUTEX_WAKE operation
+     * on the futex word. The load of the value of the futex word is an atomic memory access (i.e.,
+     * using atomic machine instructions of the respective architecture). This load, the comparison
+     * with the expected value, and starting to sleep are performed atomically and totally ordered
+     * with respect to other futex operations on the same futex word. If the thread starts to
+     * sleep, it is considered a waiter on this futex word. If the futex value does not match val,
+     * then the call fails immediately with the error EAGAIN.
+     */
+    case FUTEX_WAIT:
+      err = futex_get_timeout(val2, false, timeout_us);
+      if (err != 0) return err;
+      return futex_wait(uaddr, val, FUTEX_BITSET_MATCH_ANY, timeout_us, priv);
+
+    case FUTEX_WAIT_BITSET:
+      err = futex_get_timeout(val2, true, timeout_us);
+      if (err != 0) return err;
+      return futex_wait(uaddr, val, val3, timeout_us, priv);
+
+    /* Wake at most `val` waiters, returning how many were woken */
+    case FUTEX_WAKE:
+      return futex_wake(uaddr, val, FUTEX_BITSET_MATCH_ANY, priv);
+
+    case FUTEX_WAKE_BITSET:
+      return futex_wake(uaddr, val, val3, priv);
+
+    case FUTEX_REQUEUE:
+      return futex_requeue(uaddr, uaddr2, val, (int)val2, false, 0, priv);
+
+    case FUTEX_CMP_REQUEUE:
+      return futex_requeue(uaddr, uaddr2, val, (int)val2, true, val3, priv);
+
+    case FUTEX_WAKE_OP:
+      return futex_wake_op(uaddr, uaddr2, val, (int)val2, val3, priv);
+
+    case FUTEX_LOCK_PI:
+      err = futex_get_timeout(val2, true, timeout_us);
+      if (err != 0) return err;
+      return futex_lock_pi(uaddr, timeout_us, false, priv);
+
+    case FUTEX_TRYLOCK_PI:
+      return futex_lock_pi(uaddr, -1, true, priv);
+
+    case FUTEX_UNLOCK_PI:
+      return futex_unlock_pi(uaddr, priv);
+
+    /* There is no per-futex state left around to destroy */
+    case FUTEX_DSTR:
+      return 0;
+  }
+
+  return -EINVAL;
+}
+
+
+
+ksh_def("futex", "display the waiters in the global futex table") {
+  for (int i = 0; i < FUTEX_HASH_SIZE; i++) {
+    auto &b = futex_table[i];
+    scoped_lock l(b.lock);
+    futex_waiter *w;
+    list_for_each_entry(w, &b.waiters, node) {
+      printf("bucket %3d: %s key %p+%lx%s\n", i, (w->key.off & 1) ? "shared " : "private", w->key.base,
+          w->key.off & ~1UL, w->pi ? " (pi)" : "");
+    }
+  }
+  return 0;
+}
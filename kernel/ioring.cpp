@@ -0,0 +1,354 @@
+#include <awaitfs.h>
+#include <cpu.h>
+#include <errno.h>
+#include <ioring.h>
+#include <mm.h>
+#include <net/sock.h>
+#include <phys.h>
+#include <sem.h>
+#include <syscall.h>
+#include <uio.h>
+
+
+// Everything runs in the context of the process that submitted it, either
+// inline when it submits, or on a later ioring_enter(). The buffers in the
+// SQEs are user pointers, so a kernel worker (which does not share the
+// process's address space) couldn't run them anyway. The fd is looked up once
+// at submission and the file is held from then on, so another process that
+// shares the ring (or a later dup2 over the fd) can't change what it refers to.
+//
+// The ring itself lives in physically contiguous kernel memory, which the
+// process maps through the fd, so the kernel reads it through p2v() without
+// worrying about what the process has done to its mappings. The process can
+// write anything to the header, though, so the only fields read back out of
+// it are the ones it owns (sq.tail and cq.head). The sizes, masks and the
+// kernel's own indices are kept in the node and only ever copied out.
+
+#define IORING_HDR_SIZE round_up(sizeof(struct ioring_hdr), 64)
+
+
+// an operation that was submitted before its fd was ready
+struct ioring_pending {
+  struct ioring_sqe sqe;
+  ck::ref<fs::File> file;
+  long pid;  // who submitted it. Its buffers are in that process's address space
+};
+
+
+struct ioring_node final : public fs::Node {
+  ioring_node(unsigned sq_entries, unsigned cq_entries) : fs::Node(nullptr) {
+    size = IORING_HDR_SIZE + sq_entries * sizeof(struct ioring_sqe) + cq_entries * sizeof(struct ioring_cqe);
+    npages = NPAGES(size);
+
+    pa = (unsigned long)phys::alloc(npages);
+    hdr = (struct ioring_hdr *)p2v(pa);
+    memset(hdr, 0, npages * PGSIZE);
+    for (int i = 0; i < npages; i++)
+      pages.push(mm::Page::create(pa + i * PGSIZE));
+
+    this->sq_entries = sq_entries;
+    this->cq_entries = cq_entries;
+    hdr->sq.entries = sq_entries;
+    hdr->sq.mask = sq_entries - 1;
+    hdr->cq.entries = cq_entries;
+    hdr->cq.mask = cq_entries - 1;
+    hdr->sqes_off = IORING_HDR_SIZE;
+    hdr->cqes_off = IORING_HDR_SIZE + sq_entries * sizeof(struct ioring_sqe);
+    sqes = (struct ioring_sqe *)((char *)hdr + hdr->sqes_off);
+    cqes = (struct ioring_cqe *)((char *)hdr + hdr->cqes_off);
+  }
+
+  virtual ~ioring_node(void) {
+    pages.clear();
+    phys::free((void *)pa, npages);
+  }
+
+  bool is_ioring(void) override { return true; }
+
+  ck::ref<mm::VMObject> mmap(fs::File &, size_t npages, int prot, int flags, off_t off) override;
+  int poll(fs::File &, int events, poll_table &pt) override;
+
+  int submit(unsigned to_submit);
+  // retry the current process's parked operations, returning how many of
+  // them are still waiting
+  int run_pending(void);
+  // how many CQEs are waiting for userspace
+  unsigned cq_ready(void);
+  void complete(unsigned long user_data, long res);
+
+  size_t size;
+  int npages;
+  unsigned long pa;
+  ck::vec<ck::ref<mm::Page>> pages;
+
+  struct ioring_hdr *hdr;
+  struct ioring_sqe *sqes;
+  struct ioring_cqe *cqes;
+
+  // the kernel's copies of what it publishes in `hdr`
+  unsigned sq_entries;
+  unsigned cq_entries;
+  unsigned sq_head = 0;
+  unsigned cq_tail = 0;
+
+  // held while consuming SQEs and running operations. Operations on regular
+  // files may sleep, so this can't be a spinlock
+  mutex lock;
+  ck::vec<ioring_pending> pending;
+};
+
+
+struct ioring_vmobject final : public mm::VMObject {
+  ioring_vmobject(ck::ref<ioring_node> ring) : VMObject(ring->npages), ring(ring) {}
+  virtual ~ioring_vmobject(void) {}
+
+  virtual ck::ref<mm::Page> get_shared(off_t n) override { return ring->pages[n]; }
+
+  ck::ref<ioring_node> ring;
+};
+
+
+ck::ref<mm::VMObject> ioring_node::mmap(fs::File &, size_t npages, int prot, int flags, off_t off) {
+  if (off != 0 || npages > this->npages) return nullptr;
+  if ((flags & MAP_SHARED) == 0) return nullptr;
+  return ck::make_ref<ioring_vmobject>(this);
+}
+
+
+unsigned ioring_node::cq_ready(void) {
+  unsigned used = cq_tail - __atomic_load_n(&hdr->cq.head, __ATOMIC_ACQUIRE);
+  // userspace owns head. Don't trust it to be sane
+  if (used > cq_entries) return cq_entries;
+  return used;
+}
+
+
+void ioring_node::complete(unsigned long user_data, long res) {
+  auto &cqe = cqes[cq_tail & (cq_entries - 1)];
+  cqe.user_data = user_data;
+  cqe.res = res;
+  cq_tail++;
+  __atomic_store_n(&hdr->cq.tail, cq_tail, __ATOMIC_RELEASE);
+}
+
+
+// which AWAITFS_* events an operation needs before it can run without blocking
+static int ioring_op_events(const struct ioring_sqe &sqe) {
+  switch (sqe.op) {
+    case IORING_OP_READ:
+    case IORING_OP_RECVFROM:
+      return AWAITFS_READ;
+    case IORING_OP_WRITE:
+    case IORING_OP_SENDTO:
+      return AWAITFS_WRITE;
+    case IORING_OP_POLL:
+      return sqe.op_flags;
+  }
+  return 0;
+}
+
+
+// positioned reads and writes leave the file's offset where it was
+static long ioring_rw(fs::File &file, const struct ioring_sqe &sqe, bool write) {
+  int prot = write ? PROT_READ : PROT_WRITE;
+  if (!curproc->mm->validate_pointer((void *)sqe.addr, sqe.len, prot)) return -EFAULT;
+
+  if (sqe.off < -1) return -EINVAL;
+  struct iovec iov = {(void *)sqe.addr, sqe.len};
+  return write ? file.writev(&iov, 1, sqe.off) : file.readv(&iov, 1, sqe.off);
+}
+
+
+static long ioring_sock(fs::File &file, const struct ioring_sqe &sqe, bool send) {
+  if (!file.ino->is_sock()) return -EINVAL;
+  if (!curproc->mm->validate_pointer((void *)sqe.addr, sqe.len, send ? PROT_READ : PROT_WRITE)) return -EFAULT;
+  auto *addr = (const struct sockaddr *)sqe.addr2;
+  if (addr != NULL && !VALIDATE_RD(addr, sqe.addr2_len)) return -EFAULT;
+
+  auto *sock = (net::Socket *)file.ino.get();
+  if (send) return sock->sendto(file, (void *)sqe.addr, sqe.len, sqe.op_flags, addr, sqe.addr2_len);
+  return sock->recvfrom(file, (void *)sqe.addr, sqe.len, sqe.op_flags, addr, sqe.addr2_len);
+}
+
+
+// Run an operation if it won't block. Returns false if it has to wait for its
+// file, otherwise `res` is its result.
+static bool ioring_try_op(const struct ioring_sqe &sqe, fs::File *file, long &res) {
+  if (sqe.op == IORING_OP_NOP) {
+    res = 0;
+    return true;
+  }
+
+  int want = ioring_op_events(sqe);
+  poll_table pt;
+  int ev = file->ino->poll(*file, want, pt);
+  // a file that doesn't register with any wait queue can't be waited on, and
+  // is treated as always ready (regular files, for example)
+  bool pollable = pt.ents.size() != 0;
+  pt.clear();
+  if (!pollable) ev = want;
+  if ((ev & want) == 0) return false;
+
+  switch (sqe.op) {
+    case IORING_OP_READ:
+      res = ioring_rw(*file, sqe, false);
+      break;
+    case IORING_OP_WRITE:
+      res = ioring_rw(*file, sqe, true);
+      break;
+    case IORING_OP_SENDTO:
+      res = ioring_sock(*file, sqe, true);
+      break;
+    case IORING_OP_RECVFROM:
+      res = ioring_sock(*file, sqe, false);
+      break;
+    case IORING_OP_POLL:
+      res = ev & want;
+      break;
+    default:
+      res = -EINVAL;
+      break;
+  }
+  return true;
+}
+
+
+int ioring_node::run_pending(void) {
+  int n = 0;
+  int waiting = 0;
+  long res;
+  // keep the ones that still can't run, in the order they were submitted
+  for (int i = 0; i < pending.size(); i++) {
+    auto &p = pending[i];
+    bool ours = p.pid == curproc->pid;
+    if (ours && ioring_try_op(p.sqe, p.file.get(), res)) {
+      complete(p.sqe.user_data, res);
+      continue;
+    }
+    if (ours) waiting++;
+    if (n != i) pending[n] = move(p);
+    n++;
+  }
+  pending.shrink(n);
+  return waiting;
+}
+
+
+// Look up the file an SQE operates on. Returns an error to complete it with
+// if it can't be used.
+static long ioring_get_file(const struct ioring_sqe &sqe, ck::ref<fs::File> &file) {
+  if (sqe.op == IORING_OP_NOP) return 0;
+  file = curproc->get_fd(sqe.fd);
+  if (!file) return -EBADF;
+  // Parked operations are polled with the ring's lock held. Polling a ring
+  // from inside itself would deadlock, and rings or awaitsets polling each
+  // other would take their locks in either order.
+  if (file->ino->is_ioring() || file->ino->is_awaitset()) return -EINVAL;
+  return 0;
+}
+
+
+int ioring_node::submit(unsigned to_submit) {
+  unsigned tail = __atomic_load_n(&hdr->sq.tail, __ATOMIC_ACQUIRE);
+  unsigned avail = tail - sq_head;
+  if (avail > sq_entries) return -EINVAL;
+  if (to_submit > avail) to_submit = avail;
+
+  int submitted = 0;
+  for (; submitted < to_submit; submitted++) {
+    // only take an SQE if its completion is guaranteed a slot, so the CQ
+    // can never overflow
+    if (cq_ready() + pending.size() >= cq_entries) break;
+
+    // copy it out first. userspace can change the shared one under us
+    struct ioring_sqe sqe = sqes[sq_head & (sq_entries - 1)];
+    sq_head++;
+    __atomic_store_n(&hdr->sq.head, sq_head, __ATOMIC_RELEASE);
+
+    ck::ref<fs::File> file;
+    long res = ioring_get_file(sqe, file);
+    if (res != 0 || ioring_try_op(sqe, file.get(), res)) {
+      complete(sqe.user_data, res);
+    } else {
+      pending.push({sqe, move(file), curproc->pid});
+    }
+  }
+  return submitted;
+}
+
+
+int ioring_node::poll(fs::File &, int events, poll_table &pt) {
+  scoped_mutex l(lock);
+  int ev = 0;
+  if (cq_ready() != 0) ev |= AWAITFS_READ;
+
+  // forward to everything the parked operations are waiting on, so a waiter
+  // wakes up once one of them can run
+  for (auto &p : pending) {
+    int want = ioring_op_events(p.sqe);
+    if (p.file->ino->poll(*p.file, want, pt) & want) ev |= AWAITFS_READ;
+  }
+  return ev & events;
+}
+
+
+int sys::ioring_setup(unsigned entries, struct ioring_params *params) {
+  if (!VALIDATE_WR(params, sizeof(*params))) return -EFAULT;
+  if (entries == 0 || entries > IORING_MAX_ENTRIES) return -EINVAL;
+
+  unsigned sq_entries = 1;
+  while (sq_entries < entries)
+    sq_entries <<= 1;
+  unsigned cq_entries = sq_entries * 2;
+
+  auto ring = ck::make_ref<ioring_node>(sq_entries, cq_entries);
+  auto file = fs::File::create(ring, "[ioring]", FDIR_READ | FDIR_WRITE);
+
+  params->sq_entries = sq_entries;
+  params->cq_entries = cq_entries;
+  params->ring_size = ring->npages * PGSIZE;
+  return curproc->add_fd(move(file));
+}
+
+
+int sys::ioring_enter(int fd, unsigned to_submit, unsigned min_complete, int flags) {
+  if (flags != 0) return -EINVAL;
+
+  auto file = curproc->get_fd(fd);
+  if (!file) return -EBADF;
+  if (!file->ino->is_ioring()) return -EINVAL;
+  auto *ring = (ioring_node *)file->ino.get();
+
+  ring->lock.lock();
+  int submitted = ring->submit(to_submit);
+  if (submitted < 0) {
+    ring->lock.unlock();
+    return submitted;
+  }
+
+  if (min_complete > ring->cq_entries) min_complete = ring->cq_entries;
+
+  while (1) {
+    int waiting = ring->run_pending();
+    if (ring->cq_ready() >= min_complete || waiting == 0) break;
+
+    // sleep until one of our parked operations' files wakes us up
+    poll_table pt;
+    bool ready = false;
+    for (auto &p : ring->pending) {
+      if (p.pid != curproc->pid) continue;
+      int want = ioring_op_events(p.sqe);
+      if (p.file->ino->poll(*p.file, want, pt) & want) ready = true;
+    }
+    ring->lock.unlock();
+
+    int err = ready ? 0 : pt.sleep();
+    pt.clear();
+    ring->lock.lock();
+
+    // the SQEs we consumed still count as submitted
+    if (err == -EINTR) break;
+  }
+  ring->lock.unlock();
+  return submitted;
+}
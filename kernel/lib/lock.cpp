@@ -4,6 +4,7 @@
 #include <sched.h>
 
 #include <thread.h>
+#include <module.h>
 
 // #define LOCK_DEBUG
 
@@ -18,21 +19,98 @@
 #define ATOMIC_LOAD(thing) __atomic_load_n((thing), __ATOMIC_RELAXED)
 
 
-static inline void arch_atomic_store(volatile int* p, int x) { __atomic_store((int*)p, &x, __ATOMIC_SEQ_CST); }
+#ifdef CONFIG_LOCK_STATS
+static lock_class* all_lock_classes = nullptr;
 
-void spinlock::lock(void) {
-  while (ATOMIC_SET(&locked)) {  // MESI protocol optimization
-  while (__atomic_load_n(&locked, __ATOMIC_RELAXED) == 1) {
+static void lock_class_register(lock_class* cls) {
+  int expected = 0;
+  if (!__atomic_compare_exchange_n(&cls->registered, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+  // lock-free push onto the list of all classes
+  cls->next = __atomic_load_n(&all_lock_classes, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&all_lock_classes, &cls->next, cls, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
   }
+}
+
+static void lock_class_account(lock_class* cls, unsigned long spun) {
+  if (unlikely(cls->registered == 0)) lock_class_register(cls);
+  __atomic_fetch_add(&cls->acquisitions, 1, __ATOMIC_RELAXED);
+  if (spun == 0) return;
+
+  __atomic_fetch_add(&cls->contended, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&cls->spin_cycles, spun, __ATOMIC_RELAXED);
+  unsigned long max = __atomic_load_n(&cls->max_spin_cycles, __ATOMIC_RELAXED);
+  while (spun > max) {
+    if (__atomic_compare_exchange_n(&cls->max_spin_cycles, &max, spun, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
   }
 }
 
+void lock_class::each(void (*cb)(lock_class&)) {
+  for (auto* cls = __atomic_load_n(&all_lock_classes, __ATOMIC_ACQUIRE); cls != nullptr; cls = cls->next)
+    cb(*cls);
+}
+#else
+void lock_class::each(void (*cb)(lock_class&)) {}
+#endif
+
+
+// Keep the current thread from being preempted while it holds a ticket.
+// With interrupts off nothing can preempt us anyway (this also covers early
+// boot, before core() is usable), so there is nothing to do.
+static inline Thread* ticket_preempt_disable(void) {
+  if (!arch_irqs_enabled()) return nullptr;
+  // the thread must not move between reading core() and bumping its count
+  arch_disable_ints();
+  Thread* thd = cpu::thread();
+  if (thd != nullptr) thd->lock_depth++;
+  arch_enable_ints();
+  return thd;
+}
+
+static inline void ticket_preempt_enable(Thread* thd) {
+  if (thd != nullptr) thd->lock_depth--;
+}
+
+
+void spinlock::lock(void) {
+  Thread* holder = ticket_preempt_disable();
+  unsigned ticket = __atomic_fetch_add(&m_next, 1, __ATOMIC_RELAXED);
+  unsigned long spun = 0;
+
+  if (unlikely(__atomic_load_n(&m_owner, __ATOMIC_ACQUIRE) != ticket)) {
+#ifdef CONFIG_LOCK_STATS
+    unsigned long start = arch_read_timestamp();
+#endif
+    // We only ever read the lock while waiting, so the line stays shared
+    // until the holder releases it.
+    while (__atomic_load_n(&m_owner, __ATOMIC_ACQUIRE) != ticket) {
+      arch_relax();
+    }
+#ifdef CONFIG_LOCK_STATS
+    spun = arch_read_timestamp() - start;
+    if (spun == 0) spun = 1;
+#endif
+  }
+
+#ifdef CONFIG_LOCK_STATS
+  if (m_class != nullptr) lock_class_account(m_class, spun);
+#endif
+  (void)spun;
+  m_holder = holder;
+}
+
 void spinlock::unlock(void) {
-  ATOMIC_CLEAR(&locked);
+  unsigned owner = __atomic_load_n(&m_owner, __ATOMIC_RELAXED);
+  // Unlocking a free lock is a no-op, like it was with the old test-and-set
+  // lock. Handing the lock to a ticket that was never taken would wedge it.
+  if (owner == __atomic_load_n(&m_next, __ATOMIC_RELAXED)) return;
+  Thread* holder = m_holder;
+  m_holder = nullptr;
+  __atomic_store_n(&m_owner, owner + 1, __ATOMIC_RELEASE);
+  ticket_preempt_enable(holder);
 }
 
 
-bool spinlock::is_locked(void) { return locked; }
+bool spinlock::is_locked(void) { return __atomic_load_n(&m_owner, __ATOMIC_RELAXED) != __atomic_load_n(&m_next, __ATOMIC_RELAXED); }
 
 static inline bool irq_disable_save(void) {
   // preempt_disable();
@@ -55,28 +133,32 @@ static inline void irq_enable_restore(bool enabled) {
 
 
 bool spinlock::try_lock(void) {
-  if (ATOMIC_SET(&locked)) return false;
+  Thread* holder = ticket_preempt_disable();
+  unsigned owner = __atomic_load_n(&m_owner, __ATOMIC_ACQUIRE);
+  // The owner only moves forward and never passes `m_next`, so if `m_next`
+  // still equals the owner we read, nobody holds (or waits for) the lock.
+  if (!__atomic_compare_exchange_n(&m_next, &owner, owner + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    ticket_preempt_enable(holder);
+    return false;
+  }
+#ifdef CONFIG_LOCK_STATS
+  if (m_class != nullptr) lock_class_account(m_class, 0);
+#endif
+  m_holder = holder;
   return true;
 }
 
 bool spinlock::lock_irqsave() {
-  bool en = 0;
-  while (1) {
-    en = irq_disable_save();
-    if (ATOMIC_SET(&locked) == 0) break;
-    irq_enable_restore(en);
-    // MESI protocol optimization
-    while (__atomic_load_n(&locked, __ATOMIC_RELAXED) == 1) {
-    }
-  }
+  // Once we hold a ticket we must wait with interrupts off: an irq handler on
+  // this core taking the same lock would queue behind us forever.
+  bool en = irq_disable_save();
+  lock();
   return en;
 }
 
 bool spinlock::try_lock_irqsave(bool& success) {
-  bool en = 0;
-  while (1) {
-    en = irq_disable_save();
-    if (ATOMIC_SET(&locked) == 0) break;
+  bool en = irq_disable_save();
+  if (!try_lock()) {
     irq_enable_restore(en);
     success = false;
     return false;
@@ -127,6 +209,7 @@ int rwlock::write_lock(void) {
     } else {
       m_lock.unlock();
       /* TODO: we should yield if we're not spread across cores */
+      arch_relax();
     }
   }
   return 0;
@@ -135,3 +218,16 @@ int rwlock::write_unlock(void) {
   m_lock.unlock();
   return 0;
 }
+
+
+ksh_def("lockstat", "display spinlock contention statistics for each lock class") {
+#ifndef CONFIG_LOCK_STATS
+  printf("lock statistics are disabled. Rebuild with CONFIG_LOCK_STATS\n");
+#endif
+  lock_class::each([](lock_class &cls) {
+    unsigned long avg = cls.contended ? cls.spin_cycles / cls.contended : 0;
+    printf("%-16s acq:%lu contended:%lu avg spin:%lucyc max spin:%lucyc\n", cls.name, cls.acquisitions, cls.contended, avg,
+        cls.max_spin_cycles);
+  });
+  return 0;
+}
@@ -24,7 +24,8 @@ extern "C" size_t strlen(const char *s) {
 
 
 // bindings for liballoc
-spinlock alloc_lock;
+static lock_class alloc_lock_class("alloc_lock");
+spinlock alloc_lock(alloc_lock_class);
 static volatile long lock_flags = 0;
 int liballoc_lock() {
   alloc_lock.lock();
@@ -211,14 +211,14 @@ static void xcall_flush(mm::AddressSpace *space, off_t va, size_t pages) {
 
 
 int mm::AddressSpace::pagefault(off_t va, int err) {
-  scoped_lock l(this->lock);
+  scoped_mutex l(this->lock);
 	pagefaults++;
   va &= ~0xFFF;
   auto r = lookup(va);
 
   if (!r) return -1;
 
-  scoped_lock region_lock(r->lock);
+  scoped_mutex region_lock(r->lock);
 
   int fault_res = 0;
 
@@ -268,7 +268,7 @@ int mm::AddressSpace::pagefault(off_t va, int err) {
 
 // return the page at an address (allocate if needed)
 ck::ref<mm::Page> mm::AddressSpace::get_page(off_t uaddr) {
-  scoped_lock l(this->lock);
+  scoped_mutex l(this->lock);
   auto r = lookup(uaddr);
   if (!r) {
     return nullptr;
@@ -370,7 +370,7 @@ ck::ref<mm::Page> mm::AddressSpace::get_page_internal(off_t uaddr, mm::MappedReg
 
 
 size_t mm::AddressSpace::memory_usage(void) {
-  scoped_lock l(lock);
+  scoped_mutex l(lock);
 
   size_t s = 0;
 
@@ -403,7 +403,7 @@ mm::AddressSpace *mm::AddressSpace::fork(void) {
   pt->transaction_begin("fork source");
   npt->transaction_begin("fork target");
 
-  scoped_lock self_lock(lock);
+  scoped_mutex self_lock(lock);
 
 
   for (struct rb_node *node = rb_first(&regions); node; node = rb_next(node)) {
@@ -470,7 +470,7 @@ off_t mm::AddressSpace::mmap(ck::string name, off_t addr, size_t size, int prot,
   }
 
 
-  scoped_lock l(lock);
+  scoped_mutex l(lock);
 
   if (addr == 0) {
     addr = find_hole(round_up(size, 4096));
@@ -523,11 +523,11 @@ int mm::AddressSpace::unmap(off_t ptr, size_t ulen) {
 
   size_t len = round_up(ulen, 4096);
 
-  scoped_irqlock l1(lock);
+  scoped_mutex l1(lock);
   auto *region = lookup(va);
   if (region == NULL) return -ESRCH;
 
-  scoped_irqlock l2(region->lock);
+  scoped_mutex l2(region->lock);
 
   for (int i = 0; i < MM_REGION_CACHE_SIZE; i++) {
     if (region_cache[i].region == region) {
@@ -554,7 +554,7 @@ int mm::AddressSpace::unmap(off_t ptr, size_t ulen) {
 #define PGMASK (~(PGSIZE - 1))
 bool mm::AddressSpace::validate_pointer(void *raw_va, size_t len, int mode) {
   if (is_kspace) return true;
-  scoped_lock l(this->lock);
+  scoped_mutex l(this->lock);
   off_t start = (off_t)raw_va & PGMASK;
   off_t end = ((off_t)raw_va + len) & PGMASK;
 
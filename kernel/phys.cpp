@@ -27,7 +27,8 @@ struct frame {
   inline void setnext(frame *f) { next = (frame *)v2p(f); }
 };
 
-static spinlock phys_lck;
+static lock_class phys_lock_class("phys");
+static spinlock phys_lck(phys_lock_class);
 
 static struct {
   int use_lock;
@@ -3,17 +3,20 @@
  * in include/sched.h
  */
 
+#include <awaitset.h>
 #include <cpu.h>
 #include <elf/loader.h>
 #include <errno.h>
 #include <fs.h>
+#include <fs/magicfd.h>
 #include <fs/vfs.h>
-#include <futex.h>
 #include <chan.h>
 #include <lock.h>
 #include <mem.h>
 #include <phys.h>
+#include <rcu.h>
 #include <sched.h>
+#include <sctrace.h>
 #include <syscall.h>
 #include <util.h>
 #include <wait_flags.h>
@@ -94,16 +97,17 @@ static ck::ref<Process> do_spawn_proc(ck::ref<Process> proc_ptr, int flags) {
     // are we forking?
     if (flags & SPAWN_FORK) {
       // inherit all file descriptors
-      proc.parent->file_lock.lock();
-      for (auto &kv : proc.parent->open_files) {
-        proc.open_files[kv.key] = kv.value;
+      scoped_lock l(proc.parent->file_lock);
+      auto *t = proc.parent->files;
+      for (int fd = 0; t != NULL && fd < t->size; fd++) {
+        if (t->files[fd] != NULL) proc.set_fd(fd, t->files[fd]);
       }
-      proc.parent->file_lock.unlock();
 
     } else {
       // inherit stdin(0) stdout(1) and stderr(2)
       for (int i = 0; i < 3; i++) {
-        proc.open_files[i] = proc.parent->get_fd(i);
+        auto file = proc.parent->get_fd(i);
+        if (file) proc.set_fd(i, file);
       }
     }
   }
@@ -115,6 +119,7 @@ static ck::ref<Process> do_spawn_proc(ck::ref<Process> proc_ptr, int flags) {
 
   if (flags & SPAWN_FORK) {
     proc.mm = proc.parent->mm->fork();
+    proc.tls_info = proc.parent->tls_info;
   } else {
     proc.mm = alloc_user_vm();
   }
@@ -248,37 +253,152 @@ long sched::proc::create_kthread(const char *name, int (*func)(void *), void *ar
   return tid;
 }
 
+static struct fd_table *fd_table_alloc(int size) {
+  auto *t = (struct fd_table *)malloc(sizeof(struct fd_table) + sizeof(fs::File *) * size);
+  t->size = size;
+  for (int i = 0; i < size; i++)
+    t->files[i] = NULL;
+  return t;
+}
+
+
+static void fd_table_free(struct rcu_head *head) { free(container_of(head, struct fd_table, rcu)); }
+
+
+// grow the table (if needed) so `fd` has a slot. Called with file_lock held
+static struct fd_table *fd_table_reserve(Process &p, int fd) {
+  auto *t = p.files;
+  if (t != NULL && fd < t->size) return t;
+
+  int size = t ? t->size : 16;
+  while (size <= fd)
+    size *= 2;
+  if (size > FDTABLE_MAX) size = FDTABLE_MAX;
+
+  auto *nt = fd_table_alloc(size);
+  // the references move over to the new table
+  if (t != NULL) memcpy(nt->files, t->files, sizeof(fs::File *) * t->size);
+  rcu_assign_pointer(p.files, nt);
+  // readers might still be looking at the old one
+  if (t != NULL) call_rcu(&t->rcu, fd_table_free);
+  return nt;
+}
+
+
+// take a file out of its slot, handing back the slot's reference. Called with
+// file_lock held, but the reference should be dropped after letting go of it,
+// as the last close of a file can sleep
+static fs::File *fd_table_clear(struct fd_table *t, int fd) {
+  return __atomic_exchange_n(&t->files[fd], NULL, __ATOMIC_ACQ_REL);
+}
+
+
 ck::ref<fs::File> Process::get_fd(int fd) {
   ck::ref<fs::File> file;
 
-  scoped_lock l(file_lock);
-  auto it = open_files.find(fd);
-  if (it != open_files.end()) {
-    file = it->value;
+  if ((fd & MAGICFD_MASK) != 0) {
+    if (fd == MAGICFD_EXEC) {
+      scoped_lock l(file_lock);
+      file = executable;
+    }
+    return file;
+  }
+
+  rcu_read_lock();
+  auto *t = rcu_dereference(files);
+  if (t != NULL && fd >= 0 && fd < t->size) {
+    // The descriptor can be closed (and the file's last reference dropped)
+    // right after we load it. The memory stays put until we are done (see
+    // fs::File::operator delete), but we may only keep it if it isn't gone
+    fs::File *f = rcu_dereference(t->files[fd]);
+    if (f != NULL && f->ref_try_retain()) file = ck::ref<fs::File>(ck::ref<fs::File>::Adopt, *f);
   }
+  rcu_read_unlock();
 
   return file;
 }
 
 int Process::add_fd(ck::ref<fs::File> file) {
-  int fd = 0;
   scoped_lock l(file_lock);
 
-  while (1) {
-    if (!open_files.contains(fd)) break;
-    fd++;
+  int fd = 0;
+  for (auto *t = files; t != NULL && fd < t->size; fd++) {
+    if (t->files[fd] == NULL) break;
   }
+  if (fd >= FDTABLE_MAX) return -EMFILE;
 
-  open_files.set(fd, file);
+  auto *t = fd_table_reserve(*this, fd);
+  rcu_assign_pointer(t->files[fd], file.leak_ref());
   return fd;
 }
 
+int Process::set_fd(int fd, ck::ref<fs::File> file) {
+  if (fd < 0 || fd >= FDTABLE_MAX) return -EBADF;
+  fs::File *old;
+  {
+    scoped_lock l(file_lock);
+    auto *t = fd_table_reserve(*this, fd);
+    old = fd_table_clear(t, fd);
+    rcu_assign_pointer(t->files[fd], file.leak_ref());
+  }
+  if (old != NULL) {
+    awaitset_closed(*this, fd, *old);
+    old->ref_release();
+  }
+  return fd;
+}
+
+int Process::close_fd(int fd) {
+  fs::File *old = NULL;
+  {
+    scoped_lock l(file_lock);
+    auto *t = files;
+    if (t != NULL && fd >= 0 && fd < t->size) old = fd_table_clear(t, fd);
+  }
+  if (old == NULL) return -ENOENT;
+  awaitset_closed(*this, fd, *old);
+  old->ref_release();
+  return 0;
+}
+
+void Process::close_fds(int lowest) {
+  struct closed_fd {
+    int fd;
+    fs::File *file;
+  };
+  ck::vec<closed_fd> closed;
+  {
+    scoped_lock l(file_lock);
+    auto *t = files;
+    for (int fd = lowest; t != NULL && fd < t->size; fd++) {
+      auto *old = fd_table_clear(t, fd);
+      if (old != NULL) closed.push({fd, old});
+    }
+  }
+  for (auto &c : closed) {
+    awaitset_closed(*this, c.fd, *c.file);
+    c.file->ref_release();
+  }
+}
+
 Process::~Process(void) {
   if (threads.size() != 0) {
     KWARN("destruction of proc %d still has threads!\n", this->pid);
   }
 
   sched::proc::ptable_remove(this->pid);
+  sctrace_exit(*this);
+
+  // nobody can look the files up anymore
+  if (files != NULL) {
+    for (int fd = 0; fd < files->size; fd++) {
+      auto *file = files->files[fd];
+      if (file == NULL) continue;
+      awaitset_closed(*this, fd, *file);
+      file->ref_release();
+    }
+    free(files);
+  }
   delete mm;
 }
 
@@ -685,93 +805,12 @@ void sys::exit_thread(int code) {
     return curproc->exit(code);
   }
 
+  curthd->release_tls();
   curthd->exit();
 }
 
 
 
-wait_queue &Process::futex_queue(int *uaddr) {
-  futex_lock.lock();
-  if (!m_futex_queues.contains((off_t)uaddr)) {
-    m_futex_queues.set((off_t)uaddr, ck::make_box<wait_queue>());
-  }
-  auto &wq = *m_futex_queues.ensure((off_t)uaddr);
-  futex_lock.unlock();
-  return wq;
-}
-
-
-
-
-int sys::futex(int *uaddr, int op, int val, int val2, int *uaddr2, int val3) {
-  // printf("call futex %p %d\n", uaddr, op);
-  /* If the user can't read the address, it's invalid. */
-  if (!VALIDATE_RD(uaddr, 4)) return -EINVAL;
-
-  auto &mm = *curproc->mm;
-
-  off_t addr = (off_t)uaddr;
-  /* the address must be word aligned (4 bytes) */
-  if ((addr & 0x3) != 0) return -EINVAL;
-
-  /*
-   * This follows the general idea of Linux's:
-   * This operation tests that the value at the futex word pointed to by the address uaddr still
-   * contains the expected value val, and if so, then sleeps waiting for  a  FU‐ TEX_WAKE  operation
-   * on  the futex word.  The load of the value of the futex word is an atomic memory access (i.e.,
-   * using atomic machine instructions of the respective architecture).  This load, the comparison
-   * with the expected value, and starting to sleep are performed atomically and totally ordered
-   * with respect to other futex oper‐ ations  on  the  same  futex  word.  If the thread starts to
-   * sleep, it is considered a waiter on this futex word.  If the futex value does not match val,
-   * then the call fails immediately with the error EAGAIN.
-   */
-  if (op == FUTEX_WAIT) {
-    // printf("futex_wait(%p, %d)\n", uaddr, val);
-    auto &wq = curproc->futex_queue(uaddr);
-
-    wait_entry ent;
-    prepare_to_wait_exclusive(wq, ent, true);
-    // prepare_to_wait(wq, ent, true);
-    // printf("[%2d] FUTEX_WAIT - wq: %p\n", curthd->tid, &wq);
-    /* Load the item atomically. (ATOMIC ACQUIRE makes sense here I think) */
-    int current_value = __atomic_load_n(uaddr, __ATOMIC_ACQUIRE);
-    /* If the value is not the expected value, return EAGAIN */
-    if (current_value != val) return -EAGAIN;
-
-    // printf("WAIT BEGIN!\n");
-
-    if (ent.start().interrupted()) {
-      // printf("FUTEX WAIT WAKEUP (RUDE)\n");
-      return -EINTR;
-    }
-    // printf("FUTEX WAIT WAKEUP\n");
-
-    return 0;
-  }
-
-  if (op == FUTEX_WAKE) {
-    // printf("futex_wake(%p, %d)\n", uaddr, val);
-    auto &wq = curproc->futex_queue(uaddr);
-
-    if (val == 0) return 0;
-
-    if (wq.task_list.is_empty_careful()) {
-      return 0;
-    }
-    // printf("[%2d] FUTEX_WAKE - wq: %p\n", curthd->tid, &wq);
-
-    wq.__wake_up(0, val, NULL);
-    return 1; /* if someone was woken up, return one */
-  }
-
-  if (op == FUTEX_DSTR) {
-  }
-
-  return -EINVAL;
-}
-
-
-
 int sys::kill(int pid, int sig) { return sched::proc::send_signal(pid, sig); }
 
 int sys::prctl(int option, unsigned long a1, unsigned long a2, unsigned long a3, unsigned long a4, unsigned long a5) { return -ENOTIMPL; }
@@ -826,9 +865,24 @@ static long do_fork(struct Process &p) {
   new_td->trap_frame[0] = 0;  // return value for child is 0
 #endif
 
-  // copy floating point
-  memcpy(new_td->fpu.state, old_td->fpu.state, 4096);
-  new_td->fpu.initialized = old_td->fpu.initialized;
+  // copy floating point, if the parent has ever used it. Save it first, as the
+  // copy from the last context switch may be stale
+  if (old_td->fpu.state != NULL) {
+    arch_sync_fpu(*old_td);
+    new_td->fpu.state = phys::kalloc(NPAGES(arch_fpu_state_size()));
+    memcpy(new_td->fpu.state, old_td->fpu.state, arch_fpu_state_size());
+    new_td->fpu.initialized = old_td->fpu.initialized;
+  }
+
+  // the child inherits the affinity of the forking thread
+  new_td->affinity = old_td->affinity;
+
+  // and its TLS block, which was copied along with the address space
+  new_td->tls_ubase = old_td->tls_ubase;
+  new_td->tls_usize = old_td->tls_usize;
+  new_td->tls_uaddr = old_td->tls_uaddr;
+
+  sctrace_fork(p, *np);
 
   // go to the fork_return function instead of whatever it was gonna do otherwise
   new_td->kern_context->pc = (u64)fork_return;
@@ -1,18 +1,133 @@
 #include <rcu.h>
 #include <cpu.h>
 #include <lock.h>
+#include <sched.h>
+#include <sleep.h>
+#include <wait.h>
+#include <module.h>
+
+
+// how many grace periods have completed, and how many callbacks have been invoked
+static unsigned long rcu_gp_count = 0;
+static unsigned long rcu_cb_count = 0;
+
+// the number of callbacks queued since the [rcu] kthread last looked
+static unsigned long rcu_pending = 0;
+static wait_queue rcu_wq;
 
-// define the global rwlock
-rwlock rcu_gp_mutex;
 
 void rcu_read_lock(void) {
+  // the thread must not move between reading core() and bumping its count
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
   core().preempt_count++;
+  if (en) arch_enable_ints();
   barrier();
-  rcu_gp_mutex.read_lock();
 }
 
 void rcu_read_unlock() {
-  core().preempt_count--;
   barrier();
-  rcu_gp_mutex.read_unlock();
+  // we cannot migrate while preemption is disabled, so this is our core
+  core().preempt_count--;
+}
+
+
+void rcu_note_qs(void) {
+  auto &c = core();
+  // order every load from a previous critical section before the report
+  __atomic_store_n(&c.rcu_qs, c.rcu_qs + 1, __ATOMIC_RELEASE);
+}
+
+
+void synchronize_rcu(void) {
+  cpu::Core *cores[CONFIG_MAX_CPUS];
+  unsigned long snap[CONFIG_MAX_CPUS];
+  int n = 0;
+
+  // Make the writer's updates (unpublishing the old data) visible before we
+  // snapshot, so any reader that starts after this point cannot see it.
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+  cpu::each([&](cpu::Core *c) {
+    if (n >= CONFIG_MAX_CPUS) return;
+    cores[n] = c;
+    snap[n] = __atomic_load_n(&c->rcu_qs, __ATOMIC_ACQUIRE);
+    n++;
+  });
+
+  for (int i = 0; i < n; i++) {
+    // Sleep a tick at a time. Sleeping also blocks us, which is how our own
+    // core gets through its quiescent state.
+    while (__atomic_load_n(&cores[i]->rcu_qs, __ATOMIC_ACQUIRE) == snap[i]) {
+      do_usleep(1000 * 1000 / CONFIG_TICKS_PER_SECOND);
+    }
+  }
+
+  __atomic_fetch_add(&rcu_gp_count, 1, __ATOMIC_RELAXED);
+}
+
+
+void call_rcu(struct rcu_head *head, rcu_callback_t func) {
+  head->func = func;
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  // Push onto this core's list. The [rcu] kthread may steal the list from
+  // another core at any time, so this is a lock-free push.
+  auto &c = core();
+  head->next = __atomic_load_n(&c.rcu_callbacks, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&c.rcu_callbacks, &head->next, head, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+  }
+  if (en) arch_enable_ints();
+
+  if (__atomic_fetch_add(&rcu_pending, 1, __ATOMIC_ACQ_REL) == 0) rcu_wq.wake_up();
+}
+
+
+static int rcu_worker(void *) {
+  while (1) {
+    {
+      wait_entry ent;
+      prepare_to_wait(rcu_wq, ent, false);
+      if (__atomic_load_n(&rcu_pending, __ATOMIC_ACQUIRE) == 0) ent.start();
+    }
+
+    // Take every core's callbacks as one batch. Anything queued after this
+    // point will be picked up by the next loop.
+    __atomic_store_n(&rcu_pending, 0, __ATOMIC_RELEASE);
+    struct rcu_head *batch = nullptr;
+    cpu::each([&](cpu::Core *c) {
+      auto *list = __atomic_exchange_n(&c->rcu_callbacks, nullptr, __ATOMIC_ACQUIRE);
+      while (list != nullptr) {
+        auto *next = list->next;
+        list->next = batch;
+        batch = list;
+        list = next;
+      }
+    });
+
+    if (batch == nullptr) continue;
+
+    // one grace period for the whole batch
+    synchronize_rcu();
+
+    while (batch != nullptr) {
+      auto *next = batch->next;
+      batch->func(batch);
+      batch = next;
+      rcu_cb_count++;
+    }
+  }
+  return 0;
+}
+
+
+static void rcu_init(void) { sched::proc::create_kthread("[rcu]", rcu_worker); }
+module_init("rcu", rcu_init);
+
+
+ksh_def("rcu", "display RCU grace period information") {
+  printf("grace periods: %lu, callbacks invoked: %lu\n", rcu_gp_count, rcu_cb_count);
+  cpu::each([](cpu::Core *c) { printf("core #%d: %lu quiescent states\n", c->id, c->rcu_qs); });
+  return 0;
 }
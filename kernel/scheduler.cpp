@@ -9,6 +9,8 @@
 #include <wait.h>
 #include <printf.h>
 #include <realtime.h>
+#include <module.h>
+#include <rcu.h>
 #include "arch.h"
 
 #ifdef CONFIG_RISCV
@@ -44,11 +46,22 @@ int Thread::make_runnable(int cpu, bool admit) {
     return 0;
   }
 
+  // A thread that was admitted on a core stays on it for as long as its
+  // affinity allows. That core may still be switching away from it (a wakeup
+  // can race with the thread blocking), and it is the one that puts the thread
+  // back in its queue once it has. So only move it when its mask excludes the
+  // core it is on.
+  auto *home = this->scheduler;
+  if (home != nullptr && can_run_on(home->core().id)) cpu = home->core().id;
+
   // cpu of -1 means "self"
-  if (cpu == RT_CORE_SELF) {
-    target_core = &core();
-    cpu = target_core->id;
-  } else if (cpu == RT_CORE_ANY) {
+  if (cpu == RT_CORE_SELF) cpu = core().id;
+
+  // If the thread is not allowed on the requested core (its affinity mask
+  // excludes it), place it on any core that it is allowed to run on instead.
+  if (cpu >= 0 && !can_run_on(cpu)) cpu = RT_CORE_ANY;
+
+  if (cpu == RT_CORE_ANY) {
     // Starting at a random core, loop through all the cores and try to
     // admit the thread to them. Return success if it occurs, or failure
     // if no cores admit the thread.
@@ -56,6 +69,7 @@ int Thread::make_runnable(int cpu, bool admit) {
     unsigned start = rand() % nprocs;
     for (int i = 0; i < nprocs; i++) {
       int target = (start + i) % nprocs;
+      if (!can_run_on(target)) continue;
       // try to admit to the core
       auto res = make_runnable(target, admit);
       if (res >= 0) {
@@ -78,6 +92,24 @@ int Thread::make_runnable(int cpu, bool admit) {
   if (target_core == nullptr) return -ENOENT;
 
   auto &s = target_core->local_scheduler;
+
+  // If the thread was last admitted on another core, its affinity no longer
+  // allows that core and it is migrating. Detach it from the old scheduler so
+  // this one can admit it. If the old core hasn't switched off the thread yet,
+  // it can't be detached: it would run on both cores. Leave it to the old
+  // core, which moves it once it is off its stack (see sched::run).
+  if (this->scheduler != nullptr && this->scheduler != &s) {
+    scoped_irqlock l(schedlock);
+    if (on_core) {
+      migrate_pending = true;
+      return 0;
+    }
+    this->scheduler = nullptr;
+    admit = true;
+    stats.sched.migrations++;
+    __atomic_fetch_add(&target_core->sched_stats.migrations, 1, __ATOMIC_RELAXED);
+  }
+
   // grab a scoped lock
   auto lock = s.lock();
 
@@ -97,8 +129,11 @@ int Thread::make_runnable(int cpu, bool admit) {
   }
 
   if (constraint().type == rt::APERIODIC) {
+    stats.runnable_since = arch_read_timestamp();
     s.aperiodic.enqueue(this);
     this->rt_status = rt::ADMITTED;
+    // a remote core might be halted in its idle loop
+    if (target_core != &core()) s.kick();
   } else {
     printf(KERN_WARN "Cannot handle non-aperiodic tasks yet\n");
     return -ENOTIMPL;
@@ -109,7 +144,42 @@ int Thread::make_runnable(int cpu, bool admit) {
 
 
 
-rt::Scheduler::Scheduler(cpu::Core &core) : m_core(core) {}
+uint64_t Thread::priority(void) {
+  uint64_t prio = 0;
+  if (m_constraint.type == rt::APERIODIC) prio = m_constraint.aperiodic.priority;
+  if (m_constraint.type == rt::SPORADIC) prio = m_constraint.sporadic.aperiodic_priority;
+  return pi_priority < prio ? pi_priority : prio;
+}
+
+
+void Thread::set_pi_priority(uint64_t prio) {
+  auto *s = scheduler;
+  if (s == NULL) {
+    pi_priority = prio;
+    return;
+  }
+
+  auto l = s->lock();
+  // if the thread is waiting to run, it has to move to its new spot in line
+  auto *q = current_queue;
+  if (q != NULL && q->type() == rt::APERIODIC_QUEUE) {
+    q->remove(this);
+    pi_priority = prio;
+    q->enqueue(this);
+  } else {
+    pi_priority = prio;
+  }
+}
+
+
+
+rt::Scheduler::Scheduler(cpu::Core &core) : m_core(core) {
+  kick_xcall.fn = [](void *arg) {
+    auto targ = static_cast<rt::Scheduler *>(arg);
+    targ->in_kick = true;
+  };
+  kick_xcall.arg = this;
+}
 
 bool rt::Scheduler::admit(Thread *task, uint64_t now) {
   scoped_irqlock l(task->schedlock);
@@ -180,13 +250,9 @@ ck::ref<Thread> rt::Scheduler::claim(void) {
 void rt::Scheduler::kick(void) {
   // kicks must be from remote cores.
   if (core_id() != this->core().id) {
-    cpu::xcall(
-        this->core().id,
-        [](void *arg) {
-          auto targ = static_cast<rt::Scheduler *>(arg);
-          targ->in_kick = true;
-        },
-        this);
+    // Nobody needs to wait for the kick to land, it just has to interrupt
+    // the core so it reschedules on the way out of the IPI.
+    cpu::xcall_async(this->core().id, &kick_xcall);
   } else {
     // we do not reschedule here since
     // we do not know if it is safe to do so
@@ -267,8 +333,22 @@ void rt::Queue::enqueue(Thread *task) {
   }
   assert(task->current_queue == NULL);
   task->current_queue = this;
-  m_list.add_tail(&task->queue_node);
   m_size++;
+
+  // The queue is kept in priority order, FIFO among equals. Nearly every task
+  // has the same priority, so check the tail before walking the list.
+  auto prio = task->priority();
+  if (m_list.prev == &m_list || list_entry(m_list.prev, Thread, queue_node)->priority() <= prio) {
+    m_list.add_tail(&task->queue_node);
+    return;
+  }
+
+  Thread *pos = NULL;
+  list_for_each_entry(pos, &m_list, queue_node) {
+    if (pos->priority() > prio) break;
+  }
+  // insert before `pos`
+  pos->queue_node.add_tail(&task->queue_node);
 }
 
 Thread *rt::Queue::peek(void) {
@@ -312,6 +392,46 @@ int sched::remove_task(ck::ref<Thread> t) {
 static void switch_into(ck::ref<Thread> thd) { thd->run(); }
 
 
+static inline int schedstat_bucket(uint64_t ns) {
+  if (ns == 0) return 0;
+  int b = 63 - __builtin_clzll(ns);
+  return b >= SCHEDSTAT_BUCKETS ? SCHEDSTAT_BUCKETS - 1 : b;
+}
+
+// Called by the scheduler right before switching into a thread. Records how
+// long it sat in the run queue (and how long since it was woken up)
+static void account_switch_in(Thread &thd) {
+  auto &st = thd.stats;
+  auto &cs = core().sched_stats;
+
+  st.sched.run_count++;
+  cs.run_count++;
+
+  // the thread was not placed on a run queue (the idle thread, for example)
+  if (st.runnable_since == 0) return;
+
+  uint64_t now = arch_read_timestamp();
+  uint64_t ns = 0;
+  // timestamps from different cores are not guarenteed to be in sync
+  if (now > st.runnable_since) ns = arch_timestamp_to_ns(now - st.runnable_since);
+  st.runnable_since = 0;
+
+  int b = schedstat_bucket(ns);
+  st.sched.runq_ns += ns;
+  st.sched.runq_hist[b]++;
+  cs.runq_ns += ns;
+  cs.runq_hist[b]++;
+
+  if (st.woken) {
+    st.woken = false;
+    st.sched.wakeups++;
+    st.sched.wakeup_hist[b]++;
+    cs.wakeups++;
+    cs.wakeup_hist[b]++;
+  }
+}
+
+
 
 extern "C" void context_switch(struct ThreadContext **, struct ThreadContext *);
 sched::YieldResult sched::yield() {
@@ -375,6 +495,7 @@ void sched::unblock(Thread &thd, bool interrupt) {
   __sync_synchronize();
   // TODO: not super thread safe, I'm sure.
   if (thd.current_queue == NULL) {
+    thd.stats.woken = true;
     sched::add_task(&thd);
   }
 }
@@ -404,6 +525,7 @@ static int idle_task(void *arg) {
      */
     arch_enable_ints(); /* just to be sure. */
     arch_halt();
+    rcu_note_qs();
     sched::yield();
   }
 }
@@ -477,6 +599,10 @@ void sched::run() {
     slack_test_count++;
     if (slack_test_count == slack_test_interval) slack_test_count = 0;
 
+    // Every trip back to the scheduler is a context switch, and therefore a
+    // quiescent state: no thread on this core is inside an RCU read section.
+    rcu_note_qs();
+
     sched.reschedule();
     ck::ref<Thread> thd = sched.claim();
 
@@ -502,10 +628,17 @@ void sched::run() {
     auto start = cpu::get_ticks();
     auto state_before = thd->get_state();
     if (state_before == PS_RUNNING) {
+      account_switch_in(*thd);
       thd->run();
     }
 
     auto state_after = thd->get_state();
+    bool migrate = false;
+    {
+      scoped_irqlock l(thd->schedlock);
+      migrate = thd->migrate_pending;
+      thd->migrate_pending = false;
+    }
 
     auto end = cpu::get_ticks();
     auto ran = end - start;
@@ -525,8 +658,10 @@ void sched::run() {
       scoped_irqlock l(thd->joinlock);
       thd->set_state(PS_ZOMBIE);
       thd->joiners.wake_up_all();
-    } else if (state_after == PS_RUNNING) {
-      // The thread was already in the scheduler queue. No need to admit it
+    } else if (state_after == PS_RUNNING || migrate) {
+      // The thread was already in the scheduler queue. No need to admit it.
+      // If it was woken onto another core while we were switching off it,
+      // make_runnable moves it there now.
       thd->make_runnable(RT_CORE_SELF, false);
     } else {
       // SCHED_DEBUG("Was blocked.\n");
@@ -537,8 +672,30 @@ void sched::run() {
 
 
 
+// Ask the scheduler for something else to run on the way out of this irq.
+static void preempt_current(Thread *thd) {
+  // We don't get preempted if we aren't currently runnable. See wait.cpp for
+  // why. Or, if the current thread is not preemptable, holds a spinlock ticket,
+  // or we are in an RCU reader section, don't reschedule
+  if (thd->get_state() != PS_RUNNING || thd->preemptable == false || thd->lock_depth != 0 || core().preempt_count != 0) {
+    return;
+  }
+
+  // ask the scheduler if there's anything to switch to
+  if (!core().local_scheduler.reschedule()) {
+    // There wasn't! Keep running for another slice
+    thd->start_slice();
+  }
+}
+
 void sched::handle_tick(u64 ticks) {
   if (!core().in_sched) return;
+
+  // Readers hold preempt_count up for as long as they are inside a read-side
+  // critical section, so a tick that lands while it is zero is a quiescent
+  // state. A core running one CPU bound thread never goes back through the
+  // scheduler loop, and its grace periods would never end without this.
+  if (core().preempt_count == 0) rcu_note_qs();
   if (!cpu::in_thread()) return;
 
   check_wakeups();
@@ -547,18 +704,20 @@ void sched::handle_tick(u64 ticks) {
   auto thd = cpu::thread();
   thd->ticks_ran++;
 
-  // We don't get preempted if we aren't currently runnable. See wait.cpp for
-  // why. Or, if the current thread is not preemptable, or we are in an RCU reader
-  // section, don't reschedule
-  if (thd->get_state() != PS_RUNNING || thd->preemptable == false || core().preempt_count != 0) {
-    return;
-  }
+  preempt_current(thd);
+}
 
-  // ask the scheduler if there's anything to switch to
-  if (!core().local_scheduler.reschedule()) {
-    // There wasn't!
-    arch_set_timer(thd->epoch());
-  }
+
+void sched::handle_timer(void) {
+  if (!core().in_sched) return;
+
+  check_wakeups();
+  if (!cpu::in_thread()) return;
+
+  // The timer also fires for sleepers, so only switch away if the thread's
+  // slice has actually run out.
+  auto thd = cpu::thread();
+  if (arch_read_timestamp() >= thd->slice_end) preempt_current(thd);
 }
 
 
@@ -705,8 +864,16 @@ bool sched::before_iret(bool userspace) {
   // want to screw that up by prematurely yielding.
   if (thd->state != PS_RUNNING) return false;
 
+  // never preempt an RCU reader, the switch would be a false quiescent state
+  if (c.preempt_count != 0) return false;
+  // ... or a thread holding a spinlock ticket, everyone queued behind it would spin
+  if (thd->lock_depth != 0) return false;
+
   if (c.local_scheduler.next_thread != nullptr || c.woke_someone_up) {
     c.woke_someone_up = false;
+    // the thread is still runnable, so this switch is involuntary
+    thd->stats.sched.preemptions++;
+    c.sched_stats.preemptions++;
     thd = nullptr;
     barrier();
     sched::yield();
@@ -796,3 +963,43 @@ int sched::proc::send_signal(long p, int sig) {
   }
   return err;
 }
+
+
+
+int sys::get_sched_stats(int tid, struct chariot_sched_stats *stats) {
+  if (!VALIDATE_WR(stats, sizeof(*stats))) return -EINVAL;
+
+  if (tid == SCHEDSTAT_ALL) {
+    struct chariot_sched_stats sum = {};
+    cpu::each([&](cpu::Core *c) {
+      auto &cs = c->sched_stats;
+      sum.run_count += cs.run_count;
+      sum.wakeups += cs.wakeups;
+      sum.preemptions += cs.preemptions;
+      sum.migrations += cs.migrations;
+      sum.runq_ns += cs.runq_ns;
+      for (int i = 0; i < SCHEDSTAT_BUCKETS; i++) {
+        sum.runq_hist[i] += cs.runq_hist[i];
+        sum.wakeup_hist[i] += cs.wakeup_hist[i];
+      }
+    });
+    *stats = sum;
+    return 0;
+  }
+
+  auto thd = Thread::lookup_for_user(tid);
+  if (thd == nullptr) return -ESRCH;
+  *stats = thd->stats.sched;
+  return 0;
+}
+
+
+ksh_def("schedstat", "display run queue latency and preemption counts for each core") {
+  cpu::each([](cpu::Core *c) {
+    auto &cs = c->sched_stats;
+    uint64_t avg = cs.run_count ? cs.runq_ns / cs.run_count : 0;
+    printf("core #%d: runs:%lu wakeups:%lu preempt:%lu migrate:%lu avg runq:%luns\n", c->id, cs.run_count, cs.wakeups,
+        cs.preemptions, cs.migrations, avg);
+  });
+  return 0;
+}
@@ -0,0 +1,298 @@
+#include <cpu.h>
+#include <errno.h>
+#include <fifo_buf.h>
+#include <mm.h>
+#include <module.h>
+#include <sctrace.h>
+#include <syscall.h>
+#include <time.h>
+
+
+// Tracing sits on the syscall path only while something is being traced:
+// do_syscall() checks sctrace_system and curproc->sctrace before calling in
+// here. Once a process has been traced, its sctrace_proc (and its counts)
+// stick around until the process goes away, so the hooks never race with
+// them being freed. Turning tracing off just clears the flags.
+
+extern ck::ref<Process> pid_lookup(long pid);
+
+// may the current process trace (or read the counts of) `p`
+static bool may_trace(Process &p) {
+  return p.pid == curproc->pid || curproc->user.euid == 0 || p.user.uid == curproc->user.uid;
+}
+
+// what the hooks need out of <syscall_info.inc>
+static struct {
+  int flags;
+  // index of the first string argument, or -1
+  int str;
+  // false for syscalls that return void
+  bool result;
+} sc_info[SCTRACE_NR];
+
+
+struct sctrace_node final : public fs::Node {
+  sctrace_node(void) : fs::Node(nullptr) {}
+
+  ssize_t read(fs::File &, char *dst, size_t sz) override;
+  int poll(fs::File &, int events, poll_table &pt) override { return buf.poll(pt) & events; }
+  void close(fs::File &) override { closed = true; }
+
+  void emit(const struct sctrace_event &ev);
+
+  fifo_buf buf;
+  // makes each event a single write into `buf`
+  spinlock lock;
+  bool closed = false;
+  unsigned long dropped = 0;
+};
+
+
+struct sctrace_proc {
+  int flags = 0;
+  // protects `events`
+  spinlock lock;
+  ck::ref<sctrace_node> events;
+  // SCTRACE_NR of them, once SCTRACE_STATS has been turned on
+  struct sctrace_stat *stats = nullptr;
+};
+
+
+bool sctrace_system = false;
+static struct sctrace_stat *system_stats = nullptr;
+
+
+ssize_t sctrace_node::read(fs::File &, char *dst, size_t sz) {
+  // only ever hand out whole events
+  sz -= sz % sizeof(struct sctrace_event);
+  if (sz == 0) return -EINVAL;
+  return buf.read(dst, sz, true);
+}
+
+
+void sctrace_node::emit(const struct sctrace_event &ev) {
+  scoped_irqlock l(lock);
+  size_t avail, unread;
+  buf.stats(avail, unread);
+  // never make the traced process wait on the tracer
+  if (avail < sizeof(ev)) {
+    dropped++;
+    return;
+  }
+  buf.write(&ev, sizeof(ev), false);
+}
+
+
+static struct sctrace_stat *alloc_stats(void) {
+  auto *s = (struct sctrace_stat *)malloc(sizeof(struct sctrace_stat) * SCTRACE_NR);
+  memset(s, 0, sizeof(struct sctrace_stat) * SCTRACE_NR);
+  return s;
+}
+
+
+static inline int sctrace_bucket(uint64_t ns) {
+  if (ns == 0) return 0;
+  int b = 63 - __builtin_clzll(ns);
+  return b >= SCTRACE_BUCKETS ? SCTRACE_BUCKETS - 1 : b;
+}
+
+
+static void account(struct sctrace_stat &s, unsigned long ns, bool error) {
+  __atomic_fetch_add(&s.count, 1, __ATOMIC_RELAXED);
+  if (error) __atomic_fetch_add(&s.errors, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&s.total_ns, ns, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&s.hist[sctrace_bucket(ns)], 1, __ATOMIC_RELAXED);
+
+  unsigned long max = __atomic_load_n(&s.max_ns, __ATOMIC_RELAXED);
+  while (ns > max && !__atomic_compare_exchange_n(&s.max_ns, &max, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+  }
+}
+
+
+// copy a string argument out of the process, stopping at anything unmapped
+static void copy_string(char *dst, const char *src) {
+  int i = 0;
+  for (; i < SCTRACE_STRLEN - 1; i++) {
+    // check each page once
+    if ((i == 0 || ((off_t)(src + i) & 0xFFF) == 0) && !VALIDATE_RD((src + i), 1)) break;
+    dst[i] = src[i];
+    if (dst[i] == '\0') return;
+  }
+  dst[i] = '\0';
+}
+
+
+bool sctrace_syscall(int num, void *handler, unsigned long *args, unsigned long &ret) {
+  auto *t = curproc->sctrace;
+  int flags = t ? t->flags : 0;
+  if (!sctrace_system && (flags & (SCTRACE_STATS | SCTRACE_EVENTS)) == 0) return false;
+  if (sc_info[num].flags & SCINFO_NOTRACE) return false;
+
+  ck::ref<sctrace_node> events;
+  if (flags & SCTRACE_EVENTS) {
+    scoped_irqlock l(t->lock);
+    events = t->events;
+  }
+  if (events && events->closed) events = nullptr;
+
+  struct sctrace_event ev;
+  if (events) {
+    ev.pid = curproc->pid;
+    ev.tid = curthd->tid;
+    ev.num = num;
+    ev.flags = sc_info[num].flags;
+    for (int i = 0; i < 6; i++)
+      ev.args[i] = args[i];
+    ev.ret = 0;
+    ev.ns = 0;
+    ev.str[0] = '\0';
+    if (sc_info[num].str >= 0) copy_string(ev.str, (const char *)args[sc_info[num].str]);
+  }
+
+  auto *func = (uint64_t(*)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t))handler;
+  unsigned long start = time::now_ns();
+
+  if (sc_info[num].flags & SCINFO_NORETURN) {
+    // there's no coming back to report it, or to drop the reference
+    if (events) {
+      ev.start_ns = start;
+      events->emit(ev);
+      events = nullptr;
+    }
+    if (sctrace_system) account(system_stats[num], 0, false);
+    if (flags & SCTRACE_STATS) account(t->stats[num], 0, false);
+    ret = func(args[0], args[1], args[2], args[3], args[4], args[5]);
+    return true;
+  }
+
+  ret = func(args[0], args[1], args[2], args[3], args[4], args[5]);
+  unsigned long ns = time::now_ns() - start;
+
+  long res = (long)ret;
+  bool error = sc_info[num].result && res < 0 && res >= -4095;
+  if (sctrace_system) account(system_stats[num], ns, error);
+  if (flags & SCTRACE_STATS) account(t->stats[num], ns, error);
+
+  if (events) {
+    ev.ret = sc_info[num].result ? res : 0;
+    ev.start_ns = start;
+    ev.ns = ns;
+    events->emit(ev);
+  }
+  return true;
+}
+
+
+static struct sctrace_proc *get_sctrace(Process &p) {
+  scoped_lock l(p.datalock);
+  if (p.sctrace == nullptr) {
+    auto *t = new sctrace_proc();
+    __atomic_store_n(&p.sctrace, t, __ATOMIC_RELEASE);
+  }
+  return p.sctrace;
+}
+
+
+static void set_tracing(struct sctrace_proc *t, int flags, ck::ref<sctrace_node> events) {
+  // start counting from zero each time the counts are turned on
+  if ((flags & SCTRACE_STATS) && !(t->flags & SCTRACE_STATS)) {
+    if (t->stats == nullptr) {
+      t->stats = alloc_stats();
+    } else {
+      memset(t->stats, 0, sizeof(struct sctrace_stat) * SCTRACE_NR);
+    }
+  }
+
+  scoped_irqlock l(t->lock);
+  t->events = events;
+  t->flags = flags;
+}
+
+
+void sctrace_fork(Process &parent, Process &child) {
+  auto *pt = parent.sctrace;
+  if (pt == nullptr || !(pt->flags & SCTRACE_INHERIT)) return;
+
+  ck::ref<sctrace_node> events;
+  {
+    scoped_irqlock l(pt->lock);
+    events = pt->events;
+  }
+  set_tracing(get_sctrace(child), pt->flags, events);
+}
+
+
+void sctrace_exit(Process &p) {
+  auto *t = p.sctrace;
+  if (t == nullptr) return;
+  p.sctrace = nullptr;
+  if (t->stats) free(t->stats);
+  delete t;
+}
+
+
+int sys::sctrace(int pid, int flags) {
+  if (flags & ~(SCTRACE_STATS | SCTRACE_EVENTS | SCTRACE_INHERIT)) return -EINVAL;
+
+  if (pid == SCTRACE_SYSTEM) {
+    if (flags & ~SCTRACE_STATS) return -EINVAL;
+    if (curproc->user.euid != 0) return -EPERM;
+    if (flags && !sctrace_system) {
+      if (system_stats == nullptr) {
+        system_stats = alloc_stats();
+      } else {
+        memset(system_stats, 0, sizeof(struct sctrace_stat) * SCTRACE_NR);
+      }
+    }
+    __atomic_store_n(&sctrace_system, flags != 0, __ATOMIC_RELEASE);
+    return 0;
+  }
+
+  auto p = pid_lookup(pid == 0 ? curproc->pid : pid);
+  if (!p) return -ESRCH;
+  if (!may_trace(*p)) return -EPERM;
+
+  int fd = 0;
+  ck::ref<sctrace_node> events;
+  if (flags & SCTRACE_EVENTS) {
+    events = ck::make_ref<sctrace_node>();
+    fd = curproc->add_fd(fs::File::create(events, "[sctrace]", FDIR_READ));
+    if (fd < 0) return fd;
+  }
+
+  set_tracing(get_sctrace(*p), flags, events);
+  return fd;
+}
+
+
+int sys::sctrace_stats(int pid, struct sctrace_stat *stats, int count) {
+  if (count < 0) return -EINVAL;
+  if (count > SCTRACE_NR) count = SCTRACE_NR;
+  if (!VALIDATE_WR(stats, sizeof(*stats) * count)) return -EFAULT;
+
+  struct sctrace_stat *src = nullptr;
+  ck::ref<Process> p;
+  if (pid == SCTRACE_SYSTEM) {
+    if (curproc->user.euid != 0) return -EPERM;
+    src = system_stats;
+  } else {
+    p = pid_lookup(pid == 0 ? curproc->pid : pid);
+    if (!p) return -ESRCH;
+    if (!may_trace(*p)) return -EPERM;
+    if (p->sctrace) src = p->sctrace->stats;
+  }
+  if (src == nullptr) return -ENOENT;
+
+  memcpy(stats, src, sizeof(*stats) * count);
+  return count;
+}
+
+
+static void sctrace_init(void) {
+#define __SYSCALL_INFO(num, name, ret, flags, str, nargs, args...) \
+  sc_info[num] = {flags, str, strcmp(ret, "void") != 0};
+#include <syscall_info.inc>
+#undef __SYSCALL_INFO
+}
+
+module_init("sctrace", sctrace_init);
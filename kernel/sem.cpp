@@ -1,3 +1,4 @@
+#include <cpu.h>
 #include <sched.h>
 #include <sem.h>
 
@@ -61,3 +62,83 @@ bcout:
   given_lock.lock();
   return wait_result();
 }
+
+
+
+// how many times to poll a running owner before giving up and sleeping
+#define MUTEX_SPIN_LIMIT 4096
+// the owner of a mutex taken before the scheduler is running, when there is no
+// thread to record. It is not a real thread, so it must never be dereferenced
+#define MUTEX_OWNER_NOTHREAD ((Thread *)1)
+
+bool mutex::try_lock(void) {
+  Thread *expected = nullptr;
+  Thread *self = cpu::in_thread() ? curthd : MUTEX_OWNER_NOTHREAD;
+  if (__atomic_compare_exchange_n(&m_owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    m_owner_core = &cpu::current();
+    return true;
+  }
+  return false;
+}
+
+
+// Spin while the owner is on a core, on the assumption it will drop the lock
+// soon. We only compare the owner against the core's current thread, never
+// dereference it, as it may exit once it has released the lock.
+bool mutex::try_spin(void) {
+  for (int i = 0; i < MUTEX_SPIN_LIMIT; i++) {
+    Thread *owner = __atomic_load_n(&m_owner, __ATOMIC_RELAXED);
+    if (owner == nullptr) {
+      if (try_lock()) return true;
+      continue;
+    }
+
+    // boot code holds it, and it never sleeps, so it is still running
+    if (owner == MUTEX_OWNER_NOTHREAD) {
+      arch_relax();
+      continue;
+    }
+
+    auto *c = (cpu::Core *)m_owner_core;
+    // the owner is not running (or we can't tell where), so sleep instead
+    if (c == nullptr || c->current_thread.get() != owner) return false;
+    arch_relax();
+  }
+  return false;
+}
+
+
+void mutex::lock(void) {
+  if (likely(try_lock())) return;
+
+  // we cannot sleep without a thread, so just spin
+  if (!cpu::in_thread()) {
+    while (!try_lock())
+      arch_relax();
+    return;
+  }
+
+  if (try_spin()) return;
+
+  while (1) {
+    struct wait_entry ent;
+    prepare_to_wait_exclusive(m_wq, ent, false);
+    // Announce ourselves before the last attempt. If the owner releases the
+    // lock after this, it will see us and wake the queue.
+    __atomic_fetch_add(&m_waiters, 1, __ATOMIC_SEQ_CST);
+    if (try_lock()) {
+      __atomic_fetch_sub(&m_waiters, 1, __ATOMIC_RELAXED);
+      return;
+    }
+    ent.start();
+    __atomic_fetch_sub(&m_waiters, 1, __ATOMIC_RELAXED);
+    if (try_lock() || try_spin()) return;
+  }
+}
+
+
+void mutex::unlock(void) {
+  m_owner_core = nullptr;
+  __atomic_store_n(&m_owner, nullptr, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&m_waiters, __ATOMIC_SEQ_CST) != 0) m_wq.wake_up();
+}
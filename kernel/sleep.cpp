@@ -20,6 +20,8 @@ void sleep_waiter::start(uint64_t us) {
     cpu->sleepers->prev = this;
   }
   cpu->sleepers = this;
+  // make sure the timer fires in time to wake us up (on one-shot timers)
+  arch_set_timer(us * 1000);
   cpu->sleepers_lock.unlock_irqrestore(flags);
 }
 
@@ -70,6 +72,7 @@ bool check_wakeups_r(void) {
 
   int woke = 0;
   bool found = false;
+  uint64_t next_wakeup = ~0ULL;
   struct sleep_waiter *blk = cpu.sleepers;
   while (blk != NULL) {
     /* Grab the next now, as this node might be removed */
@@ -81,6 +84,8 @@ bool check_wakeups_r(void) {
       blk->wq.wake_up_all();
       woke++;
       found = true;
+    } else if (blk->wakeup_us < next_wakeup) {
+      next_wakeup = blk->wakeup_us;
     }
 
     /* Continue the loop */
@@ -88,6 +93,9 @@ bool check_wakeups_r(void) {
   }
   // if (woke > 0) printf_nolock("woke up %d threads\n", woke);
 
+  // arm the timer for the next sleeper
+  if (next_wakeup != ~0ULL) arch_set_timer((next_wakeup - now) * 1000);
+
   return found;
 }
 
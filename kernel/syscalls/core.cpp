@@ -5,8 +5,10 @@
 #include <ck/map.h>
 #include <mem.h>
 #include <mmap_flags.h>
+#include <multicall.h>
 #include <module.h>
 #include <phys.h>
+#include <sctrace.h>
 #include <syscall.h>
 #include <util.h>
 #include <vga.h>
@@ -22,13 +24,14 @@ struct syscall {
   const char *name;
   int num;
   void *handler;
+  int flags;  // SCINFO_*
 };
 
 struct syscall syscall_table[255];
 
 void set_syscall(const char *name, int num, void *handler) {
   assert(num >= 0 && num < 255);
-  syscall_table[num] = {.name = name, .num = num, .handler = handler};
+  syscall_table[num] = {.name = name, .num = num, .handler = handler, .flags = 0};
 }
 
 
@@ -49,11 +52,46 @@ uint64_t do_syscall(long num, uint64_t a, uint64_t b, uint64_t c, uint64_t d, ui
 #endif
   curthd->stats.syscall_count++;
 
+  if (unlikely(sctrace_system || curproc->sctrace != NULL)) {
+    unsigned long args[6] = {a, b, c, d, e, f};
+    unsigned long res;
+    if (sctrace_syscall(num, syscall_table[num].handler, args, res)) return res;
+  }
+
   auto *func = (uint64_t(*)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t))syscall_table[num].handler;
   auto res = func(a, b, c, d, e, f);
   return res;
 }
 
+int sys::multicall(struct multicall_entry *calls, int count, int flags) {
+  if (flags & ~MULTICALL_STOP_ON_ERROR) return -EINVAL;
+  if (count < 0 || count > MULTICALL_MAX) return -EINVAL;
+  if (!VALIDATE_RDWR(calls, sizeof(*calls) * count)) return -EFAULT;
+
+  for (int i = 0; i < count; i++) {
+    // a call earlier in the batch may have unmapped the array itself
+    if (!VALIDATE_RDWR(&calls[i], sizeof(*calls))) return i ? i : -EFAULT;
+    long num = calls[i].num;
+    unsigned long a[6];
+    memcpy(a, calls[i].args, sizeof(a));
+
+    long res;
+    if ((num & ~0xFF) || num == 0xFF || syscall_table[num].handler == NULL) {
+      res = -ENOSYS;
+    } else if (syscall_table[num].flags & SCINFO_NOBATCH) {
+      res = -EINVAL;
+    } else {
+      res = do_syscall(num, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+
+    if (!VALIDATE_WR(&calls[i].result, sizeof(long))) return i + 1;
+    calls[i].result = res;
+    if ((flags & MULTICALL_STOP_ON_ERROR) && res < 0 && res >= -4095) return i + 1;
+  }
+  return count;
+}
+
+
 extern "C" void syscall_handle(int i, reg_t *regs, void *data) {
   regs[0] = do_syscall(regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6]);
 }
@@ -64,6 +102,10 @@ static void syscall_init(void) {
 #define __SYSCALL(num, name, args...) set_syscall(#name, num, (void *)sys::name);
 #include <syscalls.inc>
 #undef __SYSCALL
+
+#define __SYSCALL_INFO(num, name, ret, scflags, args...) syscall_table[num].flags = scflags;
+#include <syscall_info.inc>
+#undef __SYSCALL_INFO
 }
 
 
@@ -1,7 +1,11 @@
 #include <cpu.h>
 #include <dirent.h>
+#include <errno.h>
 #include <syscall.h>
 
+// the most getdents() fills in one call
+#define GETDENTS_MAX (64 * 1024)
+
 int sys::dirent(int fd, struct dirent *ents, int off, int count) {
   if (ents != NULL && !curproc->mm->validate_pointer(ents, count * sizeof(struct dirent), VALIDATE_WRITE)) return -1;
 
@@ -28,6 +32,7 @@ int sys::dirent(int fd, struct dirent *ents, int off, int count) {
 
 
       ents[i].d_ino = 0;
+      ents[i].d_type = DT_UNKNOWN;
       memcpy(ents[i].d_name, n->name.get(), len);
       c++;
     }
@@ -37,3 +42,52 @@ int sys::dirent(int fd, struct dirent *ents, int off, int count) {
 
   return -1;
 }
+
+
+ssize_t sys::getdents(int fd, struct dirent64 *ubuf, size_t len) {
+  ck::ref<fs::File> file = curproc->get_fd(fd);
+  if (!file) return -EBADF;
+  if (!file->ino->is_dir()) return -ENOTDIR;
+  if (!VALIDATE_WR(ubuf, len)) return -EFAULT;
+  if (len > GETDENTS_MAX) len = GETDENTS_MAX;
+
+  // fill a kernel buffer, so the file system never faults on the user's
+  char *buf = (char *)malloc(len);
+  size_t used = 0;
+  bool full = false;
+  // where the last entry copied out ends
+  off_t pos = file->offset();
+
+  off_t off = file->ino->getdents(*file, file->offset(), [&](const char *name, size_t namelen, unsigned long ino, int type, off_t next) -> bool {
+    size_t reclen = round_up(offsetof(struct dirent64, d_name) + namelen + 1, 8);
+    if (used + reclen > len) {
+      full = true;
+      return false;
+    }
+
+    auto *ent = (struct dirent64 *)(buf + used);
+    ent->d_ino = ino;
+    ent->d_off = next;
+    ent->d_reclen = reclen;
+    ent->d_type = type;
+    memcpy(ent->d_name, name, namelen);
+    ent->d_name[namelen] = '\0';
+    used += reclen;
+    pos = next;
+    return true;
+  });
+
+  ssize_t res = used;
+  if (used == 0 && off < 0) {
+    res = off;
+  } else if (used == 0 && full) {
+    // the next entry doesn't fit in the buffer at all
+    res = -EINVAL;
+  } else {
+    memcpy(ubuf, buf, used);
+    file->seek(off >= 0 ? off : pos, SEEK_SET);
+  }
+
+  free(buf);
+  return res;
+}
@@ -1,8 +1,10 @@
 #include <syscall.h>
 #include <cpu.h>
+#include <fs/magicfd.h>
 
 int sys::dup(int fd) {
   auto f = curproc->get_fd(fd);
+  if (!f) return -EBADF;
   return curproc->add_fd(f);
 }
 
@@ -10,11 +12,8 @@ int sys::dup(int fd) {
 int sys::dup2(int oldfd, int newfd) {
   auto f = curproc->get_fd(oldfd);
   if (!f) return -EBADFD;
+  if ((newfd & MAGICFD_MASK) != 0) return -EPERM;
 
-
-  sys::close(newfd);
-
-  scoped_lock l(curproc->file_lock);
-  curproc->open_files.set(newfd, f);
-  return newfd;
+  // replaces newfd in one go, so nobody sees it closed in between
+  return curproc->set_fd(newfd, f);
 }
@@ -75,19 +75,7 @@ int sys::execve(const char *path, const char **uargv, const char **uenvp) {
     fd = ck::make_ref<fs::File>(exe, FDIR_READ);
   }
 
-  {
-    ck::vec<int> to_close;
-    scoped_lock l(curproc->file_lock);
-    for (auto [fd, file] : curproc->open_files) {
-      if (fd >= 3) {
-        to_close.push(fd);
-      }
-    }
-
-    for (int fd : to_close) {
-      curproc->open_files.remove(fd);
-    }
-  }
+  curproc->close_fds(3);
 
   off_t entry = 0;
   mm::AddressSpace *new_addr_space = nullptr;
@@ -130,6 +118,14 @@ int sys::execve(const char *path, const char **uargv, const char **uenvp) {
   arch_reg(REG_SP, tf) = stack + stack_size - 64;
   arch_reg(REG_PC, tf) = (unsigned long)entry;
 
+  // the old TLS block went away with the old address space
+  curthd->tls_ubase = curthd->tls_usize = curthd->tls_uaddr = 0;
+  if (int err = curthd->setup_tls(tf); err != 0) {
+    // the old image is gone, so there is nothing to fail back to
+    sys::exit_proc(-1);
+    return err;
+  }
+
   cpu::switch_vm(curthd);
 
   curthd->setup_stack(tf);
@@ -82,7 +82,7 @@ int sys::mregions(struct mmap_region *dst, int nregions) {
 
   // if passed null, return the number of regions
   if (dst == 0) {
-    scoped_lock l(mm.lock);
+    scoped_mutex l(mm.lock);
     return regions;
   }
 
@@ -0,0 +1,75 @@
+#include <cpu.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mm.h>
+#include <syscall.h>
+
+#define SPLICE_F_ALL (SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT)
+
+
+// Feed the pages behind `in` to `out`. File systems hand over the pages in
+// their caches (tmpfs pages, block cache buffers), so the only copy is the one
+// into wherever `out` keeps its data. An offset of -1 means the file's own
+// offset, which the nodes advance themselves
+static ssize_t do_splice(fs::File &in, off_t in_off, fs::File &out, off_t out_off, size_t len) {
+  if (in.ino == out.ino && in_off != -1 && out_off != -1) {
+    // overlapping ranges of the same file would read back what was just written
+    if (in_off < out_off + (off_t)len && out_off < in_off + (off_t)len) return -EINVAL;
+  }
+
+  ssize_t written = 0;
+  ssize_t n = in.ino->splice_read(in, in_off, len, [&](ck::ref<mm::Page> page, size_t pgoff, size_t sz) -> ssize_t {
+    ssize_t w = out.ino->splice_write(out, page, pgoff, sz, out_off == -1 ? -1 : out_off + written);
+    if (w > 0) written += w;
+    return w;
+  });
+
+  if (n < 0 && written == 0) return n;
+  return written;
+}
+
+
+static bool get_off(long *uoff, off_t &off) {
+  off = -1;
+  if (uoff == NULL) return true;
+  if (!VALIDATE_RDWR(uoff, sizeof(*uoff))) return false;
+  off = *uoff;
+  return true;
+}
+
+
+ssize_t sys::sendfile(int out_fd, int in_fd, long *uoff, size_t count) {
+  off_t off;
+  if (!get_off(uoff, off)) return -EFAULT;
+  if (uoff != NULL && off < 0) return -EINVAL;
+
+  auto in = curproc->get_fd(in_fd);
+  auto out = curproc->get_fd(out_fd);
+  if (!in || !out) return -EBADF;
+  if (count == 0) return 0;
+
+  ssize_t n = do_splice(*in, off, *out, -1, count);
+  if (n > 0 && uoff != NULL) *uoff = off + n;
+  return n;
+}
+
+
+ssize_t sys::splice(int fd_in, long *uoff_in, int fd_out, long *uoff_out, size_t len, unsigned flags) {
+  if (flags & ~SPLICE_F_ALL) return -EINVAL;
+
+  off_t off_in, off_out;
+  if (!get_off(uoff_in, off_in) || !get_off(uoff_out, off_out)) return -EFAULT;
+  if ((uoff_in != NULL && off_in < 0) || (uoff_out != NULL && off_out < 0)) return -EINVAL;
+
+  auto in = curproc->get_fd(fd_in);
+  auto out = curproc->get_fd(fd_out);
+  if (!in || !out) return -EBADF;
+  if (len == 0) return 0;
+
+  ssize_t n = do_splice(*in, off_in, *out, off_out, len);
+  if (n > 0) {
+    if (uoff_in != NULL) *uoff_in = off_in + n;
+    if (uoff_out != NULL) *uoff_out = off_out + n;
+  }
+  return n;
+}
@@ -0,0 +1,71 @@
+#include <cpu.h>
+#include <errno.h>
+#include <syscall.h>
+#include <uio.h>
+
+// most callers pass a handful of buffers, which we can copy onto the stack
+#define UIO_FASTIOV 8
+// the total has to fit in the ssize_t we return
+#define UIO_MAXBYTES ((size_t)(~0UL >> 1))
+
+
+// copy the user's iovec array into `fast` (or a fresh allocation if it
+// doesn't fit) and validate every buffer in it once, so the file system can
+// walk it without checking anything itself
+static ssize_t uio_import(const struct iovec *uiov, int iovcnt, int prot, struct iovec *fast, struct iovec **out) {
+  if (iovcnt < 0 || iovcnt > UIO_MAXIOV) return -EINVAL;
+  if (!VALIDATE_RD(uiov, sizeof(*uiov) * iovcnt)) return -EFAULT;
+
+  struct iovec *iov = fast;
+  if (iovcnt > UIO_FASTIOV) iov = (struct iovec *)malloc(sizeof(*iov) * iovcnt);
+  memcpy(iov, uiov, sizeof(*iov) * iovcnt);
+
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; i++) {
+    size_t len = iov[i].iov_len;
+    if (len > UIO_MAXBYTES - total) {
+      if (iov != fast) free(iov);
+      return -EINVAL;
+    }
+    total += len;
+    if (len != 0 && !curproc->mm->validate_pointer(iov[i].iov_base, len, prot)) {
+      if (iov != fast) free(iov);
+      return -EFAULT;
+    }
+  }
+
+  *out = iov;
+  return total;
+}
+
+
+static ssize_t do_rw(int fd, const struct iovec *uiov, int iovcnt, off_t off, bool write) {
+  ck::ref<fs::File> file = curproc->get_fd(fd);
+  if (!file) return -EBADF;
+
+  struct iovec fast[UIO_FASTIOV];
+  struct iovec *iov = nullptr;
+  ssize_t total = uio_import(uiov, iovcnt, write ? PROT_READ : PROT_WRITE, fast, &iov);
+  if (total < 0) return total;
+
+  ssize_t n = 0;
+  if (total != 0) n = write ? file->writev(iov, iovcnt, off) : file->readv(iov, iovcnt, off);
+
+  if (iov != fast) free(iov);
+  return n;
+}
+
+
+ssize_t sys::readv(int fd, const struct iovec *iov, int iovcnt) { return do_rw(fd, iov, iovcnt, -1, false); }
+
+ssize_t sys::writev(int fd, const struct iovec *iov, int iovcnt) { return do_rw(fd, iov, iovcnt, -1, true); }
+
+ssize_t sys::preadv(int fd, const struct iovec *iov, int iovcnt, long off) {
+  if (off < 0) return -EINVAL;
+  return do_rw(fd, iov, iovcnt, off, false);
+}
+
+ssize_t sys::pwritev(int fd, const struct iovec *iov, int iovcnt, long off) {
+  if (off < 0) return -EINVAL;
+  return do_rw(fd, iov, iovcnt, off, true);
+}
@@ -10,6 +10,7 @@
 #include <phys.h>
 #include <syscall.h>
 #include <time.h>
+#include <tls.h>
 #include <debug.h>
 #include <module.h>
 #include <util.h>
@@ -28,17 +29,63 @@ extern "C" void trapret(void);
 static spinlock thread_table_lock;
 ck::map<long, ck::weak_ref<Thread>> thread_table;
 
+
+#define KSTACK_SIZE (PGSIZE * 2)
+// written to the lowest word of every kernel stack. If it changes, the stack overflowed
+#define KSTACK_CANARY 0x6b737461636b2121ULL
+
+/*
+ * Creating a thread used to mean a trip through the global heap for its
+ * kernel stack. Stacks are now recycled through a small per-core cache,
+ * which takes no lock, and only fall back to malloc when it is empty.
+ */
+static void *kstack_alloc(void) {
+  void *stk = NULL;
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  auto &c = core();
+  if (c.kstack_cached > 0) stk = c.kstack_cache[--c.kstack_cached];
+  if (en) arch_enable_ints();
+
+  if (stk == NULL) stk = malloc(KSTACK_SIZE);
+  *(uint64_t *)stk = KSTACK_CANARY;
+  return stk;
+}
+
+
+static inline void kstack_check(void *stk) {
+  if (*(uint64_t *)stk != KSTACK_CANARY) panic("kernel stack %p overflowed\n", stk);
+}
+
+
+static void kstack_free(void *stk) {
+  kstack_check(stk);
+
+  bool en = arch_irqs_enabled();
+  arch_disable_ints();
+  auto &c = core();
+  if (c.kstack_cached < (int)(sizeof(c.kstack_cache) / sizeof(c.kstack_cache[0]))) {
+    c.kstack_cache[c.kstack_cached++] = stk;
+    stk = NULL;
+  }
+  if (en) arch_enable_ints();
+
+  if (stk != NULL) free(stk);
+}
+
 Thread::Thread(long tid, Process &proc) : proc(proc), m_constraint(rt::AperiodicConstraint{}) {
   this->tid = tid;
   this->pid = proc.pid;
 
+  // the FPU state is allocated the first time the thread uses the FPU
   fpu.initialized = false;
-  fpu.state = phys::kalloc(1);
+  fpu.state = NULL;
 
 
   KernelStack s;
-  s.size = PGSIZE * 2;
-  s.start = (void *)malloc(s.size);
+  s.size = KSTACK_SIZE;
+  s.start = kstack_alloc();
   stacks.push(s);
 
   name = proc.name;
@@ -92,10 +139,10 @@ Thread::~Thread(void) {
 
   // free all the kernel stacks
   for (auto &s : stacks) {
-    free(s.start);
+    kstack_free(s.start);
   }
   // free the FPU state page
-  phys::free(fpu.state, 1);
+  if (fpu.state != NULL) phys::free(fpu.state, NPAGES(arch_fpu_state_size()));
 
   // memset((void *)this, 0xFF, sizeof(*this));
 }
@@ -137,6 +184,11 @@ void Thread::reset_stats(void) {
 
 uint64_t Thread::epoch(void) { return 10 * 1000 * 1000; }
 
+void Thread::start_slice(void) {
+  slice_end = arch_read_timestamp() + arch_ns_to_timestamp(epoch());
+  arch_set_timer(epoch());
+}
+
 
 bool Thread::kickoff(void *rip, int initial_state) {
   arch_reg(REG_PC, trap_frame) = (unsigned long)rip;
@@ -212,6 +264,51 @@ void Thread::setup_stack(reg_t *tf) {
 }
 
 
+int Thread::setup_tls(reg_t *tf) {
+  auto &tls = proc.tls_info;
+
+  size_t align = 16;
+  if (tls.exists && tls.align > align) align = tls.align;
+  // the block sits right next to the TCB, so it can't be aligned any more than the TCB is
+  if (align > CHARIOT_TCB_SIZE) return -EINVAL;
+
+  size_t block = tls.exists ? round_up(tls.memsz, align) : 0;
+  size_t size = round_up(block + CHARIOT_TCB_SIZE, PGSIZE);
+
+  off_t base = proc.mm->mmap("[tls]", 0, size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, nullptr, 0);
+  if (base == -1) return -ENOMEM;
+
+#ifdef CONFIG_RISCV
+  // variant I: the block follows the TCB, and tp points at the block
+  auto *tcb = (struct chariot_tcb *)base;
+  off_t data = base + CHARIOT_TCB_SIZE;
+  off_t tp = data;
+  ((rv::regs *)tf)->tp = tp;
+#else
+  // variant II: the block ends where the TCB starts, and tp points at the TCB
+  auto *tcb = (struct chariot_tcb *)(base + block);
+  off_t data = base;
+  off_t tp = (off_t)tcb;
+#endif
+
+  // this runs in the thread's address space, so the template is just a user pointer.
+  // The mapping is anonymous, so .tbss is already zero
+  if (tls.exists) memcpy((void *)data, (void *)tls.vaddr, tls.fsize);
+  tcb->self = tcb;
+
+  tls_ubase = base;
+  tls_usize = size;
+  tls_uaddr = tp;
+  return 0;
+}
+
+
+void Thread::release_tls(void) {
+  if (tls_ubase != 0) proc.mm->unmap(tls_ubase, tls_usize);
+  tls_ubase = tls_usize = tls_uaddr = 0;
+}
+
+
 
 static void thread_create_callback(void *) { arch_thread_create_callback(); }
 
@@ -224,6 +321,26 @@ ck::ref<Thread> Thread::lookup(long tid) {
   return t;
 }
 
+ck::ref<Thread> Thread::find(long tid) {
+  scoped_irqlock l(thread_table_lock);
+  if (!thread_table.contains(tid)) return nullptr;
+  return Thread::lookup_r(tid);
+}
+
+ck::ref<Thread> Thread::lookup_for_user(long tid) {
+  if (tid == 0) return curthd;
+  ck::ref<Thread> t = nullptr;
+  {
+    scoped_irqlock l(thread_table_lock);
+    if (thread_table.contains(tid)) t = Thread::lookup_r(tid);
+  }
+  if (t == nullptr) return nullptr;
+  // Only threads in your own process, or threads owned by the same user
+  // (unless you are root) may be inspected or changed.
+  if (t->pid != curthd->pid && curproc->user.euid != 0 && t->proc.user.uid != curproc->user.uid) return nullptr;
+  return t;
+}
+
 
 
 void Thread::dump(void) {
@@ -348,12 +465,80 @@ int sys::spawnthread(void *vstack, void *fn, void *arg, int flags) {
   arch_reg(REG_PC, thd->trap_frame) = (unsigned long)fn;
   arch_reg(REG_ARG0, thd->trap_frame) = (unsigned long)arg;
 
+  // new threads inherit the affinity of their creator
+  thd->affinity = curthd->affinity;
+
   thd->kickoff(fn, PS_RUNNING);
 
   return tid;
 }
 
 
+int Thread::set_affinity(unsigned long mask) {
+  // only allow cores that actually exist
+  unsigned long online = 0;
+  cpu::each([&](cpu::Core *c) {
+    if (c->id < 64) online |= 1UL << c->id;
+  });
+  mask &= online;
+  if (mask == 0) return -EINVAL;
+
+  __atomic_store_n(&affinity, mask, __ATOMIC_SEQ_CST);
+
+  // If we are changing our own affinity and we are on a core we are no longer
+  // allowed on, yield. The scheduler will place us on an allowed core when it
+  // tries to make us runnable again.
+  if (curthd == this) {
+    if (!can_run_on(core_id())) sched::yield();
+    return 0;
+  }
+
+  // If the thread is sitting in the run queue of a core it may no longer use,
+  // pull it off and let make_runnable find it a new home. A thread that is
+  // currently running on such a core moves the next time it is preempted or
+  // blocks, as every placement path goes through make_runnable.
+  auto *s = current_scheduler();
+  if (s != nullptr && !can_run_on(s->core().id)) {
+    bool queued = false;
+    {
+      auto l = s->lock();
+      if (current_queue != NULL) {
+        s->dequeue(this);
+        queued = true;
+      }
+    }
+    if (queued) make_runnable(RT_CORE_ANY);
+  }
+
+  return 0;
+}
+
+
+int sys::sched_setaffinity(int tid, size_t size, unsigned long *mask) {
+  if (size < sizeof(unsigned long)) return -EINVAL;
+  if (!VALIDATE_RD(mask, sizeof(unsigned long))) return -EFAULT;
+
+  auto t = Thread::lookup_for_user(tid);
+  if (t == nullptr) return -ESRCH;
+
+  return t->set_affinity(*mask);
+}
+
+int sys::sched_getaffinity(int tid, size_t size, unsigned long *mask) {
+  if (size < sizeof(unsigned long)) return -EINVAL;
+  if (!VALIDATE_WR(mask, size)) return -EFAULT;
+
+  auto t = Thread::lookup_for_user(tid);
+  if (t == nullptr) return -ESRCH;
+
+  memset(mask, 0, size);
+  *mask = __atomic_load_n(&t->affinity, __ATOMIC_ACQUIRE);
+  return 0;
+}
+
+int sys::getcpu(void) { return cpu::current().id; }
+
+
 bool Thread::join(ck::ref<Thread> thd) {
   panic("oh no\n");
   return true;
@@ -430,13 +615,25 @@ void Thread::run(void) {
   }
 
 
+  {
+    scoped_irqlock l(schedlock);
+    on_core = true;
+  }
+
   barrier();
   // Before entering the thread, configure the timer which will take us out of it
-  arch_set_timer(epoch());
+  start_slice();
   // Switch into the thread!
   context_switch(&cpu::current().sched_ctx, this->kern_context);
   barrier();
 
+  {
+    // We are off the thread's stack now, so another core may take it.
+    scoped_irqlock l(schedlock);
+    on_core = false;
+  }
+  kstack_check(stacks[0].start);
+
   if (proc.ring == RING_USER) arch_save_fpu(*this);
 
   if (ts) this->ktime_us += time::now_us() - start_us;
@@ -1,72 +1,117 @@
 #include <arch.h>
 #include <asm.h>
 #include <cpu.h>
+#include <lock.h>
+#include <printf.h>
 #ifdef CONFIG_X86
 #include <dev/RTC.h>
 #endif
 #include <time.h>
+#include <vvar.h>
 
 
-
-static unsigned long last_cycle = 0;
-static volatile uint64_t cycles_per_second = 0;
+// the second, according to the RTC (or the arch), as of the last timekeep()
 static volatile uint64_t current_second = 0;
 
+static time::clocksource g_clock;
+static volatile bool g_clock_valid = false;
+
+// The time at a known cycle count. now_ns() extrapolates from here, and
+// timekeep() moves the base forward so the delta stays small.
+static seqlock base_lock;
+static uint64_t base_cycle = 0;
+static uint64_t base_ns = 0;
+static int g_vvar_mode = VVAR_CLOCK_NONE;
+
+
+// publish the base to userspace. Called with base_lock held
+static void update_vvar(void) {
+  vvar::write_begin();
+  auto *v = vvar::get();
+  v->clock_mode = g_vvar_mode;
+  v->mult = g_clock.mult;
+  v->shift = g_clock.shift;
+  v->base_cycle = base_cycle;
+  v->base_ns = base_ns;
+  vvar::write_end();
+}
+
+
+bool time::stabilized(void) { return g_clock_valid; }
 
-void time::set_cps(unsigned long cps) { cycles_per_second = cps; }
+const time::clocksource *time::current_clocksource(void) { return g_clock_valid ? &g_clock : nullptr; }
 
-bool time::stabilized(void) { return cycles_per_second != 0; }
 
+static inline uint64_t clock_delta_ns(uint64_t cycles, unsigned mult, unsigned shift) {
+  // a 128 bit product can't overflow, no matter how long it's been since the base
+  return (uint64_t)(((unsigned __int128)cycles * mult) >> shift);
+}
 
-static unsigned long (*g_high_acc)(void) = NULL;
-void time::set_high_accuracy_time_fn(unsigned long (*fn)(void)) { g_high_acc = fn; }
 
 unsigned long time::cycles_to_ns(unsigned long cycles) {
-  /* hmm */
-  if (cycles_per_second == 0) return 0;
-  return (cycles * NS_PER_SEC) / cycles_per_second;
+  if (!g_clock_valid) return 0;
+  return clock_delta_ns(cycles, g_clock.mult, g_clock.shift);
 }
 
-unsigned long long time::now_ns() {
-  /* if the arch gives us this func, use it :) */
-  if (g_high_acc != NULL) {
-    return g_high_acc();
-  }
 
-  /* If the time is not stabilized yet, ask the arch to convert. */
-  if (unlikely(!time::stabilized())) {
-    cycles_per_second = arch_ns_to_timestamp(NS_PER_SEC);
+void time::register_clocksource(const char *name, unsigned long (*read)(void), unsigned long freq_hz, int vvar_mode) {
+  // Pick the largest shift (the most precision) where mult still fits in 32
+  // bits. mult = (NS_PER_SEC << shift) / freq_hz
+  unsigned shift = 32;
+  uint64_t mult = 0;
+  for (; shift > 0; shift--) {
+    mult = (((unsigned __int128)NS_PER_SEC << shift) + freq_hz / 2) / freq_hz;
+    if (mult <= 0xFFFFFFFF) break;
   }
 
-  auto cps = cycles_per_second;
-  /* if we haven't be calibrated yet, guess based on the LAPIC tick rate */
-  if (cps == 0) {
-    auto &cpu = cpu::current();
-    cps = cpu.kstat.tsc_per_tick * cpu.ticks_per_second;
+  bool en = base_lock.write_lock();
+  g_clock.name = name;
+  g_clock.read = read;
+  g_clock.freq_hz = freq_hz;
+  g_clock.mult = mult;
+  g_clock.shift = shift;
+
+  if (current_second != 0) {
+    // continue from the wall clock
+    base_cycle = read();
+    base_ns = current_second * NS_PER_SEC;
+  } else {
+    // there is no wall clock, so time is the counter's time since reset
+    base_cycle = 0;
+    base_ns = 0;
   }
+  g_clock_valid = true;
+  g_vvar_mode = vvar_mode;
+  update_vvar();
+  base_lock.write_unlock(en);
 
-  uint64_t now_cycle = arch_read_timestamp();
-  uint64_t delta = now_cycle - last_cycle;
-
-  /*
-   * this is a big hack. It accounts for variable IRQ timings
-   * and avoids time travel in the case that a second takes
-   * a different number of cycles.
-   */
-  if (delta > cps) delta = cps;
-
-  uint64_t ns = (current_second * NS_PER_SEC);
+  printf(KERN_INFO "time: using the %s clocksource (%lu.%06lu MHz, mult=%u, shift=%u)\n", name, freq_hz / 1000000,
+      freq_hz % 1000000, (unsigned)mult, shift);
+}
 
-  if (cycles_per_second != 0) {
-    ns += time::cycles_to_ns(delta);
-  }
 
-  return ns;
+unsigned long long time::now_ns() {
+  if (unlikely(!g_clock_valid)) return current_second * NS_PER_SEC;
+
+  uint64_t cycle, ns;
+  unsigned mult, shift;
+  unsigned seq;
+  do {
+    seq = base_lock.read_begin();
+    cycle = base_cycle;
+    ns = base_ns;
+    mult = g_clock.mult;
+    shift = g_clock.shift;
+  } while (base_lock.read_retry(seq));
+
+  uint64_t now = g_clock.read();
+  // The counter may be a hair behind the base if it was read on another core
+  // just before the base was moved. Never go backwards.
+  if (unlikely(now < cycle)) return ns;
+  return ns + clock_delta_ns(now - cycle, mult, shift);
 }
 
-unsigned long long time::now_us(void) {
-  return now_ns() / 1000;  // (current_second * US_PER_SEC) + us_this_second;
-}
+unsigned long long time::now_us(void) { return now_ns() / 1000; }
 
 unsigned long long time::now_ms(void) { return now_us() / 1000; }
 
@@ -79,15 +124,24 @@ void time::timekeep(void) {
 #else
   auto now_second = arch_seconds_since_boot();
 #endif
+  time::set_second(now_second);
 
-  if (now_second != current_second) {
-    unsigned long now_cycle = arch_read_timestamp();
-    if (last_cycle != 0) {
-      cycles_per_second = now_cycle - last_cycle;
-    }
-    last_cycle = now_cycle;
+  if (!g_clock_valid) return;
+
+  // Fold the time so far into the base. If the clocksource has fallen a whole
+  // second behind the wall clock (it was started before the RTC), step it
+  // forward. We never step it backwards.
+  bool en = base_lock.write_lock();
+  uint64_t now = g_clock.read();
+  if (now > base_cycle) {
+    uint64_t ns = base_ns + clock_delta_ns(now - base_cycle, g_clock.mult, g_clock.shift);
+    uint64_t wall = now_second * NS_PER_SEC;
+    if (ns + NS_PER_SEC < wall) ns = wall;
+    base_cycle = now;
+    base_ns = ns;
+    update_vvar();
   }
-  time::set_second(now_second);
+  base_lock.write_unlock(en);
 }
 
 void time::set_second(unsigned long sec) { current_second = sec; }
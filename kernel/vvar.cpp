@@ -0,0 +1,60 @@
+#include <mm.h>
+#include <phys.h>
+#include <vvar.h>
+
+
+static struct chariot_vvar *vvar_data = nullptr;
+static ck::ref<mm::Page> vvar_page = nullptr;
+
+
+// every process maps the same physical page
+struct vvar_vmobject final : public mm::VMObject {
+  vvar_vmobject(void) : VMObject(1) {}
+  virtual ~vvar_vmobject(void){};
+
+  virtual ck::ref<mm::Page> get_shared(off_t n) override {
+    vvar::get();
+    return vvar_page;
+  }
+};
+
+static ck::ref<mm::VMObject> vvar_obj = nullptr;
+
+
+struct chariot_vvar *vvar::get(void) {
+  if (unlikely(vvar_data == nullptr)) {
+    vvar_page = mm::Page::alloc();
+    vvar_data = (struct chariot_vvar *)p2v(vvar_page->pa());
+    memset(vvar_data, 0, PGSIZE);
+  }
+  return vvar_data;
+}
+
+
+int vvar::map(mm::AddressSpace &mm) {
+  if (vvar_obj.is_null()) vvar_obj = ck::make_ref<vvar_vmobject>();
+
+  auto addr = mm.mmap("[vvar]", CHARIOT_VVAR_ADDR, PGSIZE, PROT_READ, MAP_ANON | MAP_SHARED, nullptr, 0);
+  if (addr != CHARIOT_VVAR_ADDR) return -ENOMEM;
+
+  auto region = mm.lookup(addr);
+  if (region == nullptr) return -ENOMEM;
+
+  vvar_obj->acquire();
+  region->obj = vvar_obj;
+  return 0;
+}
+
+
+// The time code already serializes its writers, so these only need to flip
+// the sequence number around the update.
+void vvar::write_begin(void) {
+  auto *v = vvar::get();
+  __atomic_store_n(&v->seq, v->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void vvar::write_end(void) {
+  auto *v = vvar::get();
+  __atomic_store_n(&v->seq, v->seq + 1, __ATOMIC_RELEASE);
+}
@@ -8,6 +8,7 @@
 #include <chariot.h>
 
 #include <chariot/awaitfs_types.h>
+#include <awaitset.h>
 #include <sys/sysbind.h>
 #include <sys/syscall.h>
 #include <ck/ptr.h>
@@ -15,6 +16,7 @@
 #include <ck/rand.h>
 #include <ck/tuple.h>
 #include <ck/time.h>
+#include <errno.h>
 
 
 static volatile bool currently_running_defered_functions = false;
@@ -37,8 +39,19 @@ void ck::eventloop::defer_unique(const char *name, ck::func<void(void)> cb) {
 
   // printf("uniquely defered '%s'\n", name);
 }
-static ck::HashTable<ck::fsnotifier *> s_notifiers;
+// every active notifier, and what it is registered with the awaitset as
+struct notifier_registration {
+  int fd;
+  int mask;
+};
+static ck::map<ck::fsnotifier *, notifier_registration> s_notifiers;
 static ck::HashTable<ck::timer *> s_timers;
+static int s_awaitset = -1;
+
+static int awaitset_fd(void) {
+  if (s_awaitset < 0) s_awaitset = awaitset_create(0);
+  return s_awaitset;
+}
 
 
 static size_t current_ms() { return sysbind_gettime_microsecond() / 1000; }
@@ -157,75 +170,52 @@ ck::pair<ck::timer *, long long> ck::eventloop::check_timers() {
 }
 
 
-static long nonce = 0;
+#define PUMP_EVENTS 64
+
 void ck::eventloop::pump(void) {
   // step 1: run any defered functions
   run_deferred();
 
   // step 2: check the timers for any pending timer ticks. If there are any, run them. When no more
-  // pending timer ticks are avail, pick the closest timeout as the timeout for the awaitfs call
+  // pending timer ticks are avail, pick the closest timeout as the timeout for the wait
   auto [nt, timeout] = check_timers();
 
-  // step 3: construct an array of await_targets for the awaitfs call
-  ck::vec<struct await_target> targs;
-  targs.ensure_capacity(s_notifiers.size());
-  auto add_fd = [&](int fd, int mask, ck::object *obj) {
-    struct await_target targ = {0};
-    targ.fd = fd;
-    targ.awaiting = mask;
-    targ.priv = (void *)obj;
-    targs.push(move(targ));
-  };
-
-  for (auto &notifier : s_notifiers) {
-    int fd = notifier->fd();
-    int event = notifier->ev_mask();
-    add_fd(fd, event, notifier);
-  }
-
+  // step 3: wait on the awaitset. The notifiers are registered with it as they come and go, so
+  // this only costs as much as the number of notifiers that are ready
+  if (s_notifiers.size() > 0 || timeout != -1) {
+    struct awaitset_event events[PUMP_EVENTS];
+    int n = awaitset_wait(awaitset_fd(), events, PUMP_EVENTS, timeout);
 
-  /* Shuffle the target order */
-  int n = targs.size();
-  for (int i = 0; i < n; i++) {
-    int j = i + ::rand() / (RAND_MAX / (n - i) + 1);
-    if (j == i) continue;
-    swap(targs[i], targs[j]);
-  }
+    if (n == 0 && nt != NULL) nt->trigger();
 
-  if (targs.size() > 0 || timeout != -1) {
-    // printf("<\n");
-    int index = awaitfs(targs.data(), targs.size(), 0, timeout);
-    // printf(">\n");
-    if (index >= 0) {
-      auto occ = targs[index].occurred;
+    for (int i = 0; i < n; i++) {
+      auto *notifier = (ck::fsnotifier *)events[i].data;
+      auto occ = events[i].events;
       if (occ & AWAITFS_READ) {
         auto event = new ck::event();
         event->type = CK_EVENT_READ;
-        post_event(*(ck::object *)targs[index].priv, event);
+        post_event(*notifier, event);
       }
 
       if (occ & AWAITFS_WRITE) {
         auto event = new ck::event();
         event->type = CK_EVENT_WRITE;
-        post_event(*(ck::object *)targs[index].priv, event);
-      }
-
-    } else {
-      if (errno == ETIMEDOUT) {
-        if (nt != NULL) {
-          nt->trigger();
-        }
+        post_event(*notifier, event);
       }
     }
   }
 }
 
-void ck::eventloop::post_event(ck::object &obj, ck::event *ev) { m_pending.push({obj, ev}); }
+void ck::eventloop::post_event(ck::object &obj, ck::event *ev) { m_pending.push({&obj, ev}); }
 
 void ck::eventloop::dispatch(void) {
-  for (auto &ev : m_pending) {
-    ev.obj.event(*ev.ev);
-    delete ev.ev;
+  // handlers may post more events (or deregister notifiers that have some
+  // waiting), so don't hold on to references into m_pending across them
+  for (int i = 0; i < m_pending.size(); i++) {
+    auto *obj = m_pending[i].obj;
+    auto *ev = m_pending[i].ev;
+    if (obj != NULL) obj->event(*ev);
+    delete ev;
   }
   m_pending.clear();
 }
@@ -280,13 +270,57 @@ ck::eventloop *ck::eventloop::current(void) { return active_eventloop; }
 
 void ck::eventloop::register_notifier(ck::fsnotifier &n) {
   // printf("register notifier %p\n", &n);
-  s_notifiers.set(&n);
+  struct awaitset_event ev;
+  ev.events = n.ev_mask();
+  ev.data = (void *)&n;
+
+  auto it = s_notifiers.find(&n);
+  if (it != s_notifiers.end()) {
+    if (it->value.fd == n.fd()) {
+      // The fd may have been closed and reopened as something else since it
+      // was added (which drops the kernel's watch), so always ask. ENOENT
+      // means the watch is gone, and it has to be added again
+      if (awaitset_ctl(awaitset_fd(), AWAITSET_MOD, n.fd(), &ev) == 0) {
+        it->value.mask = n.ev_mask();
+        return;
+      }
+      if (errno != ENOENT) {
+        perror("awaitset_ctl(MOD)");
+        s_notifiers.remove(it);
+        return;
+      }
+    }
+    // it was re-initialized with a new fd (or file). The old watch may well
+    // be gone already
+    awaitset_ctl(awaitset_fd(), AWAITSET_DEL, it->value.fd, NULL);
+    s_notifiers.remove(it);
+  }
+
+  if (awaitset_ctl(awaitset_fd(), AWAITSET_ADD, n.fd(), &ev) < 0) {
+    perror("awaitset_ctl(ADD)");
+    return;
+  }
+  s_notifiers.set(&n, {n.fd(), n.ev_mask()});
 }
 
 
 void ck::eventloop::deregister_notifier(ck::fsnotifier &n) {
   // printf("dregister notifier %p\n", &n);
-  s_notifiers.remove(&n);
+  auto it = s_notifiers.find(&n);
+  if (it == s_notifiers.end()) return;
+  awaitset_ctl(awaitset_fd(), AWAITSET_DEL, it->value.fd, NULL);
+  s_notifiers.remove(it);
+
+  // drop anything pump() posted for it that hasn't been dispatched yet
+  if (active_eventloop != NULL) {
+    for (auto &p : active_eventloop->m_pending)
+      if (p.obj == &n) p.obj = NULL;
+  }
+}
+
+
+void ck::eventloop::update_notifier(ck::fsnotifier &n) {
+  if (s_notifiers.contains(&n)) register_notifier(n);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -351,6 +385,11 @@ ck::fsnotifier::fsnotifier(int fd, int event_mask) : m_fd(fd), m_ev_mask(event_m
 
 ck::fsnotifier::~fsnotifier(void) { set_active(false); }
 
+void ck::fsnotifier::set_event_mask(int ev) {
+  m_ev_mask = ev;
+  ck::eventloop::update_notifier(*this);
+}
+
 void ck::fsnotifier::set_active(bool a) {
   if (a) {
     ck::eventloop::register_notifier(*this);
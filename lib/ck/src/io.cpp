@@ -270,8 +270,9 @@ void ck::file::update_notifier(void) {
 
   if (this->m_on_read) mask |= AWAITFS_READ;
   if (this->m_on_write) mask |= AWAITFS_WRITE;
-  notifier.set_active(mask != 0);
+  // set the mask first, so the notifier is registered with the right one
   notifier.set_event_mask(mask);
+  notifier.set_active(mask != 0);
 }
 
 
@@ -0,0 +1,137 @@
+#include <ck/eventloop.h>
+#include <ck/ioring.h>
+#include <ck/map.h>
+#include <errno.h>
+
+
+// rings with queued SQEs that haven't been submitted yet
+static ck::HashTable<ck::ioring *> s_dirty;
+
+static void flush_dirty(void) {
+  auto dirty = move(s_dirty);
+  s_dirty.clear();
+  for (auto *ring : dirty)
+    ring->flush();
+}
+
+
+ck::ioring::ioring(unsigned entries) {
+  if (ioring_init(&m_ring, entries) < 0) m_ring.fd = -1;
+  if (valid()) {
+    m_notifier.init(m_ring.fd, AWAITFS_READ);
+    m_notifier.on_event = [this](int) { flush(); };
+    m_notifier.set_active(false);
+  }
+}
+
+
+ck::ioring::~ioring(void) {
+  s_dirty.remove(this);
+  m_notifier.set_active(false);
+  if (valid()) ioring_exit(&m_ring);
+}
+
+
+ck::ioring &ck::ioring::get(void) {
+  static ck::ioring *ring = nullptr;
+  if (ring == nullptr) ring = new ck::ioring();
+  return *ring;
+}
+
+
+struct ioring_sqe *ck::ioring::get_sqe(void) {
+  if (!valid()) return NULL;
+  auto *sqe = ioring_get_sqe(&m_ring);
+  if (sqe == NULL) {
+    // the SQ is full of things we haven't submitted. Push them through now
+    flush();
+    sqe = ioring_get_sqe(&m_ring);
+  }
+  return sqe;
+}
+
+
+ck::future<long> ck::ioring::queue(struct ioring_sqe *sqe) {
+  ck::future<long> fut;
+  if (sqe == NULL) {
+    fut.resolve(-EAGAIN);
+    return fut;
+  }
+
+  // the CQE hands this back to us in reap()
+  auto *ctrl = new ck::ref<ck::future_control<long>>(fut.get_control());
+  ioring_sqe_set_data(sqe, ctrl);
+  m_inflight++;
+
+  if (!s_dirty.contains(this)) {
+    s_dirty.set(this);
+    ck::eventloop::defer_unique("ck::ioring", flush_dirty);
+  }
+  return fut;
+}
+
+
+void ck::ioring::reap(void) {
+  struct ioring_cqe *cqe;
+  while ((cqe = ioring_peek_cqe(&m_ring)) != NULL) {
+    auto *ctrl = (ck::ref<ck::future_control<long>> *)ioring_cqe_get_data(cqe);
+    long res = cqe->res;
+    ioring_cqe_seen(&m_ring);
+
+    m_inflight--;
+    (*ctrl)->resolve(move(res));
+    delete ctrl;
+  }
+}
+
+
+void ck::ioring::flush(void) {
+  if (!valid()) return;
+  s_dirty.remove(this);
+
+  // anything the kernel couldn't take yet (its CQ was spoken for) goes in
+  // on the next flush, once the ring's fd says something completed
+  if (ioring_submit(&m_ring) >= 0) reap();
+
+  // only keep the event loop awake while there is something to wait for
+  m_notifier.set_active(m_inflight != 0);
+}
+
+
+async(long) ck::ioring::nop(void) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_nop(sqe);
+  return queue(sqe);
+}
+
+async(long) ck::ioring::read(int fd, void *buf, size_t len, off_t off) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_read(sqe, fd, buf, len, off);
+  return queue(sqe);
+}
+
+async(long) ck::ioring::write(int fd, const void *buf, size_t len, off_t off) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_write(sqe, fd, buf, len, off);
+  return queue(sqe);
+}
+
+async(long) ck::ioring::sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+    size_t addrlen) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_sendto(sqe, fd, buf, len, flags, addr, addrlen);
+  return queue(sqe);
+}
+
+async(long) ck::ioring::recvfrom(int fd, void *buf, size_t len, int flags, const struct sockaddr *addr,
+    size_t addrlen) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_recvfrom(sqe, fd, buf, len, flags, addr, addrlen);
+  return queue(sqe);
+}
+
+async(long) ck::ioring::poll(int fd, int events) {
+  auto *sqe = get_sqe();
+  if (sqe) ioring_prep_poll(sqe, fd, events);
+  return queue(sqe);
+}
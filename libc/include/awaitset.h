@@ -0,0 +1,21 @@
+#pragma once
+
+#ifndef _AWAITSET_H
+#define _AWAITSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <chariot/awaitset.h>
+
+// see <chariot/awaitset.h>. These return -1 and set errno on failure
+int awaitset_create(int flags);
+int awaitset_ctl(int set, int op, int fd, struct awaitset_event *ev);
+int awaitset_wait(int set, struct awaitset_event *events, int max, long long timeout_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
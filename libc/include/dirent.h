@@ -8,6 +8,7 @@
 extern "C" {
 #endif
 
+#include <sys/types.h>
 #include "chariot/dirent.h"
 
 typedef struct __dirstream DIR;
@@ -23,6 +24,9 @@ int readdir_r(DIR *__restrict, struct dirent *__restrict,
 void rewinddir(DIR *);
 int dirfd(DIR *);
 
+// read as many packed entries as fit in `len` bytes (see <chariot/dirent.h>)
+ssize_t getdents(int fd, struct dirent64 *buf, size_t len);
+
 
 
 #ifdef __cplusplus
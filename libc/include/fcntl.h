@@ -167,10 +167,6 @@ struct f_owner_ex {
 #define SYNC_FILE_RANGE_WAIT_BEFORE 1
 #define SYNC_FILE_RANGE_WRITE 2
 #define SYNC_FILE_RANGE_WAIT_AFTER 4
-#define SPLICE_F_MOVE 1
-#define SPLICE_F_NONBLOCK 2
-#define SPLICE_F_MORE 4
-#define SPLICE_F_GIFT 8
 // int fallocate(int, int, off_t, off_t);
 // #define fallocate64 fallocate
 // int name_to_handle_at(int, const char *, struct file_handle *, int *, int);
@@ -178,7 +174,7 @@ struct f_owner_ex {
 // ssize_t readahead(int, off_t, size_t);
 // int sync_file_range(int, off_t, off_t, unsigned);
 // ssize_t vmsplice(int, const struct iovec *, size_t, unsigned);
-// ssize_t splice(int, off_t *, int, off_t *, size_t, unsigned);
+ssize_t splice(int, off_t *, int, off_t *, size_t, unsigned);
 // ssize_t tee(int, int, size_t, unsigned);
 // #define loff_t off_t
 #endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef _IORING_H
+#define _IORING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <chariot/ioring.h>
+#include <chariot/awaitfs_types.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/socket.h>
+
+// A thin wrapper around the shared submission/completion rings described in
+// <chariot/ioring.h>. Grab SQEs with ioring_get_sqe, fill them in with the
+// ioring_prep_* helpers, hand them to the kernel with ioring_submit, then
+// reap the results with ioring_peek_cqe/ioring_wait_cqe and ioring_cqe_seen.
+//
+// A ring is not thread safe. Give each thread its own.
+struct ioring {
+  int fd;
+  void *mem;
+  unsigned long size;
+  struct ioring_hdr *hdr;
+  struct ioring_sqe *sqes;
+  struct ioring_cqe *cqes;
+  // SQEs up to here have been handed out, but not given to the kernel yet
+  unsigned sq_tail;
+};
+
+int ioring_init(struct ioring *ring, unsigned entries);
+void ioring_exit(struct ioring *ring);
+
+// returns NULL if the submission queue is full
+struct ioring_sqe *ioring_get_sqe(struct ioring *ring);
+// how many SQEs have been handed out but not submitted
+unsigned ioring_sq_pending(struct ioring *ring);
+
+// Give every prepared SQE to the kernel and run what can be run without
+// blocking. Returns how many were consumed, or -1 and sets errno.
+int ioring_submit(struct ioring *ring);
+// same, but also wait until `wait_nr` completions are ready to be reaped
+int ioring_submit_and_wait(struct ioring *ring, unsigned wait_nr);
+
+// returns NULL if there are no completions waiting
+struct ioring_cqe *ioring_peek_cqe(struct ioring *ring);
+int ioring_wait_cqe(struct ioring *ring, struct ioring_cqe **cqe);
+// release the CQE returned by ioring_peek_cqe/ioring_wait_cqe
+void ioring_cqe_seen(struct ioring *ring);
+
+
+static inline void ioring_prep_rw(
+    struct ioring_sqe *sqe, int op, int fd, const void *addr, unsigned long len, long off) {
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->addr = (unsigned long)addr;
+  sqe->len = len;
+  sqe->off = off;
+}
+
+static inline void ioring_prep_nop(struct ioring_sqe *sqe) { ioring_prep_rw(sqe, IORING_OP_NOP, -1, NULL, 0, -1); }
+
+// `off` of -1 reads or writes at (and moves) the file's offset
+static inline void ioring_prep_read(struct ioring_sqe *sqe, int fd, void *buf, unsigned long len, long off) {
+  ioring_prep_rw(sqe, IORING_OP_READ, fd, buf, len, off);
+}
+
+static inline void ioring_prep_write(struct ioring_sqe *sqe, int fd, const void *buf, unsigned long len, long off) {
+  ioring_prep_rw(sqe, IORING_OP_WRITE, fd, buf, len, off);
+}
+
+static inline void ioring_prep_sendto(struct ioring_sqe *sqe, int fd, const void *buf, unsigned long len, int flags,
+    const struct sockaddr *addr, size_t addrlen) {
+  ioring_prep_rw(sqe, IORING_OP_SENDTO, fd, buf, len, -1);
+  sqe->op_flags = flags;
+  sqe->addr2 = (unsigned long)addr;
+  sqe->addr2_len = addrlen;
+}
+
+static inline void ioring_prep_recvfrom(struct ioring_sqe *sqe, int fd, void *buf, unsigned long len, int flags,
+    const struct sockaddr *addr, size_t addrlen) {
+  ioring_prep_rw(sqe, IORING_OP_RECVFROM, fd, buf, len, -1);
+  sqe->op_flags = flags;
+  sqe->addr2 = (unsigned long)addr;
+  sqe->addr2_len = addrlen;
+}
+
+// completes with the AWAITFS_* events that occurred
+static inline void ioring_prep_poll(struct ioring_sqe *sqe, int fd, int events) {
+  ioring_prep_rw(sqe, IORING_OP_POLL, fd, NULL, 0, -1);
+  sqe->op_flags = events;
+}
+
+static inline void ioring_sqe_set_data(struct ioring_sqe *sqe, void *data) { sqe->user_data = (unsigned long)data; }
+static inline void *ioring_cqe_get_data(struct ioring_cqe *cqe) { return (void *)cqe->user_data; }
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
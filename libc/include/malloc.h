@@ -10,6 +10,12 @@ extern "C" {
 
 size_t malloc_usable_size(void *ptr);
 
+// the allocator libc used to use, kept around to benchmark against
+void *__liballoc_malloc(size_t);
+void __liballoc_free(void *);
+void *__liballoc_calloc(size_t, size_t);
+void *__liballoc_realloc(void *, size_t);
+
 #ifdef __GNUC__
 #define alloca __builtin_alloca
 #endif
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef _MULTICALL_H
+#define _MULTICALL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <chariot/multicall.h>
+#include <sys/syscall_defs.h>
+
+// see <chariot/multicall.h>. Returns how many calls were run, or -1 and sets
+// errno if the batch itself was bad. Each call's own failure is left in its
+// `result` as -errno. sysbind_multicall() is the raw version
+int multicall(struct multicall_entry *calls, int count, int flags);
+
+// fill in an entry. Unused arguments are ignored
+static inline void multicall_prep(struct multicall_entry *e, long num, unsigned long a, unsigned long b,
+    unsigned long c, unsigned long d, unsigned long f, unsigned long g) {
+  e->num = num;
+  e->args[0] = a;
+  e->args[1] = b;
+  e->args[2] = c;
+  e->args[3] = d;
+  e->args[4] = f;
+  e->args[5] = g;
+  e->result = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,14 +1,37 @@
 #pragma once
 
-
+#include <sys/types.h>
 
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+
+// The kernel supports at most 64 cores, so a cpu set is a single word
+#define CPU_SETSIZE 64
+
+typedef struct {
+  unsigned long __bits[CPU_SETSIZE / (8 * sizeof(unsigned long))];
+} cpu_set_t;
+
+#define __CPU_WORD(cpu) ((cpu) / (8 * sizeof(unsigned long)))
+#define __CPU_BIT(cpu) (1UL << ((cpu) % (8 * sizeof(unsigned long))))
+
+#define CPU_ZERO(set) __builtin_memset((set), 0, sizeof(cpu_set_t))
+#define CPU_SET(cpu, set) ((set)->__bits[__CPU_WORD(cpu)] |= __CPU_BIT(cpu))
+#define CPU_CLR(cpu, set) ((set)->__bits[__CPU_WORD(cpu)] &= ~__CPU_BIT(cpu))
+#define CPU_ISSET(cpu, set) (((set)->__bits[__CPU_WORD(cpu)] & __CPU_BIT(cpu)) != 0)
+#define CPU_COUNT(set) __builtin_popcountl((set)->__bits[0])
+
 int sched_yield(void);
 
+// pid is a thread id. 0 refers to the calling thread
+int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t *mask);
+int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask);
+// the core the calling thread is running on (may be stale as soon as it returns)
+int sched_getcpu(void);
+
 
 #ifdef __cplusplus
 }
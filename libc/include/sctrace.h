@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef _SCTRACE_H
+#define _SCTRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <chariot/sctrace.h>
+
+// see <chariot/sctrace.h>. These return -1 and set errno on failure
+int sctrace(int pid, int flags);
+int sctrace_stats(int pid, struct sctrace_stat *stats, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#ifndef _SYS_SENDFILE_H
+#define _SYS_SENDFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __NEED_size_t
+#define __NEED_ssize_t
+#define __NEED_off_t
+#include <bits/alltypes.h>
+
+// copy `count` bytes from `in_fd` to `out_fd` without a trip through user
+// memory. If `offset` isn't NULL, in_fd is read from there (and *offset is
+// advanced) and its file offset isn't touched
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
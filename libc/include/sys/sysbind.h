@@ -13,10 +13,22 @@
 #include <sys/sysinfo.h>
 #include <sys/netdb.h>
 #include <chariot/cpu_usage.h>
+#include <chariot/schedstat.h>
+#include <chariot/ioring.h>
+#include <chariot/awaitset.h>
+#include <sys/uio.h>
+#include <chariot/sctrace.h>
+#include <chariot/multicall.h>
 #else
 #include <types.h>
 #include <mountopts.h>
 #include <cpu_usage.h>
+#include <schedstat.h>
+#include <ioring.h>
+#include <awaitset.h>
+#include <uio.h>
+#include <sctrace.h>
+#include <multicall.h>
 #endif
 
 #ifdef __cplusplus
@@ -81,7 +93,7 @@ int sysbind_sigprocmask(int how, unsigned long set, unsigned long* old_set);
 int sysbind_kill(int pid, int sig);
 int sysbind_awaitfs(struct await_target * fds, int nfds, int flags, long long timeout_time);
 unsigned long sysbind_kshell();
-int sysbind_futex(int* uaddr, int op, int val, int val2, int* uaddr2, int val3);
+int sysbind_futex(int* uaddr, int op, int val, unsigned long val2, int* uaddr2, int val3);
 int sysbind_sysinfo(struct sysinfo * info);
 int sysbind_dnslookup(const char * name, unsigned int* ip4);
 int sysbind_shutdown();
@@ -91,6 +103,25 @@ unsigned long sysbind_getramusage();
 int sysbind_get_core_usage(unsigned int core, struct chariot_core_usage * usage);
 int sysbind_get_nproc();
 int sysbind_kctl(off_t* name, unsigned namelen, char * oval, size_t* olen, char * nval, size_t nlen);
+int sysbind_sched_setaffinity(int tid, size_t size, unsigned long * mask);
+int sysbind_sched_getaffinity(int tid, size_t size, unsigned long * mask);
+int sysbind_get_sched_stats(int tid, struct chariot_sched_stats * stats);
+int sysbind_getcpu();
+int sysbind_ioring_setup(unsigned entries, struct ioring_params * params);
+int sysbind_ioring_enter(int fd, unsigned to_submit, unsigned min_complete, int flags);
+int sysbind_awaitset_create(int flags);
+int sysbind_awaitset_ctl(int set, int op, int fd, struct awaitset_event * ev);
+int sysbind_awaitset_wait(int set, struct awaitset_event * events, int max, long long timeout_time);
+ssize_t sysbind_readv(int fd, const struct iovec * iov, int iovcnt);
+ssize_t sysbind_writev(int fd, const struct iovec * iov, int iovcnt);
+ssize_t sysbind_preadv(int fd, const struct iovec * iov, int iovcnt, long off);
+ssize_t sysbind_pwritev(int fd, const struct iovec * iov, int iovcnt, long off);
+ssize_t sysbind_sendfile(int out_fd, int in_fd, long * off, size_t count);
+ssize_t sysbind_splice(int fd_in, long * off_in, int fd_out, long * off_out, size_t len, unsigned flags);
+int sysbind_sctrace(int pid, int flags);
+int sysbind_sctrace_stats(int pid, struct sctrace_stat * stats, int count);
+int sysbind_multicall(struct multicall_entry * calls, int count, int flags);
+ssize_t sysbind_getdents(int fd, struct dirent64 * buf, size_t len);
 #ifdef __cplusplus
 }
 namespace sys {
@@ -152,7 +183,7 @@ namespace sys {
    inline int kill(int pid, int sig) { return sysbind_kill(pid, sig); }
    inline int awaitfs(struct await_target * fds, int nfds, int flags, long long timeout_time) { return sysbind_awaitfs(fds, nfds, flags, timeout_time); }
    inline unsigned long kshell() { return sysbind_kshell(); }
-   inline int futex(int* uaddr, int op, int val, int val2, int* uaddr2, int val3) { return sysbind_futex(uaddr, op, val, val2, uaddr2, val3); }
+   inline int futex(int* uaddr, int op, int val, unsigned long val2, int* uaddr2, int val3) { return sysbind_futex(uaddr, op, val, val2, uaddr2, val3); }
    inline int sysinfo(struct sysinfo * info) { return sysbind_sysinfo(info); }
    inline int dnslookup(const char * name, unsigned int* ip4) { return sysbind_dnslookup(name, ip4); }
    inline int shutdown() { return sysbind_shutdown(); }
@@ -162,5 +193,24 @@ namespace sys {
    inline int get_core_usage(unsigned int core, struct chariot_core_usage * usage) { return sysbind_get_core_usage(core, usage); }
    inline int get_nproc() { return sysbind_get_nproc(); }
    inline int kctl(off_t* name, unsigned namelen, char * oval, size_t* olen, char * nval, size_t nlen) { return sysbind_kctl(name, namelen, oval, olen, nval, nlen); }
+   inline int sched_setaffinity(int tid, size_t size, unsigned long * mask) { return sysbind_sched_setaffinity(tid, size, mask); }
+   inline int sched_getaffinity(int tid, size_t size, unsigned long * mask) { return sysbind_sched_getaffinity(tid, size, mask); }
+   inline int get_sched_stats(int tid, struct chariot_sched_stats * stats) { return sysbind_get_sched_stats(tid, stats); }
+   inline int getcpu() { return sysbind_getcpu(); }
+   inline int ioring_setup(unsigned entries, struct ioring_params * params) { return sysbind_ioring_setup(entries, params); }
+   inline int ioring_enter(int fd, unsigned to_submit, unsigned min_complete, int flags) { return sysbind_ioring_enter(fd, to_submit, min_complete, flags); }
+   inline int awaitset_create(int flags) { return sysbind_awaitset_create(flags); }
+   inline int awaitset_ctl(int set, int op, int fd, struct awaitset_event * ev) { return sysbind_awaitset_ctl(set, op, fd, ev); }
+   inline int awaitset_wait(int set, struct awaitset_event * events, int max, long long timeout_time) { return sysbind_awaitset_wait(set, events, max, timeout_time); }
+   inline ssize_t readv(int fd, const struct iovec * iov, int iovcnt) { return sysbind_readv(fd, iov, iovcnt); }
+   inline ssize_t writev(int fd, const struct iovec * iov, int iovcnt) { return sysbind_writev(fd, iov, iovcnt); }
+   inline ssize_t preadv(int fd, const struct iovec * iov, int iovcnt, long off) { return sysbind_preadv(fd, iov, iovcnt, off); }
+   inline ssize_t pwritev(int fd, const struct iovec * iov, int iovcnt, long off) { return sysbind_pwritev(fd, iov, iovcnt, off); }
+   inline ssize_t sendfile(int out_fd, int in_fd, long * off, size_t count) { return sysbind_sendfile(out_fd, in_fd, off, count); }
+   inline ssize_t splice(int fd_in, long * off_in, int fd_out, long * off_out, size_t len, unsigned flags) { return sysbind_splice(fd_in, off_in, fd_out, off_out, len, flags); }
+   inline int sctrace(int pid, int flags) { return sysbind_sctrace(pid, flags); }
+   inline int sctrace_stats(int pid, struct sctrace_stat * stats, int count) { return sysbind_sctrace_stats(pid, stats, count); }
+   inline int multicall(struct multicall_entry * calls, int count, int flags) { return sysbind_multicall(calls, count, flags); }
+   inline ssize_t getdents(int fd, struct dirent64 * buf, size_t len) { return sysbind_getdents(fd, buf, len); }
 } // namespace sys
 #endif
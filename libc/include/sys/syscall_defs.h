@@ -66,3 +66,22 @@
 #define SYS_get_core_usage           (0x41)
 #define SYS_get_nproc                (0x42)
 #define SYS_kctl                     (0x43)
+#define SYS_sched_setaffinity        (0x44)
+#define SYS_sched_getaffinity        (0x45)
+#define SYS_get_sched_stats          (0x46)
+#define SYS_getcpu                   (0x47)
+#define SYS_ioring_setup             (0x48)
+#define SYS_ioring_enter             (0x49)
+#define SYS_awaitset_create          (0x4a)
+#define SYS_awaitset_ctl             (0x4b)
+#define SYS_awaitset_wait            (0x4c)
+#define SYS_readv                    (0x4d)
+#define SYS_writev                   (0x4e)
+#define SYS_preadv                   (0x4f)
+#define SYS_pwritev                  (0x50)
+#define SYS_sendfile                 (0x51)
+#define SYS_splice                   (0x52)
+#define SYS_sctrace                  (0x53)
+#define SYS_sctrace_stats            (0x54)
+#define SYS_multicall                (0x55)
+#define SYS_getdents                 (0x56)
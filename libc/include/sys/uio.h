@@ -0,0 +1,30 @@
+#pragma once
+
+#ifndef _SYS_UIO_H
+#define _SYS_UIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define __NEED_size_t
+#define __NEED_ssize_t
+#define __NEED_off_t
+#define __NEED_struct_iovec
+#include <bits/alltypes.h>
+
+#include <chariot/uio.h>
+// IOV_MAX (the same as UIO_MAXIOV)
+#include <limits.h>
+
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt);
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt);
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,14 @@
+#include <awaitset.h>
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+
+
+int awaitset_create(int flags) { return errno_wrap(sysbind_awaitset_create(flags)); }
+
+int awaitset_ctl(int set, int op, int fd, struct awaitset_event *ev) {
+  return errno_wrap(sysbind_awaitset_ctl(set, op, fd, ev));
+}
+
+int awaitset_wait(int set, struct awaitset_event *events, int max, long long timeout_time) {
+  return errno_wrap(sysbind_awaitset_wait(set, events, max, timeout_time));
+}
@@ -3,22 +3,28 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/sysbind.h>
 #include <unistd.h>
 
+// how much of the directory is read at once
+#define DIRBUF_SIZE 4096
+
 struct __dirstream {
   int fd;
+  // the unread entries are buf[pos..end)
   int pos;
-  int nents;
+  int end;
   // volatile int lock[1];
-  struct dirent *ents;
+  struct dirent ent;
+  long buf[DIRBUF_SIZE / sizeof(long)];
 };
 
 static DIR *populate_dir(DIR *dir) {
-  dir->ents = NULL;
   dir->pos = 0;
+  dir->end = 0;
 
   struct stat st;
 
@@ -32,19 +38,6 @@ static DIR *populate_dir(DIR *dir) {
     return 0;
   }
 
-  dir->nents = errno_wrap(sysbind_dirent(dir->fd, NULL, 0, 0));
-  if (dir->nents == -1) {
-    free(dir);
-    return NULL;
-  }
-
-  dir->ents = calloc(dir->nents, sizeof(struct dirent));
-  int n = errno_wrap(sysbind_dirent(dir->fd, dir->ents, 0, dir->nents));
-
-  if (n != dir->nents) {
-    printf("populate_dir: hmm\n");
-  }
-
   return dir;
 }
 
@@ -72,11 +65,27 @@ DIR *fdopendir(int fd) {
   return populate_dir(dir);
 }
 
-struct dirent *readdir(DIR *d) {
-  if (d->pos == d->nents) return NULL;
+ssize_t getdents(int fd, struct dirent64 *buf, size_t len) {
+  return errno_wrap(sysbind_getdents(fd, buf, len));
+}
 
+struct dirent *readdir(DIR *d) {
   // TODO: lock
-  return &d->ents[d->pos++];
+  if (d->pos == d->end) {
+    ssize_t n = getdents(d->fd, (struct dirent64 *)d->buf, sizeof(d->buf));
+    if (n <= 0) return NULL;
+    d->pos = 0;
+    d->end = n;
+  }
+
+  struct dirent64 *de = (struct dirent64 *)((char *)d->buf + d->pos);
+  d->pos += de->d_reclen;
+
+  d->ent.d_ino = de->d_ino;
+  d->ent.d_type = de->d_type;
+  strncpy(d->ent.d_name, de->d_name, sizeof(d->ent.d_name) - 1);
+  d->ent.d_name[sizeof(d->ent.d_name) - 1] = '\0';
+  return &d->ent;
 }
 
 int closedir(DIR *dir) {
@@ -86,7 +95,9 @@ int closedir(DIR *dir) {
 }
 
 void rewinddir(DIR *d) {
+  lseek(d->fd, 0, SEEK_SET);
   d->pos = 0;
+  d->end = 0;
 }
 
 int dirfd(DIR *d) {
@@ -0,0 +1,88 @@
+#include <errno.h>
+#include <ioring.h>
+#include <sys/mman.h>
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+int ioring_init(struct ioring *ring, unsigned entries) {
+  struct ioring_params params;
+  memset(ring, 0, sizeof(*ring));
+
+  int fd = errno_wrap(sysbind_ioring_setup(entries, &params));
+  if (fd < 0) return -1;
+
+  void *mem = mmap(NULL, params.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (mem == MAP_FAILED) {
+    close(fd);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  ring->fd = fd;
+  ring->mem = mem;
+  ring->size = params.ring_size;
+  ring->hdr = mem;
+  ring->sqes = (struct ioring_sqe *)((char *)mem + ring->hdr->sqes_off);
+  ring->cqes = (struct ioring_cqe *)((char *)mem + ring->hdr->cqes_off);
+  ring->sq_tail = ring->hdr->sq.tail;
+  return 0;
+}
+
+
+void ioring_exit(struct ioring *ring) {
+  munmap(ring->mem, ring->size);
+  close(ring->fd);
+  ring->fd = -1;
+}
+
+
+struct ioring_sqe *ioring_get_sqe(struct ioring *ring) {
+  struct ioring_queue *sq = &ring->hdr->sq;
+  if (ring->sq_tail - __atomic_load_n(&sq->head, __ATOMIC_ACQUIRE) >= sq->entries) return NULL;
+  return &ring->sqes[ring->sq_tail++ & sq->mask];
+}
+
+
+unsigned ioring_sq_pending(struct ioring *ring) {
+  return ring->sq_tail - __atomic_load_n(&ring->hdr->sq.head, __ATOMIC_ACQUIRE);
+}
+
+
+int ioring_submit_and_wait(struct ioring *ring, unsigned wait_nr) {
+  // publish the new SQEs before the kernel looks at them
+  __atomic_store_n(&ring->hdr->sq.tail, ring->sq_tail, __ATOMIC_RELEASE);
+  return errno_wrap(sysbind_ioring_enter(ring->fd, ioring_sq_pending(ring), wait_nr, 0));
+}
+
+
+int ioring_submit(struct ioring *ring) { return ioring_submit_and_wait(ring, 0); }
+
+
+struct ioring_cqe *ioring_peek_cqe(struct ioring *ring) {
+  struct ioring_queue *cq = &ring->hdr->cq;
+  unsigned head = cq->head;
+  if (head == __atomic_load_n(&cq->tail, __ATOMIC_ACQUIRE)) return NULL;
+  return &ring->cqes[head & cq->mask];
+}
+
+
+int ioring_wait_cqe(struct ioring *ring, struct ioring_cqe **cqe) {
+  if ((*cqe = ioring_peek_cqe(ring)) != NULL) return 0;
+  if (ioring_submit_and_wait(ring, 1) < 0) return -1;
+
+  // the kernel only comes back empty handed if nothing was in flight
+  if ((*cqe = ioring_peek_cqe(ring)) == NULL) {
+    errno = EAGAIN;
+    return -1;
+  }
+  return 0;
+}
+
+
+void ioring_cqe_seen(struct ioring *ring) {
+  struct ioring_queue *cq = &ring->hdr->cq;
+  // the kernel may reuse the slot as soon as it sees the new head
+  __atomic_store_n(&cq->head, cq->head + 1, __ATOMIC_RELEASE);
+}
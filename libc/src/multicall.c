@@ -0,0 +1,8 @@
+#include <multicall.h>
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+
+
+int multicall(struct multicall_entry *calls, int count, int flags) {
+  return errno_wrap(sysbind_multicall(calls, count, flags));
+}
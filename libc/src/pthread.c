@@ -8,7 +8,11 @@
 #include <string.h>
 #include <sys/syscall.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
 #include <chariot/futex.h>
+#include <chariot/tls.h>
+#include <limits.h>
+#include <unistd.h>
 
 
 
@@ -52,7 +56,66 @@ struct __pthread {
 };
 
 
+/*
+ * libc's view of the thread control block the kernel maps for every thread
+ * (see <chariot/tls.h>). pthread_self() and thread specific data hang off of
+ * it, so they cost a load off of the thread pointer instead of a lookup.
+ */
+struct __tcb {
+  struct chariot_tcb hdr;
+  // NULL until the thread (or the main thread) first needs one
+  struct __pthread *thread;
+  void *specific[PTHREAD_KEYS_MAX];
+};
+
+_Static_assert(sizeof(struct __tcb) <= CHARIOT_TCB_SIZE, "struct __tcb must fit in the kernel's TCB");
+
+
+static inline struct __tcb *__get_tcb(void) {
+#ifdef __x86_64__
+  struct __tcb *tcb;
+  __asm__("mov %%fs:0, %0" : "=r"(tcb));
+  return tcb;
+#else
+  char *tp;
+  __asm__("mv %0, tp" : "=r"(tp));
+  return (struct __tcb *)(tp - CHARIOT_TCB_SIZE);
+#endif
+}
+
+
+// the main thread isn't created by pthread_create, so it gets this one
+static struct __pthread main_thread;
+
+
+pthread_t pthread_self(void) {
+  struct __tcb *tcb = __get_tcb();
+  if (tcb->thread == NULL) {
+    main_thread.tid = gettid();
+    tcb->thread = &main_thread;
+  }
+  return tcb->thread;
+}
+
+
+// the calling thread's tid, without a system call
+int __pthread_gettid(void) { return pthread_self()->tid; }
+
+
+// called in the child of fork(), whose only thread is whichever one forked
+void __pthread_fork_child(void) {
+  main_thread.tid = gettid();
+  __get_tcb()->thread = &main_thread;
+}
+
+
+static void run_key_destructors(void);
+extern void __malloc_thread_exit(void);
+
 static int __pthread_died(struct __pthread *data) {
+  run_key_destructors();
+  // hand this thread's cached memory back before its TLS goes away
+  __malloc_thread_exit();
   // we are done!
   // pthread_mutex_unlock(&data->runlock);
   while (1) {
@@ -64,6 +127,9 @@ static int __pthread_died(struct __pthread *data) {
 
 static int __pthread_trampoline(void *arg) {
   struct __pthread *data = arg;
+  // the creator fills this in too, but we may well run before it does
+  data->tid = gettid();
+  __get_tcb()->thread = data;
 
 
   // wait till the thread can actually run (sync with the creator)
@@ -77,33 +143,51 @@ static int __pthread_trampoline(void *arg) {
   return 0;
 }
 
-pthread_t pthread_self(void) { return 0; }
 
-// #define MMAP_PTHREAD_STACK
-// #define PTHREAD_STACK_SIZE (1 * 1024L * 1024L)
-#define PTHREAD_STACK_SIZE (4 * 4096L)
+void pthread_exit(void *res) {
+  struct __pthread *self = pthread_self();
+  self->res = res;
+  __pthread_died(self);
+  __builtin_unreachable();
+}
 
+/*
+ * Thread stacks are anonymous mappings, so the kernel only faults in the
+ * pages a thread actually touches and they start out zeroed. Joined threads'
+ * stacks go back in a small pool for the next pthread_create, rather than
+ * being unmapped, so short lived threads don't pay for the mmap or the faults.
+ */
+#define PTHREAD_STACK_SIZE (256 * 1024L)
+#define PTHREAD_STACK_POOL 16
 
-// a buffer of pthread stacks that are of size PTHREAD_STACK_SIZE
-static void *pthread_stacks[64] = {0};
+static void *pthread_stacks[PTHREAD_STACK_POOL] = {0};
+static int pthread_stacks_count = 0;
 static pthread_mutex_t pthread_stacks_lock = PTHREAD_MUTEX_INITIALIZER;
 
 
 
 static void *get_stack(void) {
-#ifdef MMAP_PTHREAD_STACK
-  return mmap(NULL, PTHREAD_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
-#else
-  return malloc(PTHREAD_STACK_SIZE);
-#endif
+  void *stk = NULL;
+  pthread_mutex_lock(&pthread_stacks_lock);
+  if (pthread_stacks_count > 0) stk = pthread_stacks[--pthread_stacks_count];
+  pthread_mutex_unlock(&pthread_stacks_lock);
+  if (stk != NULL) return stk;
+
+  stk = mmap(NULL, PTHREAD_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (stk == MAP_FAILED) return NULL;
+  mrename(stk, "[pthread stack]");
+  return stk;
 }
 
 static void release_stack(void *stk) {
-#ifdef MMAP_PTHREAD_STACK
-  munmap(stk, PTHREAD_STACK_SIZE);
-#else
-  free(stk);
-#endif
+  pthread_mutex_lock(&pthread_stacks_lock);
+  if (pthread_stacks_count < PTHREAD_STACK_POOL) {
+    pthread_stacks[pthread_stacks_count++] = stk;
+    stk = NULL;
+  }
+  pthread_mutex_unlock(&pthread_stacks_lock);
+
+  if (stk != NULL) munmap(stk, PTHREAD_STACK_SIZE);
 }
 
 
@@ -114,7 +198,10 @@ int pthread_create(pthread_t *thd, const pthread_attr_t *attr, void *(*fn)(void
   data->stack_size = PTHREAD_STACK_SIZE;
 
   data->stack = get_stack();
-  memset(data->stack, 0, PTHREAD_STACK_SIZE);
+  if (data->stack == NULL) {
+    free(data);
+    return EAGAIN;
+  }
 
   data->arg = arg;
   data->fn = fn;
@@ -129,7 +216,7 @@ int pthread_create(pthread_t *thd, const pthread_attr_t *attr, void *(*fn)(void
   int tid = sysbind_spawnthread(data->stack + data->stack_size, __pthread_trampoline, data, 0);
 
   if (tid < 0) {
-    free(data->stack);
+    release_stack(data->stack);
     free(data);
     return errno_wrap(tid);
   }
@@ -184,16 +271,49 @@ inline static int _futex(int *uaddr, int futex_op, int val, uint32_t timeout, in
 
 
 
-static void *threadDataTable[64];
-static int freeEntry = 0;
-int pthread_key_create(pthread_key_t *key, void (*a)(void *)) {
-  assert(freeEntry < 64);
+/*
+ * Keys are indexes into every thread's TCB. Deleted keys are not handed out
+ * again, as other threads may still have values stored under them.
+ */
+static void (*key_destructors[PTHREAD_KEYS_MAX])(void *);
+static int next_key = 0;
+
+int pthread_key_create(pthread_key_t *key, void (*destructor)(void *)) {
+  int k = __atomic_fetch_add(&next_key, 1, __ATOMIC_RELAXED);
+  if (k >= PTHREAD_KEYS_MAX) {
+    __atomic_store_n(&next_key, PTHREAD_KEYS_MAX, __ATOMIC_RELAXED);
+    return EAGAIN;
+  }
 
-  *key = freeEntry;
-  freeEntry++;
+  key_destructors[k] = destructor;
+  *key = k;
   return 0;
 }
 
+int pthread_key_delete(pthread_key_t key) {
+  if (key < 0 || key >= PTHREAD_KEYS_MAX) return EINVAL;
+  key_destructors[key] = NULL;
+  return 0;
+}
+
+
+static void run_key_destructors(void) {
+  struct __tcb *tcb = __get_tcb();
+  // a destructor may set values again, so go around a few times
+  for (int i = 0; i < PTHREAD_DESTRUCTOR_ITERATIONS; i++) {
+    int ran = 0;
+    for (int k = 0; k < PTHREAD_KEYS_MAX; k++) {
+      void *val = tcb->specific[k];
+      void (*destructor)(void *) = key_destructors[k];
+      if (val == NULL || destructor == NULL) continue;
+      tcb->specific[k] = NULL;
+      destructor(val);
+      ran = 1;
+    }
+    if (!ran) break;
+  }
+}
+
 int pthread_once(pthread_once_t *control, void (*init)(void)) {
   if (*control == 0) {
     (*init)();
@@ -202,25 +322,17 @@ int pthread_once(pthread_once_t *control, void (*init)(void)) {
   return 0;
 }
 
-void *pthread_getspecific(pthread_key_t key) { return threadDataTable[key]; }
+void *pthread_getspecific(pthread_key_t key) {
+  if (key < 0 || key >= PTHREAD_KEYS_MAX) return NULL;
+  return __get_tcb()->specific[key];
+}
 
 int pthread_setspecific(pthread_key_t key, const void *data) {
-  threadDataTable[key] = (void *)data;
+  if (key < 0 || key >= PTHREAD_KEYS_MAX) return EINVAL;
+  __get_tcb()->specific[key] = (void *)data;
   return 0;
 }
 
 
 
 
-int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) { return -1; }
-int pthread_cond_destroy(pthread_cond_t *cond) { return 0; }
-
-
-static int cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime) { return -1; }
-
-int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) { return 0; }
-
-
-int pthread_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *ts) { return -1; }
-int pthread_cond_broadcast(pthread_cond_t *c) { return -1; }
-int pthread_cond_signal(pthread_cond_t *c) { return -1; }
@@ -0,0 +1,94 @@
+#include <pthread.h>
+#include <atomic.h>
+#include <limits.h>
+#include <chariot/futex.h>
+#include <sys/sysbind.h>
+#include <stddef.h>
+#include <errno.h>
+
+
+/*
+ * A condvar is a sequence number that signal and broadcast bump, and waiters
+ * sleep on. A waiter reads the sequence before it drops the mutex, so a
+ * signal between the unlock and the futex wait makes the wait fail with
+ * EAGAIN instead of being lost.
+ *
+ * Broadcast wakes one waiter and requeues the rest onto the mutex's futex,
+ * so they are woken one at a time as the mutex is handed around instead of
+ * all fighting over it at once.
+ *
+ * The mutex's futex ops are never FUTEX_PRIVATE_FLAG, as it may live in
+ * MAP_SHARED memory, and a requeue uses the same kind of key for both words.
+ * So the condvar uses shared futex ops too: otherwise requeued waiters would
+ * sit under a key that pthread_mutex_unlock() never wakes.
+ */
+#define c_seq __u.__i[0]
+#define c_waiters __u.__i[1]
+#define c_mutex __u.__p[1]
+
+
+// implemented in pthread_mutex.c
+extern int __pthread_mutex_lock_requeued(pthread_mutex_t *m);
+
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr) {
+  cond->c_seq = 0;
+  cond->c_waiters = 0;
+  cond->c_mutex = NULL;
+  return 0;
+}
+
+
+int pthread_cond_destroy(pthread_cond_t *cond) { return 0; }
+
+
+static int cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime) {
+  int seq = atomic_load_relaxed(&cond->c_seq);
+  atomic_fetch_add_relaxed(&cond->c_waiters, 1);
+  atomic_store_relaxed(&cond->c_mutex, (void *)mutex);
+
+  pthread_mutex_unlock(mutex);
+  int r = sysbind_futex(&cond->c_seq, FUTEX_WAIT_BITSET, seq, (unsigned long)abstime, NULL,
+      FUTEX_BITSET_MATCH_ANY);
+
+  __atomic_fetch_sub(&cond->c_waiters, 1, __ATOMIC_RELAXED);
+  // we may have been requeued onto the mutex, so lock it like we were
+  __pthread_mutex_lock_requeued(mutex);
+
+  if (r == -ETIMEDOUT) return ETIMEDOUT;
+  return 0;
+}
+
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) { return cond_wait(cond, mutex, NULL); }
+
+
+int pthread_cond_timedwait(pthread_cond_t *c, pthread_mutex_t *m, const struct timespec *ts) {
+  if (ts == NULL || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L) return EINVAL;
+  return cond_wait(c, m, ts);
+}
+
+
+int pthread_cond_signal(pthread_cond_t *c) {
+  __atomic_fetch_add(&c->c_seq, 1, __ATOMIC_SEQ_CST);
+  if (atomic_load_relaxed(&c->c_waiters) == 0) return 0;
+  sysbind_futex(&c->c_seq, FUTEX_WAKE, 1, 0, NULL, 0);
+  return 0;
+}
+
+
+int pthread_cond_broadcast(pthread_cond_t *c) {
+  int seq = __atomic_add_fetch(&c->c_seq, 1, __ATOMIC_SEQ_CST);
+  if (atomic_load_relaxed(&c->c_waiters) == 0) return 0;
+
+  pthread_mutex_t *m = (pthread_mutex_t *)atomic_load_relaxed(&c->c_mutex);
+  // PI mutexes are owned by tid, and can't take requeued waiters
+  if (m != NULL && m->protocol != PTHREAD_PRIO_INHERIT) {
+    int r = sysbind_futex(&c->c_seq, FUTEX_CMP_REQUEUE, 1, INT_MAX, &m->word, seq);
+    // the sequence moved under us (another signal), so just wake everyone
+    if (r >= 0) return 0;
+  }
+
+  sysbind_futex(&c->c_seq, FUTEX_WAKE, INT_MAX, 0, NULL, 0);
+  return 0;
+}
@@ -3,15 +3,23 @@
 #include <limits.h>
 #include <chariot/futex.h>
 #include <sys/sysbind.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdint.h>
 #include <errno.h>
+#include <unistd.h>
 
 
 #define unlikely(c) __builtin_expect((c), 0)
 
+extern int __pthread_gettid(void);
+
 static int futex_wait(int *ptr, int value) { return sysbind_futex(ptr, FUTEX_WAIT, value, 0, 0, 0); }
 static int futex_wake(int *ptr, int value) { return sysbind_futex(ptr, FUTEX_WAKE, value, 0, 0, 0); }
+// wait until an absolute time (on the clock_gettime clock)
+static int futex_wait_until(int *ptr, int value, const struct timespec *abstime) {
+  return sysbind_futex(ptr, FUTEX_WAIT_BITSET, value, (unsigned long)abstime, 0, FUTEX_BITSET_MATCH_ANY);
+}
 
 
 static inline uint32_t cmpxchg32(void *m, uint32_t old, uint32_t newval) {
@@ -20,7 +28,27 @@ static inline uint32_t cmpxchg32(void *m, uint32_t old, uint32_t newval) {
 
 
 
+/*
+ * PTHREAD_PRIO_INHERIT mutexes hold the owner's tid, so the kernel knows who
+ * to boost while we wait. Uncontended locks and unlocks never enter the kernel.
+ */
+static int pi_lock(pthread_mutex_t *m, const struct timespec *abstime) {
+  if (cmpxchg32(&m->word, 0, __pthread_gettid())) return 0;
+  int r = sysbind_futex(&m->word, FUTEX_LOCK_PI, 0, (unsigned long)abstime, 0, 0);
+  return r < 0 ? -r : 0;
+}
+
+static int pi_unlock(pthread_mutex_t *m) {
+  // FUTEX_WAITERS is set if somebody is waiting in the kernel
+  if (cmpxchg32(&m->word, __pthread_gettid(), 0)) return 0;
+  int r = sysbind_futex(&m->word, FUTEX_UNLOCK_PI, 0, 0, 0, 0);
+  return r < 0 ? -r : 0;
+}
+
+
+
 int pthread_mutex_lock(pthread_mutex_t *m) {
+  if (m->protocol == PTHREAD_PRIO_INHERIT) return pi_lock(m, NULL);
   // try to atimically swap 0 -> 1
   if (cmpxchg32(&m->word, 0, 1)) return 0;  // success
   // wasn't zero -- somebody held the lock
@@ -37,13 +65,41 @@ int pthread_mutex_lock(pthread_mutex_t *m) {
 }
 
 
+int pthread_mutex_timedlock(pthread_mutex_t *m, const struct timespec *abstime) {
+  if (m->protocol == PTHREAD_PRIO_INHERIT) return pi_lock(m, abstime);
+  if (cmpxchg32(&m->word, 0, 1)) return 0;
+  do {
+    if (m->word == 2 || cmpxchg32(&m->word, 1, 2)) {
+      if (futex_wait_until(&m->word, 2, abstime) == -ETIMEDOUT) return ETIMEDOUT;
+    }
+  } while (!cmpxchg32(&m->word, 0, 2));
+  return 0;
+}
+
+
+/*
+ * Lock a mutex after being moved onto it by a condvar broadcast (see
+ * pthread_cond.c). The word is always left at 2, as other waiters may have
+ * been requeued behind us and only an unlock from 2 wakes them.
+ */
+int __pthread_mutex_lock_requeued(pthread_mutex_t *m) {
+  if (m->protocol == PTHREAD_PRIO_INHERIT) return pi_lock(m, NULL);
+  while (__atomic_exchange_n(&m->word, 2, __ATOMIC_ACQUIRE) != 0) {
+    futex_wait(&m->word, 2);
+  }
+  return 0;
+}
+
+
 int pthread_mutex_trylock(pthread_mutex_t *m) {
+  if (m->protocol == PTHREAD_PRIO_INHERIT) return cmpxchg32(&m->word, 0, __pthread_gettid()) ? 0 : EBUSY;
   // try to atimically swap 0 -> 1
   if (cmpxchg32(&m->word, 0, 1)) return 0;  // success
-  return -EBUSY;
+  return EBUSY;
 }
 
 int pthread_mutex_unlock(pthread_mutex_t *m) {
+  if (m->protocol == PTHREAD_PRIO_INHERIT) return pi_unlock(m);
   int res = __atomic_fetch_sub(&m->word, 1, __ATOMIC_SEQ_CST);
   // we own the lock, so it's either 1 or 2
   if (res != 1) {
@@ -59,7 +115,29 @@ int pthread_mutex_unlock(pthread_mutex_t *m) {
 
 int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
   memset(mutex, 0, sizeof(*mutex));
+  if (attr != NULL) mutex->protocol = *attr;
   return 0;
 }
 
 int pthread_mutex_destroy(pthread_mutex_t *mutex) { return 0; }
+
+
+// the only attribute is the protocol, so that is all the attr holds
+int pthread_mutexattr_init(pthread_mutexattr_t *attr) {
+  *attr = PTHREAD_PRIO_NONE;
+  return 0;
+}
+
+int pthread_mutexattr_destroy(pthread_mutexattr_t *attr) { return 0; }
+
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol) {
+  // there is no support for priority ceilings
+  if (protocol != PTHREAD_PRIO_NONE && protocol != PTHREAD_PRIO_INHERIT) return ENOTSUP;
+  *attr = protocol;
+  return 0;
+}
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol) {
+  *protocol = *attr;
+  return 0;
+}
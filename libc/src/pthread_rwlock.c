@@ -0,0 +1,140 @@
+#include <pthread.h>
+#include <atomic.h>
+#include <limits.h>
+#include <chariot/futex.h>
+#include <sys/sysbind.h>
+#include <stddef.h>
+#include <errno.h>
+
+
+/*
+ * rw_lock is the number of readers holding the lock, or -1 if a writer does.
+ * Readers and writers sleep on their own sequence numbers, which unlock bumps
+ * before it wakes them.
+ *
+ * Writers are preferred: once a writer is waiting, new readers queue up
+ * behind it instead of taking the lock, so a steady stream of readers can't
+ * starve writers out.
+ */
+#define rw_lock __u.__i[0]
+#define rw_writers_waiting __u.__i[1]
+#define rw_readers_waiting __u.__i[2]
+#define rw_rseq __u.__i[3]
+#define rw_wseq __u.__i[4]
+
+#define RW_WRLOCKED (-1)
+
+
+static int futex_wait_until(int *ptr, int value, const struct timespec *abstime) {
+  return sysbind_futex(ptr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG, value, (unsigned long)abstime, NULL,
+      FUTEX_BITSET_MATCH_ANY);
+}
+
+static void futex_wake_seq(int *seq, int count) {
+  __atomic_fetch_add(seq, 1, __ATOMIC_SEQ_CST);
+  sysbind_futex(seq, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, count, 0, NULL, 0);
+}
+
+
+int pthread_rwlock_init(pthread_rwlock_t *rw, const pthread_rwlockattr_t *attr) {
+  for (int i = 0; i < 8; i++)
+    rw->__u.__i[i] = 0;
+  return 0;
+}
+
+int pthread_rwlock_destroy(pthread_rwlock_t *rw) { return 0; }
+
+
+// can a reader take the lock right now?
+static int can_read(pthread_rwlock_t *rw, int state) {
+  return state >= 0 && atomic_load_relaxed(&rw->rw_writers_waiting) == 0;
+}
+
+
+int pthread_rwlock_tryrdlock(pthread_rwlock_t *rw) {
+  int state = atomic_load_relaxed(&rw->rw_lock);
+  while (can_read(rw, state)) {
+    if (state == INT_MAX) return EAGAIN;
+    if (atomic_compare_exchange_weak_acquire(&rw->rw_lock, &state, state + 1)) return 0;
+  }
+  return EBUSY;
+}
+
+
+static int rdlock(pthread_rwlock_t *rw, const struct timespec *abstime) {
+  while (1) {
+    int r = pthread_rwlock_tryrdlock(rw);
+    if (r != EBUSY) return r;
+
+    // read the sequence before checking again, so an unlock in between makes the wait fail
+    int seq = atomic_load_acquire(&rw->rw_rseq);
+    __atomic_fetch_add(&rw->rw_readers_waiting, 1, __ATOMIC_SEQ_CST);
+    if (!can_read(rw, atomic_load_relaxed(&rw->rw_lock))) {
+      r = futex_wait_until(&rw->rw_rseq, seq, abstime);
+    }
+    __atomic_fetch_sub(&rw->rw_readers_waiting, 1, __ATOMIC_RELAXED);
+
+    if (r == -ETIMEDOUT) return ETIMEDOUT;
+  }
+}
+
+
+int pthread_rwlock_rdlock(pthread_rwlock_t *rw) { return rdlock(rw, NULL); }
+
+int pthread_rwlock_timedrdlock(pthread_rwlock_t *rw, const struct timespec *abstime) { return rdlock(rw, abstime); }
+
+
+int pthread_rwlock_trywrlock(pthread_rwlock_t *rw) {
+  int state = 0;
+  if (__atomic_compare_exchange_n(&rw->rw_lock, &state, RW_WRLOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return 0;
+  return EBUSY;
+}
+
+
+static int wrlock(pthread_rwlock_t *rw, const struct timespec *abstime) {
+  if (pthread_rwlock_trywrlock(rw) == 0) return 0;
+
+  // from here on, new readers wait for us
+  __atomic_fetch_add(&rw->rw_writers_waiting, 1, __ATOMIC_SEQ_CST);
+  while (1) {
+    if (pthread_rwlock_trywrlock(rw) == 0) break;
+
+    int seq = atomic_load_acquire(&rw->rw_wseq);
+    if (atomic_load_relaxed(&rw->rw_lock) == 0) continue;
+
+    if (futex_wait_until(&rw->rw_wseq, seq, abstime) == -ETIMEDOUT) {
+      // readers that queued up behind us may be able to go now
+      if (__atomic_sub_fetch(&rw->rw_writers_waiting, 1, __ATOMIC_SEQ_CST) == 0 &&
+          atomic_load_relaxed(&rw->rw_readers_waiting) != 0) {
+        futex_wake_seq(&rw->rw_rseq, INT_MAX);
+      }
+      return ETIMEDOUT;
+    }
+  }
+  __atomic_fetch_sub(&rw->rw_writers_waiting, 1, __ATOMIC_SEQ_CST);
+  return 0;
+}
+
+
+int pthread_rwlock_wrlock(pthread_rwlock_t *rw) { return wrlock(rw, NULL); }
+
+int pthread_rwlock_timedwrlock(pthread_rwlock_t *rw, const struct timespec *abstime) { return wrlock(rw, abstime); }
+
+
+int pthread_rwlock_unlock(pthread_rwlock_t *rw) {
+  if (atomic_load_relaxed(&rw->rw_lock) == RW_WRLOCKED) {
+    atomic_store_release(&rw->rw_lock, 0);
+  } else if (__atomic_sub_fetch(&rw->rw_lock, 1, __ATOMIC_RELEASE) != 0) {
+    // other readers still hold it
+    return 0;
+  }
+
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  // the lock is free. Hand it to a writer if there is one, otherwise let every reader in
+  if (atomic_load_relaxed(&rw->rw_writers_waiting) != 0) {
+    futex_wake_seq(&rw->rw_wseq, 1);
+  } else if (atomic_load_relaxed(&rw->rw_readers_waiting) != 0) {
+    futex_wake_seq(&rw->rw_rseq, INT_MAX);
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+#include <pthread.h>
+#include <atomic.h>
+#include <errno.h>
+
+
+static inline void cpu_relax(void) {
+#ifdef __x86_64__
+  __asm__ volatile("pause");
+#endif
+}
+
+
+int pthread_spin_init(pthread_spinlock_t *lock, int pshared) {
+  *lock = 0;
+  return 0;
+}
+
+int pthread_spin_destroy(pthread_spinlock_t *lock) { return 0; }
+
+
+int pthread_spin_lock(pthread_spinlock_t *lock) {
+  while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0) {
+    // wait for it to look free before trying again, so we don't bounce the line around
+    while (atomic_load_relaxed(lock) != 0)
+      cpu_relax();
+  }
+  return 0;
+}
+
+
+int pthread_spin_trylock(pthread_spinlock_t *lock) {
+  if (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0) return EBUSY;
+  return 0;
+}
+
+
+int pthread_spin_unlock(pthread_spinlock_t *lock) {
+  atomic_store_release(lock, 0);
+  return 0;
+}
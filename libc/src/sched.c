@@ -1,4 +1,5 @@
 #include <sched.h>
+#include <sys/syscall.h>
 #include <sys/sysbind.h>
 
 
@@ -7,3 +8,14 @@ int sched_yield(void) {
 
   return 0;
 }
+
+
+int sched_setaffinity(pid_t pid, size_t cpusetsize, const cpu_set_t *mask) {
+  return errno_wrap(sysbind_sched_setaffinity(pid, cpusetsize, (unsigned long *)mask->__bits));
+}
+
+int sched_getaffinity(pid_t pid, size_t cpusetsize, cpu_set_t *mask) {
+  return errno_wrap(sysbind_sched_getaffinity(pid, cpusetsize, mask->__bits));
+}
+
+int sched_getcpu(void) { return errno_wrap(sysbind_getcpu()); }
@@ -0,0 +1,10 @@
+#include <sctrace.h>
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+
+
+int sctrace(int pid, int flags) { return errno_wrap(sysbind_sctrace(pid, flags)); }
+
+int sctrace_stats(int pid, struct sctrace_stat *stats, int count) {
+  return errno_wrap(sysbind_sctrace_stats(pid, stats, count));
+}
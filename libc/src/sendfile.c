@@ -0,0 +1,24 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/sendfile.h>
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+
+
+ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count) {
+  long off = offset ? *offset : 0;
+  ssize_t n = errno_wrap(sysbind_sendfile(out_fd, in_fd, offset ? &off : NULL, count));
+  if (offset) *offset = off;
+  return n;
+}
+
+
+ssize_t splice(int fd_in, off_t *off_in, int fd_out, off_t *off_out, size_t len, unsigned flags) {
+  long in = off_in ? *off_in : 0;
+  long out = off_out ? *off_out : 0;
+  ssize_t n = errno_wrap(sysbind_splice(fd_in, off_in ? &in : NULL, fd_out, off_out ? &out : NULL, len, flags));
+  if (off_in) *off_in = in;
+  if (off_out) *off_out = out;
+  return n;
+}
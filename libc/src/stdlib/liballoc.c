@@ -4,6 +4,8 @@
 #define __NEED_uintptr_t
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <string.h>
+#include <pthread.h>
 
 // #define DEBUG
 // #define INFO
@@ -101,8 +103,8 @@ static long long l_possibleOverruns = 0;  ///< Number of possible overruns
 
 
 
-unsigned long long malloc_total(void) { return l_allocated; }
-unsigned long long malloc_allocated(void) { return l_inuse; }
+unsigned long long PREFIX(malloc_total)(void) { return l_allocated; }
+unsigned long long PREFIX(malloc_allocated)(void) { return l_inuse; }
 // ***********   HELPER FUNCTIONS  *******************************
 
 static void *liballoc_memset(void *s, int c, size_t n) {
@@ -717,3 +719,36 @@ void *PREFIX(realloc)(void *p, size_t size) {
 
   return ptr;
 }
+
+
+
+// bindings for liballoc
+
+static pthread_mutex_t malloc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int liballoc_lock() {
+  pthread_mutex_lock(&malloc_lock);
+  return 0;
+}
+
+
+int liballoc_unlock() {
+  pthread_mutex_unlock(&malloc_lock);
+  return 0;
+}
+
+static int region_id = 0;
+void *liballoc_alloc(size_t s) {
+  void *p = mmap(NULL, s * 4096, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  char name[32];
+  snprintf(name, 32, "[malloc #%d]", region_id++);
+  mrename(p, name);
+  memset(p, 0x0, s * 4096);
+  return p;
+}
+
+
+int liballoc_free(void *buf, size_t sz) {
+  munmap(buf, sz * 4096);
+  return 0;
+}
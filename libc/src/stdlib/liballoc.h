@@ -14,8 +14,9 @@
 //#define _HAVE_UINTPTR_T
 // typedef	unsigned long	uintptr_t;
 
-// This lets you prefix malloc and friends
-#define PREFIX(func) func
+// This lets you prefix malloc and friends. libc's malloc lives in malloc.c,
+// and liballoc is only kept around to compare against (see bin/mallocbench)
+#define PREFIX(func) __liballoc_##func
 
 #ifdef __cplusplus
 extern "C" {
@@ -2,36 +2,420 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <malloc.h>
 
 
-static pthread_mutex_t malloc_lock = PTHREAD_MUTEX_INITIALIZER;
-// bindings for liballoc
+/*
+ * A thread caching allocator.
+ *
+ * Small requests (up to 32k) are rounded up to one of a set of size classes.
+ * Objects of a class are carved out of 256k spans, which are aligned so free()
+ * can find an object's span header by masking the pointer.
+ *
+ * Each thread keeps a cache of free objects for every class, so most mallocs
+ * and frees are a push or pop on a thread local list and take no lock. When
+ * a thread's list runs dry it grabs a batch from the class's central list of
+ * partially used spans, and when a list grows too long it hands a batch back.
+ * Each class has its own lock, so threads allocating different sizes don't
+ * contend at all.
+ *
+ * Spans are cut from big chunks of anonymous memory (the arena). Spans that
+ * become completely free go back to the arena to be reused by any class, and
+ * are never unmapped. Large requests get their own mapping, and a few freed
+ * ones are kept around to be reused by the next large malloc of a similar size.
+ *
+ * Anonymous memory from the kernel is already zero, and is only written when
+ * it is handed out, so there is no need to touch it here.
+ */
 
-int liballoc_lock() {
-	pthread_mutex_lock(&malloc_lock);
-  return 0;
+#define SPAN_SHIFT 18
+#define SPAN_SIZE (1UL << SPAN_SHIFT)
+#define SPAN_HDR 64
+#define CHUNK_SPANS 8  // spans mapped at a time (2mb)
+
+#define SPAN_MAGIC 0x5a4e5a4e
+#define CLASS_LARGE (-1)
+
+#define SMALL_MAX 32768
+#define NCLASSES 44
+
+// how many objects a thread may cache in one class before it gives some back
+#define TCACHE_BYTES (64 * 1024)
+// don't keep more than this much memory in freed large mappings
+#define LARGE_CACHE_BYTES (8 * 1024 * 1024)
+
+#define ROUND_UP(x, y) (((x) + (y)-1) & ~((y)-1))
+
+
+struct span {
+  unsigned magic;
+  int cls;            // size class, or CLASS_LARGE
+  unsigned used;      // objects handed out from this span
+  unsigned on_list;   // is this span on its class's partial list?
+  void *free;         // objects that were given back
+  char *bump;         // objects at or above this have never been handed out
+  struct span *next, *prev;
+  size_t mapped;   // CLASS_LARGE: the usable size of the mapping
+  void *map_base;  // CLASS_LARGE: where the mapping really starts
+};
+
+_Static_assert(sizeof(struct span) <= SPAN_HDR, "span header is too big");
+
+
+struct size_class {
+  pthread_mutex_t lock;
+  struct span *partial;  // spans with objects that are free
+};
+
+struct tcache_bin {
+  void *head;
+  unsigned count;
+};
+
+
+// zeroed mutexes are unlocked, so none of this needs initializing
+static struct size_class classes[NCLASSES];
+
+static __thread struct tcache_bin tcache[NCLASSES];
+
+// the arena
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct span *free_spans = NULL;
+static char *chunk_cur = NULL, *chunk_end = NULL;
+static struct span *large_cache = NULL;
+static size_t large_cached = 0;
+
+static unsigned long long total_mapped = 0;
+static unsigned long long total_used = 0;
+
+
+
+/*
+ * 16 byte steps up to 256, then four classes per power of two up to 32k
+ */
+static inline int size_to_class(size_t size) {
+  if (size <= 256) return size == 0 ? 0 : (size - 1) >> 4;
+  int lg = 63 - __builtin_clzl(size - 1);  // 2^lg < size <= 2^(lg+1)
+  int step = (size - 1 - (1UL << lg)) >> (lg - 2);
+  return 16 + (lg - 8) * 4 + step;
+}
+
+
+static inline unsigned class_size(int cls) {
+  if (cls < 16) return (cls + 1) * 16;
+  int lg = 8 + (cls - 16) / 4;
+  return (1U << lg) + ((cls - 16) % 4 + 1) * (1U << (lg - 2));
+}
+
+
+// how many objects move between a thread's cache and the central list at once
+static inline unsigned class_batch(int cls) {
+  unsigned batch = TCACHE_BYTES / 4 / class_size(cls);
+  if (batch < 2) return 2;
+  if (batch > 64) return 64;
+  return batch;
+}
+
+
+static inline struct span *span_of(void *p) { return (struct span *)((uintptr_t)p & ~(SPAN_SIZE - 1)); }
+
+
+// map `size` bytes aligned to a span. Wastes up to a span of address space, but none of memory.
+static struct span *map_aligned(size_t size, void **base) {
+  size_t len = size + SPAN_SIZE;
+  void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+  if (p == MAP_FAILED || p == NULL) return NULL;
+  mrename(p, "[malloc]");
+  __atomic_fetch_add(&total_mapped, len, __ATOMIC_RELAXED);
+  *base = p;
+  return (struct span *)ROUND_UP((uintptr_t)p, SPAN_SIZE);
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+//  The arena
+/////////////////////////////////////////////////////////////////
+
+static struct span *span_alloc(void) {
+  struct span *s = NULL;
+  pthread_mutex_lock(&arena_lock);
+  if (free_spans != NULL) {
+    s = free_spans;
+    free_spans = s->next;
+  } else {
+    if (chunk_cur == chunk_end) {
+      // chunks are never unmapped, so their base is not needed
+      void *base;
+      chunk_cur = (char *)map_aligned(CHUNK_SPANS * SPAN_SIZE, &base);
+      chunk_end = chunk_cur == NULL ? NULL : chunk_cur + CHUNK_SPANS * SPAN_SIZE;
+    }
+    if (chunk_cur != NULL) {
+      s = (struct span *)chunk_cur;
+      chunk_cur += SPAN_SIZE;
+    }
+  }
+  pthread_mutex_unlock(&arena_lock);
+  return s;
+}
+
+
+static void span_release(struct span *s) {
+  s->magic = 0;
+  pthread_mutex_lock(&arena_lock);
+  s->next = free_spans;
+  free_spans = s;
+  pthread_mutex_unlock(&arena_lock);
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+//  Central lists (one per size class)
+/////////////////////////////////////////////////////////////////
+
+static void partial_add(struct size_class *sc, struct span *s) {
+  s->on_list = 1;
+  s->prev = NULL;
+  s->next = sc->partial;
+  if (sc->partial) sc->partial->prev = s;
+  sc->partial = s;
+}
+
+static void partial_remove(struct size_class *sc, struct span *s) {
+  s->on_list = 0;
+  if (s->prev) s->prev->next = s->next;
+  if (s->next) s->next->prev = s->prev;
+  if (sc->partial == s) sc->partial = s->next;
+}
+
+
+// move up to a batch of objects from the central list into this thread's cache
+static int central_refill(int cls, struct tcache_bin *bin) {
+  struct size_class *sc = &classes[cls];
+  unsigned size = class_size(cls);
+  unsigned want = class_batch(cls);
+  unsigned got = 0;
+
+  pthread_mutex_lock(&sc->lock);
+  while (got < want) {
+    struct span *s = sc->partial;
+    if (s == NULL) {
+      s = span_alloc();
+      if (s == NULL) break;
+      s->magic = SPAN_MAGIC;
+      s->cls = cls;
+      s->used = 0;
+      s->free = NULL;
+      s->bump = (char *)s + SPAN_HDR;
+      s->mapped = 0;
+      partial_add(sc, s);
+    }
+
+    while (got < want) {
+      void *obj;
+      if (s->free != NULL) {
+        obj = s->free;
+        s->free = *(void **)obj;
+      } else if (s->bump + size <= (char *)s + SPAN_SIZE) {
+        obj = s->bump;
+        s->bump += size;
+      } else {
+        break;
+      }
+      s->used++;
+      *(void **)obj = bin->head;
+      bin->head = obj;
+      got++;
+    }
+
+    if (s->free == NULL && s->bump + size > (char *)s + SPAN_SIZE) partial_remove(sc, s);
+  }
+  pthread_mutex_unlock(&sc->lock);
+
+  bin->count += got;
+  __atomic_fetch_add(&total_used, (unsigned long long)got * size, __ATOMIC_RELAXED);
+  return got;
+}
+
+
+// give `count` objects from the front of this thread's cache back to their spans
+static void central_release(int cls, struct tcache_bin *bin, unsigned count) {
+  struct size_class *sc = &classes[cls];
+
+  pthread_mutex_lock(&sc->lock);
+  for (unsigned i = 0; i < count && bin->head != NULL; i++) {
+    void *obj = bin->head;
+    bin->head = *(void **)obj;
+    bin->count--;
+
+    struct span *s = span_of(obj);
+    *(void **)obj = s->free;
+    s->free = obj;
+    s->used--;
+
+    if (s->used == 0) {
+      // keep one span around so a class that bounces between empty and not doesn't thrash the arena
+      if (s->on_list) partial_remove(sc, s);
+      if (sc->partial != NULL) {
+        span_release(s);
+        continue;
+      }
+    }
+    if (!s->on_list) partial_add(sc, s);
+  }
+  pthread_mutex_unlock(&sc->lock);
+
+  __atomic_fetch_sub(&total_used, (unsigned long long)count * class_size(cls), __ATOMIC_RELAXED);
+}
+
+
+// called by a thread that is exiting, so its cached objects aren't lost
+void __malloc_thread_exit(void) {
+  for (int c = 0; c < NCLASSES; c++) {
+    if (tcache[c].count != 0) central_release(c, &tcache[c], tcache[c].count);
+  }
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+//  Large allocations
+/////////////////////////////////////////////////////////////////
+
+static void *large_alloc(size_t size) {
+  size_t need = ROUND_UP(SPAN_HDR + size, 4096);
+  struct span *s = NULL;
+
+  pthread_mutex_lock(&arena_lock);
+  for (struct span *c = large_cache; c != NULL; c = c->next) {
+    // don't hand out something far bigger than what was asked for
+    if (c->mapped >= need && c->mapped / 2 <= need) {
+      if (c->prev) c->prev->next = c->next;
+      if (c->next) c->next->prev = c->prev;
+      if (large_cache == c) large_cache = c->next;
+      large_cached -= c->mapped;
+      s = c;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&arena_lock);
+
+  if (s == NULL) {
+    void *base;
+    s = map_aligned(need, &base);
+    if (s == NULL) return NULL;
+    s->mapped = need;
+    s->map_base = base;
+  }
+
+  s->magic = SPAN_MAGIC;
+  s->cls = CLASS_LARGE;
+  __atomic_fetch_add(&total_used, s->mapped, __ATOMIC_RELAXED);
+  return (char *)s + SPAN_HDR;
 }
 
 
-int liballoc_unlock() {
-	pthread_mutex_unlock(&malloc_lock);
-  return 0;
+static void large_free(struct span *s) {
+  __atomic_fetch_sub(&total_used, s->mapped, __ATOMIC_RELAXED);
+  s->magic = 0;
+
+  pthread_mutex_lock(&arena_lock);
+  if (large_cached + s->mapped <= LARGE_CACHE_BYTES) {
+    s->prev = NULL;
+    s->next = large_cache;
+    if (large_cache) large_cache->prev = s;
+    large_cache = s;
+    large_cached += s->mapped;
+    s = NULL;
+  }
+  pthread_mutex_unlock(&arena_lock);
+
+  if (s != NULL) {
+    size_t len = s->mapped + SPAN_SIZE;
+    munmap(s->map_base, len);
+    __atomic_fetch_sub(&total_mapped, len, __ATOMIC_RELAXED);
+  }
+}
+
+
+
+/////////////////////////////////////////////////////////////////
+//  The interface
+/////////////////////////////////////////////////////////////////
+
+void *malloc(size_t size) {
+  if (size > SMALL_MAX) return large_alloc(size);
+
+  int cls = size_to_class(size);
+  struct tcache_bin *bin = &tcache[cls];
+  if (bin->head == NULL && central_refill(cls, bin) == 0) return NULL;
+
+  void *obj = bin->head;
+  bin->head = *(void **)obj;
+  bin->count--;
+  return obj;
 }
 
-int region_id = 0;
-void *liballoc_alloc(size_t s) {
-  void *p = mmap(NULL, s * 4096, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
-  char name[32];
-  snprintf(name, 32, "[malloc #%d]", region_id++);
-  mrename(p, name);
-  memset(p, 0x0, s * 4096);
+
+void free(void *p) {
+  if (p == NULL) return;
+
+  struct span *s = span_of(p);
+  if (s->magic != SPAN_MAGIC) {
+    fprintf(stderr, "malloc: free(%p) of a pointer malloc didn't return\n", p);
+    abort();
+  }
+
+  if (s->cls == CLASS_LARGE) return large_free(s);
+
+  struct tcache_bin *bin = &tcache[s->cls];
+  *(void **)p = bin->head;
+  bin->head = p;
+  bin->count++;
+  if (bin->count > class_batch(s->cls) * 2) central_release(s->cls, bin, class_batch(s->cls));
+}
+
+
+size_t malloc_usable_size(void *p) {
+  if (p == NULL) return 0;
+  struct span *s = span_of(p);
+  if (s->cls == CLASS_LARGE) return s->mapped - SPAN_HDR;
+  return class_size(s->cls);
+}
+
+
+void *calloc(size_t nmemb, size_t size) {
+  size_t total;
+  if (__builtin_mul_overflow(nmemb, size, &total)) return NULL;
+  void *p = malloc(total);
+  // recycled large mappings and small objects may be dirty
+  if (p != NULL) memset(p, 0, total);
   return p;
 }
 
 
-int liballoc_free(void *buf, size_t sz) {
-  munmap(buf, sz * 4096);
-  return 0;
+void *realloc(void *p, size_t size) {
+  if (p == NULL) return malloc(size);
+  if (size == 0) {
+    free(p);
+    return NULL;
+  }
+
+  size_t have = malloc_usable_size(p);
+  // still fits, and isn't wasting most of the old allocation
+  if (size <= have && size >= have / 2) return p;
+
+  void *n = malloc(size);
+  if (n == NULL) return NULL;
+  memcpy(n, p, size < have ? size : have);
+  free(p);
+  return n;
 }
+
+
+unsigned long long malloc_total(void) { return total_mapped; }
+unsigned long long malloc_allocated(void) { return total_used; }
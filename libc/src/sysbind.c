@@ -433,7 +433,10 @@ time_t sysbind_localtime(struct tm* tloc) {
                0);
 }
 
+extern int __vdso_gettime_microsecond(size_t *);
 size_t sysbind_gettime_microsecond() {
+    size_t __fast;
+    if (__vdso_gettime_microsecond(&__fast)) return __fast;
     return (size_t)__syscall_eintr(SYS_gettime_microsecond,
                0,
                0,
@@ -583,7 +586,7 @@ unsigned long sysbind_kshell() {
                0);
 }
 
-int sysbind_futex(int* uaddr, int op, int val, int val2, int* uaddr2, int val3) {
+int sysbind_futex(int* uaddr, int op, int val, unsigned long val2, int* uaddr2, int val3) {
     return (int)__syscall_eintr(SYS_futex,
                (unsigned long long)uaddr,
                (unsigned long long)op,
@@ -683,3 +686,196 @@ int sysbind_kctl(off_t* name, unsigned namelen, char * oval, size_t* olen, char
                (unsigned long long)nlen);
 }
 
+int sysbind_sched_setaffinity(int tid, size_t size, unsigned long * mask) {
+    return (int)__syscall_eintr(SYS_sched_setaffinity,
+               (unsigned long long)tid,
+               (unsigned long long)size,
+               (unsigned long long)mask,
+               0,
+               0,
+               0);
+}
+
+int sysbind_sched_getaffinity(int tid, size_t size, unsigned long * mask) {
+    return (int)__syscall_eintr(SYS_sched_getaffinity,
+               (unsigned long long)tid,
+               (unsigned long long)size,
+               (unsigned long long)mask,
+               0,
+               0,
+               0);
+}
+
+int sysbind_get_sched_stats(int tid, struct chariot_sched_stats * stats) {
+    return (int)__syscall_eintr(SYS_get_sched_stats,
+               (unsigned long long)tid,
+               (unsigned long long)stats,
+               0,
+               0,
+               0,
+               0);
+}
+
+extern int __vdso_getcpu(int *);
+int sysbind_getcpu() {
+    int __fast;
+    if (__vdso_getcpu(&__fast)) return __fast;
+    return (int)__syscall_eintr(SYS_getcpu,
+               0,
+               0,
+               0,
+               0,
+               0,
+               0);
+}
+
+int sysbind_ioring_setup(unsigned entries, struct ioring_params * params) {
+    return (int)__syscall_eintr(SYS_ioring_setup,
+               (unsigned long long)entries,
+               (unsigned long long)params,
+               0,
+               0,
+               0,
+               0);
+}
+
+int sysbind_ioring_enter(int fd, unsigned to_submit, unsigned min_complete, int flags) {
+    return (int)__syscall_eintr(SYS_ioring_enter,
+               (unsigned long long)fd,
+               (unsigned long long)to_submit,
+               (unsigned long long)min_complete,
+               (unsigned long long)flags,
+               0,
+               0);
+}
+
+int sysbind_awaitset_create(int flags) {
+    return (int)__syscall_eintr(SYS_awaitset_create,
+               (unsigned long long)flags,
+               0,
+               0,
+               0,
+               0,
+               0);
+}
+
+int sysbind_awaitset_ctl(int set, int op, int fd, struct awaitset_event * ev) {
+    return (int)__syscall_eintr(SYS_awaitset_ctl,
+               (unsigned long long)set,
+               (unsigned long long)op,
+               (unsigned long long)fd,
+               (unsigned long long)ev,
+               0,
+               0);
+}
+
+int sysbind_awaitset_wait(int set, struct awaitset_event * events, int max, long long timeout_time) {
+    return (int)__syscall_eintr(SYS_awaitset_wait,
+               (unsigned long long)set,
+               (unsigned long long)events,
+               (unsigned long long)max,
+               (unsigned long long)timeout_time,
+               0,
+               0);
+}
+
+ssize_t sysbind_readv(int fd, const struct iovec * iov, int iovcnt) {
+    return (ssize_t)__syscall_eintr(SYS_readv,
+               (unsigned long long)fd,
+               (unsigned long long)iov,
+               (unsigned long long)iovcnt,
+               0,
+               0,
+               0);
+}
+
+ssize_t sysbind_writev(int fd, const struct iovec * iov, int iovcnt) {
+    return (ssize_t)__syscall_eintr(SYS_writev,
+               (unsigned long long)fd,
+               (unsigned long long)iov,
+               (unsigned long long)iovcnt,
+               0,
+               0,
+               0);
+}
+
+ssize_t sysbind_preadv(int fd, const struct iovec * iov, int iovcnt, long off) {
+    return (ssize_t)__syscall_eintr(SYS_preadv,
+               (unsigned long long)fd,
+               (unsigned long long)iov,
+               (unsigned long long)iovcnt,
+               (unsigned long long)off,
+               0,
+               0);
+}
+
+ssize_t sysbind_pwritev(int fd, const struct iovec * iov, int iovcnt, long off) {
+    return (ssize_t)__syscall_eintr(SYS_pwritev,
+               (unsigned long long)fd,
+               (unsigned long long)iov,
+               (unsigned long long)iovcnt,
+               (unsigned long long)off,
+               0,
+               0);
+}
+
+ssize_t sysbind_sendfile(int out_fd, int in_fd, long * off, size_t count) {
+    return (ssize_t)__syscall_eintr(SYS_sendfile,
+               (unsigned long long)out_fd,
+               (unsigned long long)in_fd,
+               (unsigned long long)off,
+               (unsigned long long)count,
+               0,
+               0);
+}
+
+ssize_t sysbind_splice(int fd_in, long * off_in, int fd_out, long * off_out, size_t len, unsigned flags) {
+    return (ssize_t)__syscall_eintr(SYS_splice,
+               (unsigned long long)fd_in,
+               (unsigned long long)off_in,
+               (unsigned long long)fd_out,
+               (unsigned long long)off_out,
+               (unsigned long long)len,
+               (unsigned long long)flags);
+}
+
+int sysbind_sctrace(int pid, int flags) {
+    return (int)__syscall_eintr(SYS_sctrace,
+               (unsigned long long)pid,
+               (unsigned long long)flags,
+               0,
+               0,
+               0,
+               0);
+}
+
+int sysbind_sctrace_stats(int pid, struct sctrace_stat * stats, int count) {
+    return (int)__syscall_eintr(SYS_sctrace_stats,
+               (unsigned long long)pid,
+               (unsigned long long)stats,
+               (unsigned long long)count,
+               0,
+               0,
+               0);
+}
+
+int sysbind_multicall(struct multicall_entry * calls, int count, int flags) {
+    return (int)__syscall_eintr(SYS_multicall,
+               (unsigned long long)calls,
+               (unsigned long long)count,
+               (unsigned long long)flags,
+               0,
+               0,
+               0);
+}
+
+ssize_t sysbind_getdents(int fd, struct dirent64 * buf, size_t len) {
+    return (ssize_t)__syscall_eintr(SYS_getdents,
+               (unsigned long long)fd,
+               (unsigned long long)buf,
+               (unsigned long long)len,
+               0,
+               0,
+               0);
+}
+
@@ -26,10 +26,19 @@ int clock_getres(int id, struct timespec *s) {
 	return -1;
 }
 
+// src/vdso.c
+extern int __vdso_now_ns(unsigned long *out);
+
+static unsigned long now_ns(void) {
+  unsigned long ns;
+  if (__vdso_now_ns(&ns)) return ns;
+  return sysbind_gettime_microsecond() * 1000;
+}
+
 int clock_gettime(int id, struct timespec *s) {
-  long us = sysbind_gettime_microsecond();
-  s->tv_nsec = us * 1000;
-  s->tv_sec = us / 1000 / 1000;
+  unsigned long ns = now_ns();
+  s->tv_sec = ns / NS_PER_SEC;
+  s->tv_nsec = ns % NS_PER_SEC;
   return 0;
 }
 
@@ -52,7 +61,7 @@ struct tm *localtime(const time_t *t) {
 
 
 int gettimeofday(struct timeval *tv, void *idklol) {
-  uint64_t usec = sysbind_gettime_microsecond();
+  uint64_t usec = now_ns() / 1000;
   tv->tv_sec = usec / US_PER_SEC;
   tv->tv_usec = usec % US_PER_SEC;
   return 0;
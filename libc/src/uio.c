@@ -0,0 +1,28 @@
+#include <sys/sysbind.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt) { return errno_wrap(sysbind_readv(fd, iov, iovcnt)); }
+
+ssize_t writev(int fd, const struct iovec *iov, int iovcnt) { return errno_wrap(sysbind_writev(fd, iov, iovcnt)); }
+
+ssize_t preadv(int fd, const struct iovec *iov, int iovcnt, off_t off) {
+  return errno_wrap(sysbind_preadv(fd, iov, iovcnt, off));
+}
+
+ssize_t pwritev(int fd, const struct iovec *iov, int iovcnt, off_t off) {
+  return errno_wrap(sysbind_pwritev(fd, iov, iovcnt, off));
+}
+
+
+ssize_t pread(int fd, void *buf, size_t count, off_t off) {
+  struct iovec iov = {buf, count};
+  return preadv(fd, &iov, 1, off);
+}
+
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t off) {
+  struct iovec iov = {(void *)buf, count};
+  return pwritev(fd, &iov, 1, off);
+}
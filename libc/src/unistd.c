@@ -6,12 +6,17 @@
 #include <termios.h>
 #include <sys/ioctl.h>
 
+extern void __pthread_fork_child(void);
+
 pid_t fork(void) {
-  return sysbind_fork();
+  int pid = sysbind_fork();
+  if (pid == 0) __pthread_fork_child();
+  return pid;
 }
 
 #undef errno
-int errno;
+// every thread has its own errno
+__thread int errno;
 
 int *__errno_location(void) {
   return &errno;
@@ -0,0 +1,77 @@
+#include <chariot/vvar.h>
+#include <stddef.h>
+
+// Read the kernel's timekeeping state from the vvar page, which the kernel
+// maps into every process (see <chariot/vvar.h>). These back the fastpaths
+// of the sysbind_ functions in sysbind.c and return 0 if the caller has to
+// make a system call instead.
+
+#define VVAR ((const struct chariot_vvar *)CHARIOT_VVAR_ADDR)
+
+
+static inline unsigned long read_counter(unsigned mode) {
+#ifdef __x86_64__
+  if (mode == VVAR_CLOCK_TSC) {
+    unsigned lo, hi;
+    // lfence keeps rdtsc from being executed before the seq load
+    __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi)::"memory");
+    return lo | ((unsigned long)hi << 32);
+  }
+#endif
+#ifdef __riscv
+  if (mode == VVAR_CLOCK_TIME_CSR) {
+    unsigned long t;
+    __asm__ volatile("rdtime %0" : "=r"(t)::"memory");
+    return t;
+  }
+#endif
+  return 0;
+}
+
+
+int __vdso_now_ns(unsigned long *out) {
+  const struct chariot_vvar *v = VVAR;
+  unsigned seq, mode, mult, shift;
+  unsigned long base_cycle, base_ns, now;
+
+  do {
+    while ((seq = __atomic_load_n(&v->seq, __ATOMIC_ACQUIRE)) & 1) {
+    }
+    mode = v->clock_mode;
+    mult = v->mult;
+    shift = v->shift;
+    base_cycle = v->base_cycle;
+    base_ns = v->base_ns;
+    if (mode == VVAR_CLOCK_NONE) return 0;
+    now = read_counter(mode);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (__atomic_load_n(&v->seq, __ATOMIC_RELAXED) != seq);
+
+  if (now < base_cycle) {
+    *out = base_ns;
+  } else {
+    *out = base_ns + (unsigned long)(((unsigned __int128)(now - base_cycle) * mult) >> shift);
+  }
+  return 1;
+}
+
+
+int __vdso_gettime_microsecond(size_t *out) {
+  unsigned long ns;
+  if (!__vdso_now_ns(&ns)) return 0;
+  *out = ns / 1000;
+  return 1;
+}
+
+
+int __vdso_getcpu(int *out) {
+#ifdef __x86_64__
+  if (VVAR->cpu_mode == VVAR_CPU_RDTSCP) {
+    unsigned lo, hi, aux;
+    __asm__ volatile("rdtscp" : "=a"(lo), "=d"(hi), "=c"(aux));
+    *out = (int)aux;
+    return 1;
+  }
+#endif
+  return 0;
+}
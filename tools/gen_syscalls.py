@@ -44,6 +44,31 @@ class Systemcall:
     def cdecl(self, prefix = ''):
         return '{} {}{}({})'.format(self.data['ret'], prefix, self.name, self.format_args())
 
+    # the first argument that is a C string, which tracing copies out
+    def string_arg(self):
+        for i, (a, b) in enumerate(self.args):
+            if b.replace(' ', '') == 'constchar*':
+                return i
+        return -1
+
+    # __SYSCALL_INFO(num, name, ret, flags, string arg, nargs, "type name"...)
+    # for <chariot/syscall_info.inc>. `noreturn` syscalls are traced on the way
+    # in, `notrace` ones aren't traced at all, and `nobatch` ones can't be run
+    # from multicall()
+    def info_macro(self):
+        flags = []
+        if self.data.get('noreturn', False):
+            flags.append('SCINFO_NORETURN')
+        if self.data.get('notrace', False):
+            flags.append('SCINFO_NOTRACE')
+        if self.data.get('nobatch', False):
+            flags.append('SCINFO_NOBATCH')
+        flagstr = ' | '.join(flags) if flags else '0'
+        parts = [f'0x{self.num:02x}', self.name, f'"{self.data["ret"]}"', flagstr,
+                 str(self.string_arg()), str(len(self.args))]
+        parts += [f'"{b} {a}"' for (a, b) in self.args]
+        return '__SYSCALL_INFO({})'.format(', '.join(parts))
+
     def cmacro(self):
         args = ""
         if len(self.args) > 0:
@@ -62,6 +87,13 @@ with open('include/chariot/syscalls.inc', 'w+') as f:
 
 
 
+with open('include/chariot/syscall_info.inc', 'w+') as f:
+    f.write('// Generated by tools/gen_syscalls.py. Do not change\n')
+    for s in syscalls:
+        f.write(s.info_macro() + '\n')
+
+
+
 with open('libc/include/sys/syscall_defs.h', 'w+') as f:
     for s in syscalls:
         f.write(f'#define SYS_{s.name:24s} (0x{s.num:02x})\n')
@@ -146,7 +178,18 @@ extern long __syscall_eintr(int num, unsigned long long a, unsigned long long b,
             ret = sc.data['ret']
             for i, arg in enumerate(sc.args):
                 args[i] = '(unsigned long long)' + arg[0]
+            # A fastpath is a libc function that may be able to answer without
+            # entering the kernel (see libc/src/vdso.c). It returns nonzero and
+            # fills out the result if it could.
+            if 'fastpath' in sc.data:
+                fast = sc.data['fastpath']
+                fast_args = ', '.join([f'{ret} *'] + [b for (a, b) in sc.args])
+                f.write(f'extern int {fast}({fast_args});\n')
             f.write(f'{decl} {{\n')
+            if 'fastpath' in sc.data:
+                call_args = ', '.join(['&__fast'] + [a for (a, b) in sc.args])
+                f.write(f'    {ret} __fast;\n')
+                f.write(f'    if ({sc.data["fastpath"]}({call_args})) return __fast;\n')
             # prepend the SYS_x name
             args = ['SYS_' + sc.name]+ args
             arg_str = ',\n               '.join(args)